@@ -1,11 +1,19 @@
-#include <Windows.h>
 #include <stdint.h>
 #include <stdio.h>
 
 #include "8086_decoder.h"
+#include "memory_kernels.cpp"
 #include "string.cpp"
 #include "array.cpp"
 
+#if defined(_WIN32)
+#include "win32_platform.cpp"
+#else
+#include "posix_platform.cpp"
+#endif
+#include "output_sink.cpp"
+#include "work_deque.cpp"
+
 enum repeat_state
 {
 	State_repeat_none,
@@ -13,99 +21,38 @@ enum repeat_state
 	State_repeat_when_zf_clear,	//z=0: repne, repnz
 };
 
+#include "decoded_instruction.cpp"
+
 struct decoder_state
 {
 	repeat_state RepeatState;
 	b32 endedWithNewLine;
 
 	memory_arena *ScratchPad;
-	string_buffer *SegmentOverridePrefix;
+	u8 segmentOverride; //NOTE (Aske): 0 for none, otherwise 1 + the segment register, until an effective address uses it
+	output_sink *messageSink; //NOTE (Aske): For opcodes that aren't decoded. Messages are dropped when it's 0
+	b32 isInputTruncated;
+	s64 truncatedOffset; //NOTE (Aske): Where the truncated instruction starts, when isInputTruncated
+	struct instruction_cache *instructionCache; //NOTE (Aske): 0 unless -cache is given
+	struct listing_index_writer *indexWriter; //NOTE (Aske): 0 unless -index or -update is given
 
 #if LABEL_FIRST_PASS
 	array_s32 *labelAtByte;
 #else
 	array_label_position *postPassOffsets;
+	array_label_position *labelSpaces; //NOTE (Aske): Where the label space before each line is in the output
 #endif
 };
 
-#pragma region File I/O
-internal void FreeFileMemory(void* memory) 
-{
-	if (memory) {
-		VirtualFree(memory, 0, MEM_RELEASE);
-	}
-}
-
-struct debug_read_file_result
-{
-	u32 ContentsSize;
-	void* Contents;
-	s64 CurrentIndex;
-};
-
-internal debug_read_file_result ReadEntireFile(char* filename)
-{
-	debug_read_file_result result = {};
-	result.CurrentIndex = -1;
-
-	HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
-	if (fileHandle != INVALID_HANDLE_VALUE) {
-		LARGE_INTEGER fileSize;
-		if (GetFileSizeEx(fileHandle, &fileSize)) {
-			u32 fileSize32 = SafeTruncateUInt64(fileSize.QuadPart);
-			result.Contents = VirtualAlloc(0, fileSize32, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
-			if (result.Contents) {
-				DWORD bytesRead;
-				if (ReadFile(fileHandle, result.Contents, fileSize32, &bytesRead, 0) && (fileSize32 == bytesRead)) {
-					//NOTE(aske): File read successfully
-					result.ContentsSize = fileSize32;
-				}
-				else {
-					FreeFileMemory(result.Contents);
-					result.Contents = 0;
-				}
-			}
-		}
-		CloseHandle(fileHandle);
-	}
-	return result;
-}
-
-internal b32 WriteEntireFile(char* filename, u32 memorySize, void* memory)
-{
-	b32 result = false;
-
-	HANDLE fileHandle = CreateFileA(filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
-	if (fileHandle != INVALID_HANDLE_VALUE) {
-		DWORD bytesWritten;
-		if (WriteFile(fileHandle, memory, memorySize, &bytesWritten, 0)) {
-			//NOTE (aske): File read successfully
-			result = (bytesWritten == memorySize);
-		}
-		CloseHandle(fileHandle);
-	}
-
-	return result;
-}
-#pragma endregion
 
 #if !LABEL_FIRST_PASS
 //NOTE (Aske): "\n " is used to determine that it's a label
-global_variable u32 labelSpaceSize = 20; //label__2147483647:\n "
+global_variable u32 labelSpaceSize = 29; //label__9223372036854775807:\n "
 #endif
 
-#define ASM_OPERATION(name) void name(decoder_state *decoderState, string_buffer *outputLine, debug_read_file_result *binaryInputFile, u8 currentByte)
+#define ASM_OPERATION(name) void name(decoder_state *decoderState, decoded_instruction *decoded, debug_read_file_result *binaryInputFile, u8 currentByte)
 typedef ASM_OPERATION(asm_operation);
 
-//primary function container
-global_variable asm_operation *asmOps[256] = { 0 };
-
-global_variable char *regs16bit[8]  = { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di" };
-global_variable char *regs8bit[8] = { "al", "cl", "dl", "bl", "ah", "ch", "dh", "bh" };
-global_variable char **regsAll[2] = { regs8bit, regs16bit }; //regsAll[isWide][regByte]
-//NOTE (Aske): rnm[6] requires displacement
-global_variable char *rnmForNon3Mods[8] = { "bx + si", "bx + di", "bp + si", "bp + di", "si", "di", "bp", "bx" };
-
 #define PushString(arena, stringPtrName, bufferSize)\
 PushStructBuffer(arena, string, bufferSize); 		\
 stringPtrName->base = (u8 *)(stringPtrName + 1)
@@ -135,29 +82,32 @@ u8 rnm = secondByte & 0x7
 internal void Append(memory_arena *arena, string *toAppend)
 {
 	void *writeLocation = PushSize(arena, toAppend->count);
-	NaiveWiderCopy(toAppend->count, toAppend->data, writeLocation);
+	CopySize(toAppend->count, toAppend->data, writeLocation);
 }
 
-#define AppendAndPrint(arena, toAppend) Append(arena, (toAppend)); printf((toAppend)->data)
+//NOTE (Aske): echoSink is a null sink when the per-line echo is turned off
+#define AppendAndPrint(arena, toAppend, echoSink) Append(arena, (toAppend)); SinkWrite((echoSink), (toAppend)->data, (toAppend)->count)
 
 internal void StringBufferWidePrepend(size_t byteCount, void *source, string_buffer *dest)
 {
 	Assert(byteCount + dest->count <= dest->capacity);
-	NaiveWiderCopy(byteCount,
-	               source,
-	               dest->base + dest->count);
+	CopySize(byteCount, source, dest->base + dest->count);
 	dest->count += byteCount;
 }
 
+//NOTE (Aske): Unchecked, since the input is guard-padded. DecodeInstructionRecord checks for a truncated instruction.
 internal u8 GetNextByte(debug_read_file_result *file)
 {
-	if (++file->CurrentIndex >= file->ContentsSize)
-	{
-		Assert(!"EndOfFile");
-		return 0;
-	}
+	++file->CurrentIndex;
+	Assert((u64)(file->CurrentIndex - file->WindowOffset) < (file->WindowSize + InputGuardSize));
+	return *((u8 *)file->Contents + (file->CurrentIndex - file->WindowOffset));
+}
 
-	return *((u8 *)file->Contents + file->CurrentIndex);
+//NOTE (Aske): Once it's true, GetNextByte is returning guard bytes, so handlers don't check what they read.
+//The instruction is dropped as truncated anyway.
+internal b32 IsPastEndOfInput(debug_read_file_result *file)
+{
+	return file->CurrentIndex >= (s64)file->ContentsSize;
 }
 
 struct byte_of_file
@@ -172,15 +122,61 @@ internal byte_of_file GetNextOpsByte(debug_read_file_result *file)
 	{
 		return { 0, false };
 	}
-	;
-	return { *((u8 *)file->Contents + file->CurrentIndex), true };
+
+	Assert((u64)(file->CurrentIndex - file->WindowOffset) < file->WindowSize);
+	return { *((u8 *)file->Contents + (file->CurrentIndex - file->WindowOffset)), true };
+}
+
+//NOTE (Aske): Prefixes are decoded as separate instructions, so the longest one is
+//opcode + mod/reg/rnm + 16-bit displacement + 16-bit immediate
+#define MaxInstructionSize 6
+
+struct input_stream
+{
+	platform_file file;
+	u8 *window;
+	u64 windowCapacity;
+	b32 reachedEndOfFile;
+};
+
+//NOTE (Aske): Called between instructions. When fewer bytes than a full instruction remain in the window,
+//the unread tail is carried over to the front of the window and the rest is refilled from the file.
+//That way an instruction never has to span two windows.
+internal void RefillInputWindow(input_stream *stream, debug_read_file_result *file)
+{
+	s64 nextIndex = file->CurrentIndex + 1;
+	s64 windowEnd = file->WindowOffset + file->WindowSize;
+	Assert(nextIndex <= windowEnd);
+	if (stream->reachedEndOfFile || ((windowEnd - nextIndex) >= MaxInstructionSize))
+	{
+		return;
+	}
+
+	u64 tailSize = windowEnd - nextIndex;
+	CopySize(tailSize, stream->window + (nextIndex - file->WindowOffset), stream->window);
+
+	u64 requested = stream->windowCapacity - tailSize;
+	u64 bytesRead = PlatformReadFromFile(&stream->file, stream->window + tailSize, requested);
+
+	file->Contents = stream->window;
+	file->WindowOffset = nextIndex;
+	file->WindowSize = tailSize + bytesRead;
+	if (bytesRead < requested)
+	{
+		stream->reachedEndOfFile = true;
+		ZeroSize(stream->window + file->WindowSize, InputGuardSize);
+		//NOTE (Aske): The file may have changed size since it was opened
+		file->ContentsSize = file->WindowOffset + file->WindowSize;
+	}
 }
 
-internal void GetEffectiveAddressString(string_buffer *output,
-                                          debug_read_file_result *binaryInputFile, u8 mod, u8 rnm,
-                                          string_buffer *segmentPrefix)
+internal void ParseEffectiveAddress(decoder_state *decoderState, decoded_instruction *decoded,
+                                    instruction_operand *operand, debug_read_file_result *binaryInputFile,
+                                    u8 mod, u8 rnm)
 {
 	Assert(mod != 3);
+	*operand = Operand(Operand_memory, rnm);
+	decoded->mod = mod;
 
 	if (mod == 0) // No displacement
 	{
@@ -188,63 +184,68 @@ internal void GetEffectiveAddressString(string_buffer *output,
 		{
 			u8 dlo = GetNextByte(binaryInputFile);
 			u8 dhi = GetNextByte(binaryInputFile);
-			s16 directAddress = CastU8HiLoToS16(dlo, dhi);
-			FormatStringBufferFromBase(output, "%s[%hu]", segmentPrefix->data, directAddress);
-		}
-		else
-		{
-			FormatStringBufferFromBase(output, "%s[%s]", segmentPrefix->data, rnmForNon3Mods[rnm]);
+			decoded->displacement = CastU8HiLoToS16(dlo, dhi);
 		}
 	}
 	else if (mod == 1) //8-bit displacement
 	{
 		s8 dlo = GetNextByte(binaryInputFile);
-		s16 displacement = dlo;
-		FormatStringBufferFromBase(output, displacement == 0 ? "%s[%s]" : "%s[%s %+hd]",
-		                           segmentPrefix->data, rnmForNon3Mods[rnm], displacement);
+		decoded->displacement = dlo;
 	}
 	else //16-bit displacement
 	{
 		u8 dlo = GetNextByte(binaryInputFile);
 		u8 dhi = GetNextByte(binaryInputFile);
-		s16 displacement = CastU8HiLoToS16(dlo, dhi);
-		FormatStringBufferFromBase(output, displacement == 0 ? "%s[%s]" : "%s[%s %+hd]",
-		                           segmentPrefix->data, rnmForNon3Mods[rnm], displacement);
+		decoded->displacement = CastU8HiLoToS16(dlo, dhi);
 	}
-	ZeroSize(segmentPrefix->base, segmentPrefix->count); //clear for future instructions
+	decoded->segmentPrefix = decoderState->segmentOverride;
+	decoderState->segmentOverride = 0; //clear for future instructions
 }
 
-#define ParseEffectiveAddressString(strVarName) 										\
-string_buffer *strVarName = PushStringBuffer(decoderState->ScratchPad, strVarName, 24); \
-GetEffectiveAddressString(strVarName, binaryInputFile, mod, rnm, decoderState->SegmentOverridePrefix)
-
+#define ParseEffectiveAddressOperand(operand) \
+ParseEffectiveAddress(decoderState, decoded, &(operand), binaryInputFile, mod, rnm)
 
-internal void ToInstructionLine(string_buffer *output, char *instruction,
-                                char *operand1, char *operand2, b32 isOp1Dest)
+//NOTE (Aske): Jumps into the file get a label. Files larger than a segment are decoded as one flat address space,
+//so the target isn't limited to Sint16Max
+internal void SetBranchTarget(decoder_state *decoderState, decoded_instruction *decoded,
+                              debug_read_file_result *binaryInputFile, s64 absoluteAddress)
 {
-	char *strFormat = "%s %s, %s\n";
-	if (isOp1Dest)
+	decoded->target = absoluteAddress;
+#if LABEL_PADDING
+	if (absoluteAddress >= 0 && (u64)absoluteAddress < binaryInputFile->ContentsSize)
 	{
-		FormatStringBufferFromBase(output, strFormat, instruction, operand1, operand2);
+		decoded->flags |= InstructionFlag_hasLabel;
+		//NOTE (Aske): Only decoding records, without a listing to put the labels in
+		if (decoderState->postPassOffsets)
+		{
+			ArrayLabelPosAdd(decoderState->postPassOffsets, absoluteAddress, 0);
+		}
 	}
-	else
+#endif
+}
+
+internal void ReportDecoderMessage(decoder_state *decoderState, char *message, size_t messageLength)
+{
+	if (decoderState->messageSink)
 	{
-		FormatStringBufferFromBase(output, strFormat, instruction, operand2, operand1);
+		SinkWrite(decoderState->messageSink, message, messageLength);
 	}
 }
 
 internal ASM_OPERATION(OpNotImplemented)
 {
 	char helperMsgBuffer[32];
-	FormatString(ArrayCount(helperMsgBuffer), helperMsgBuffer, "op[%#4.2hhx] not implemented\n", currentByte);
-	printf(helperMsgBuffer);
+	size_t messageLength = FormatString(ArrayCount(helperMsgBuffer), helperMsgBuffer,
+	                                    "op[%#4.2hhx] not implemented\n", currentByte);
+	ReportDecoderMessage(decoderState, helperMsgBuffer, messageLength);
 }
 
 internal ASM_OPERATION(OpNotUsed)
 {
 	char helperMsgBuffer[32];
-	FormatString(ArrayCount(helperMsgBuffer), helperMsgBuffer, "op[%#4.2hhx] not used\n", currentByte);
-	printf(helperMsgBuffer);
+	size_t messageLength = FormatString(ArrayCount(helperMsgBuffer), helperMsgBuffer,
+	                                    "op[%#4.2hhx] not used\n", currentByte);
+	ReportDecoderMessage(decoderState, helperMsgBuffer, messageLength);
 }
 
 //-------------------------------------------------------------------------
@@ -259,23 +260,15 @@ internal ASM_OPERATION(MovRom)
 	ParseIsWideIsOp1Dest(currentByte);
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte);
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = Mnemonic_mov;
 
-	if (mod == 3)
-	{
-		ToInstructionLine(outputLine, "mov",
-		                  regsAll[isWide][reg],
-		                  regsAll[isWide][rnm],
-		                  isOp1Dest);
-	}
-	else 
+	instruction_operand source = RegisterOperand(isWide, rnm);
+	if (mod != 3)
 	{
-		ParseEffectiveAddressString(strEffectiveAddress);
-
-		ToInstructionLine(outputLine, "mov",
-		                  regsAll[isWide][reg],
-		                  strEffectiveAddress->data,
-		                  isOp1Dest);
+		ParseEffectiveAddressOperand(source);
 	}
+	SetOperands(decoded, RegisterOperand(isWide, reg), source, isOp1Dest);
 }
 
 internal ASM_OPERATION(MovImmToMemory)
@@ -284,24 +277,25 @@ internal ASM_OPERATION(MovImmToMemory)
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte);
 	Assert(reg == 0);
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = Mnemonic_mov;
+	decoded->flags |= isWide ? InstructionFlag_wide : 0;
 
-	ParseEffectiveAddressString(strEffectiveAddress);
+	ParseEffectiveAddressOperand(decoded->operand1);
 
 	if (isWide)
 	{
 		u8 lo = GetNextByte(binaryInputFile);
 		u8 hi = GetNextByte(binaryInputFile);
-		s16 data = CastU8HiLoToS16(lo, hi);
-
-		FormatStringBufferFromBase(outputLine, "mov %s, word %hd\n", strEffectiveAddress->data, data);
+		decoded->immediate = CastU8HiLoToS16(lo, hi);
 	}
 	else
 	{
 		u8 lo = GetNextByte(binaryInputFile);
-		s16 data = lo;
-
-		FormatStringBufferFromBase(outputLine, "mov %s, byte %hd\n", strEffectiveAddress->data, data);
+		decoded->immediate = lo;
 	}
+	decoded->operand2 = Operand(Operand_immediate, 0);
+	decoded->operand2.flags = OperandFlag_sized;
 }
 
 internal ASM_OPERATION(MovImmToRegister)
@@ -316,7 +310,11 @@ internal ASM_OPERATION(MovImmToRegister)
 		data = ((hi & 0xff) << 8) | (lo & 0xff); //NOTE (Aske): &0xff to prevent sign extensions
 	}
 
-	FormatStringBufferFromBase(outputLine, "mov %s, %hd\n", regsAll[isWide][reg], data);
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = Mnemonic_mov;
+	decoded->immediate = data;
+	decoded->operand1 = RegisterOperand(isWide, reg);
+	decoded->operand2 = Operand(Operand_immediate, 0);
 }
 
 internal ASM_OPERATION(MovMemAccumulator)
@@ -324,10 +322,12 @@ internal ASM_OPERATION(MovMemAccumulator)
 	ParseIsWideIsOp1Dest(currentByte);
 	u8 lo = GetNextByte(binaryInputFile);
 	u8 hi = GetNextByte(binaryInputFile);
-	s16 data = CastU8HiLoToS16(lo, hi);
+	decoded->displacement = CastU8HiLoToS16(lo, hi);
 
 	//TODO (Aske): test if this should respect isWide (al, lo vs. ax, data)
-	FormatStringBufferFromBase(outputLine, (isOp1Dest ? "mov [%hd], ax\n" : "mov ax, [%hd]\n"), data);
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = Mnemonic_mov;
+	SetOperands(decoded, Operand(Operand_directAddress, 0), Operand(Operand_register16, 0), isOp1Dest);
 }
 
 internal ASM_OPERATION(MovSegreg)
@@ -337,18 +337,15 @@ internal ASM_OPERATION(MovSegreg)
 	ParseModRegRnm(currentByte);
 	Assert(reg <= 3);
 	u8 sr = (currentByte >> 3) & 0x3;
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = Mnemonic_mov;
 
-	char *segregs[4] = { "es", "cs", "ss", "ds" };
-
-	if (mod == 3)
+	instruction_operand source = Operand(Operand_register16, rnm);
+	if (mod != 3)
 	{
-		ToInstructionLine(outputLine, "mov", segregs[sr], regs16bit[rnm], isOp1Dest);
-	}
-	else
-	{
-		ParseEffectiveAddressString(strEffectiveAddress);
-		ToInstructionLine(outputLine, "mov", segregs[sr], strEffectiveAddress->data, isOp1Dest);
+		ParseEffectiveAddressOperand(source);
 	}
+	SetOperands(decoded, Operand(Operand_segmentRegister, sr), source, isOp1Dest);
 }
 
 internal ASM_OPERATION(IncDecCallJmpPushRom16)
@@ -356,17 +353,19 @@ internal ASM_OPERATION(IncDecCallJmpPushRom16)
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte);
 	Assert(reg != 7);
-	//indirect intra-/intersegment-->      intra     inter     intra    inter
-	char *instruction[8] = { "inc", "dec", "call", "call far", "jmp", "jmp far", "push", "NOT USED" };
-	if (mod == 3)
+	//indirect intra-/intersegment-->                    intra          inter          intra         inter
+	u8 instruction[8] = { Mnemonic_inc, Mnemonic_dec, Mnemonic_call, Mnemonic_callFar, Mnemonic_jmp, Mnemonic_jmpFar,
+	                      Mnemonic_push, Mnemonic_notUsed };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[reg];
+	decoded->flags |= InstructionFlag_wide;
+
+	decoded->operand1 = Operand(Operand_register16, rnm);
+	if (mod != 3)
 	{
-		FormatStringBufferFromBase(outputLine, "%s word %s\n", instruction[reg], regs16bit[rnm]);
-	}
-	else
-	{
-		ParseEffectiveAddressString(strEffectiveAddress);
-		FormatStringBufferFromBase(outputLine, "%s word %s\n", instruction[reg], strEffectiveAddress->data);
+		ParseEffectiveAddressOperand(decoded->operand1);
 	}
+	decoded->operand1.flags = OperandFlag_sized;
 }
 
 internal ASM_OPERATION(IncDecPushPop)
@@ -374,16 +373,19 @@ internal ASM_OPERATION(IncDecPushPop)
 	u8 instIdx = (currentByte >> 3) & 0x3;
 	u8 reg = currentByte & 0x7;
 
-	char *instruction[4] = { "inc", "dec", "push", "pop"};
-	FormatStringBufferFromBase(outputLine, "%s %s\n", instruction[instIdx], regs16bit[reg]);
+	u8 instruction[4] = { Mnemonic_inc, Mnemonic_dec, Mnemonic_push, Mnemonic_pop };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[instIdx];
+	decoded->operand1 = Operand(Operand_register16, reg);
 }
 
 internal ASM_OPERATION(PushPopSegreg)
 {
 	b8 isPop = currentByte & 0x1;
 	u8 reg = (currentByte >> 3) & 0x3;
-	char *segmentRegisters[4] = { "es", "cs", "ss", "ds" };
-	FormatStringBufferFromBase(outputLine, (isPop ? "pop %s\n" : "push %s\n"), segmentRegisters[reg]);
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = isPop ? Mnemonic_pop : Mnemonic_push;
+	decoded->operand1 = Operand(Operand_segmentRegister, reg);
 }
 
 internal ASM_OPERATION(PopRom16)
@@ -391,15 +393,18 @@ internal ASM_OPERATION(PopRom16)
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte);
 	Assert(reg == 0);
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = Mnemonic_pop;
+	decoded->flags |= InstructionFlag_wide;
 
 	if (mod == 3)
 	{
-		FormatStringBufferFromBase(outputLine, "pop %s\n", regs16bit[rnm]);
+		decoded->operand1 = Operand(Operand_register16, rnm);
 	}
 	else
 	{
-		ParseEffectiveAddressString(strEffectiveAddress);
-		FormatStringBufferFromBase(outputLine, "pop word %s\n", strEffectiveAddress->data);
+		ParseEffectiveAddressOperand(decoded->operand1);
+		decoded->operand1.flags = OperandFlag_sized;
 	}
 }
 
@@ -409,56 +414,55 @@ internal ASM_OPERATION(TestXchgRom)
 	u8 index = (currentByte >> 1) & 0x1;
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte);
-	char *instruction[2] = { "test", "xchg" };
+	u8 instruction[2] = { Mnemonic_test, Mnemonic_xchg };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[index];
 
 	if (mod == 3)
 	{
-		ToInstructionLine(outputLine, instruction[index],
-		                  regsAll[isWide][reg], regsAll[isWide][rnm], index);
+		SetOperands(decoded, RegisterOperand(isWide, reg), RegisterOperand(isWide, rnm), index);
 	}
 	else
 	{
 		//NOTE (Aske): xchg operands must be equal size, so "byte"/"word" is unnecessary.
-		ParseEffectiveAddressString(strEffectiveAddress);
-		FormatStringBufferFromBase(outputLine, "%s %s, %s\n", instruction[index],
-		                           strEffectiveAddress->data, regsAll[isWide][reg]);
+		ParseEffectiveAddressOperand(decoded->operand1);
+		decoded->operand2 = RegisterOperand(isWide, reg);
 	}
 }
 
 internal ASM_OPERATION(XchgAccReg16)
 {
 	u8 reg = currentByte & 0x7;
-	FormatStringBufferFromBase(outputLine, "xchg ax, %s\n", regs16bit[reg]);
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = Mnemonic_xchg;
+	decoded->operand1 = Operand(Operand_register16, 0);
+	decoded->operand2 = Operand(Operand_register16, reg);
 }
 
 internal ASM_OPERATION(InOutFixedPort8)
 {
-	u8 index = currentByte & 0x3;
-	char *instFormat[4] = {
-		"in al, %hhu\n",
-		"in ax, %hhu\n",
-		"out %hhu, al\n",
-		"out %hhu, ax\n"
-	};
+	ParseIsWideIsOp1Dest(currentByte);
+	b32 isOut = isOp1Dest;
 	u8 lo = GetNextByte(binaryInputFile);
-	FormatStringBufferFromBase(outputLine, instFormat[index], lo);
+	decoded->immediate = lo;
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = isOut ? Mnemonic_out : Mnemonic_in;
+	SetOperands(decoded, RegisterOperand(isWide, 0), Operand(Operand_unsignedByte, 0), !isOut);
 }
 
 internal ASM_OPERATION(InOutVariablePort)
 {
-	u8 index = currentByte & 0x3;
-	char *instFormat[4] = {
-		"in al, dx\n",
-		"in ax, dx\n",
-		"out dx, al\n",
-		"out dx, ax\n"
-	};
-	FormatStringBufferFromBase(outputLine, instFormat[index]);
+	ParseIsWideIsOp1Dest(currentByte);
+	b32 isOut = isOp1Dest;
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = isOut ? Mnemonic_out : Mnemonic_in;
+	SetOperands(decoded, RegisterOperand(isWide, 0), Operand(Operand_register16, 2), !isOut);
 }
 
 internal ASM_OPERATION(Xlat)
 {
-	FormatStringBufferFromBase(outputLine, "xlat\n");
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = Mnemonic_xlat;
 }
 
 internal ASM_OPERATION(LeaLesLdsRom16)
@@ -469,41 +473,41 @@ internal ASM_OPERATION(LeaLesLdsRom16)
 	u8 index = ((currentByte & 0x8) >> 2) | (currentByte & 0x1);
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte);
-	ParseEffectiveAddressString(strEffectiveAddress);
-	char *instruction[4] = { "les", "lds", "NOT USED", "lea" };
-	FormatStringBufferFromBase(outputLine, "%s %s, %s\n",
-	                           instruction[index], regs16bit[reg], strEffectiveAddress->data);
+	u8 instruction[4] = { Mnemonic_les, Mnemonic_lds, Mnemonic_notUsed, Mnemonic_lea };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[index];
+	ParseEffectiveAddressOperand(decoded->operand2);
+	decoded->operand1 = Operand(Operand_register16, reg);
 }
 
 internal ASM_OPERATION(CbwCwdWaitPushfPopfSahfLahf)
 {
 	u8 index = currentByte & 0x7;
 	Assert(index != 2);
-	char *instruction[8] = { "cbw", "cwd", "NOT USED", "wait", "pushf", "popf", "sahf", "lahf" };
-	FormatStringBufferFromBase(outputLine, "%s\n", instruction[index]);
+	u8 instruction[8] = { Mnemonic_cbw, Mnemonic_cwd, Mnemonic_notUsed, Mnemonic_wait,
+	                      Mnemonic_pushf, Mnemonic_popf, Mnemonic_sahf, Mnemonic_lahf };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[index];
 }
 
+global_variable u8 arithmeticMnemonics[8] = { Mnemonic_add, Mnemonic_or, Mnemonic_adc, Mnemonic_sbb,
+                                              Mnemonic_and, Mnemonic_sub, Mnemonic_xor, Mnemonic_cmp };
+
 internal ASM_OPERATION(AddOrAdcSbbAndSubXorCmpRom)
 {
 	ParseIsWideIsOp1Dest(currentByte);
 	u8 index = (currentByte >> 3) & 0x7;
-	char *instruction[8] = { "add", "or", "adc", "sbb", "and", "sub", "xor", "cmp" };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = arithmeticMnemonics[index];
 
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte);
-	if (mod == 3)
-	{
-		ToInstructionLine(outputLine, instruction[index],
-		                  regsAll[isWide][reg], regsAll[isWide][rnm],
-		                  isOp1Dest);
-	}
-	else
+	instruction_operand source = RegisterOperand(isWide, rnm);
+	if (mod != 3)
 	{
-		ParseEffectiveAddressString(strEffectiveAddress);
-		ToInstructionLine(outputLine, instruction[index],
-		                  regsAll[isWide][reg], strEffectiveAddress->data,
-		                  isOp1Dest);
+		ParseEffectiveAddressOperand(source);
 	}
+	SetOperands(decoded, RegisterOperand(isWide, reg), source, isOp1Dest);
 }
 
 internal ASM_OPERATION(AddOrAdcSbbAndSubXorCmpImmediate)
@@ -512,50 +516,44 @@ internal ASM_OPERATION(AddOrAdcSbbAndSubXorCmpImmediate)
 	//sw = 01; 16-bit
 	//sw = 10; 8-bit, no sign extension
 	//sw = 11; 8-bit, sign-extended to 16-bit
-	//NOTE (Aske): Since we're only decoding to strings, we only care about bit size
 	b32 isWide = currentByte & 0x1;
 	b32 is16bit = (currentByte & 0x3) == 1; //s=0, w=1
 	b32 isSignExtended = (currentByte >> 1) & 0x1;
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte); //NOTE (Aske): reg is the instruction index here
 	Assert((!isSignExtended) || (reg != 1 && reg != 4 & reg != 6)); //or, and, xor cannot be sign-extended
-	char *instruction[8] = { "add", "or", "adc", "sbb", "and", "sub", "xor", "cmp" };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = arithmeticMnemonics[reg];
+	decoded->flags |= isWide ? InstructionFlag_wide : 0;
 
-	char *destination;
-	string_buffer *specifiedSize = PushStringBuffer(decoderState->ScratchPad, specifiedSize, 6);
 	if (mod == 3)
 	{
-		destination = regsAll[isWide][rnm];
-		Assert(!*specifiedSize->base);
+		decoded->operand1 = RegisterOperand(isWide, rnm);
 	}
 	else
 	{
-		ParseEffectiveAddressString(strEffectiveAddress);
-		destination = strEffectiveAddress->data;
-		FormatStringBufferFromBase(specifiedSize, (isWide ? "word " : "byte "));
+		ParseEffectiveAddressOperand(decoded->operand1);
+		decoded->operand1.flags = OperandFlag_sized;
 	}
 
-	s16 data;
 	if (is16bit)
 	{
 		u8 lo = GetNextByte(binaryInputFile);
 		u8 hi = GetNextByte(binaryInputFile);
-		data = CastU8HiLoToS16(lo, hi);
+		decoded->immediate = CastU8HiLoToS16(lo, hi);
 	}
 	else
 	{
 		s8 lo = GetNextByte(binaryInputFile);
-		data = lo;
+		decoded->immediate = lo;
 	}
-	FormatStringBufferFromBase(outputLine, "%s %s%s, %hd\n",
-	                           instruction[reg], specifiedSize->data, destination, data);
+	decoded->operand2 = Operand(Operand_immediate, 0);
 }
 
 internal ASM_OPERATION(AddOrAdcSbbAndSubXorCmpAccumulator)
 {
 	b32 isWide = (currentByte & 0x1);
 	u8 index = (currentByte >> 3) & 0x7;
-	char *instruction[8] = { "add", "or", "adc", "sbb", "and", "sub", "xor", "cmp" };
 	s8 lo, hi;
 	s16 data = lo = GetNextByte(binaryInputFile);
 	if (isWide)
@@ -564,8 +562,11 @@ internal ASM_OPERATION(AddOrAdcSbbAndSubXorCmpAccumulator)
 		data = ((hi & 0xff) << 8) | (lo & 0xff); //NOTE (Aske): &0xff to prevent sign extension
 	}
 
-	FormatStringBufferFromBase(outputLine, "%s %s, %hd\n", instruction[index],
-	                           (isWide ? "ax" : "al"), data);
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = arithmeticMnemonics[index];
+	decoded->immediate = data;
+	decoded->operand1 = RegisterOperand(isWide, 0);
+	decoded->operand2 = Operand(Operand_immediate, 0);
 }
 
 internal ASM_OPERATION(IncDecRom8)
@@ -574,24 +575,26 @@ internal ASM_OPERATION(IncDecRom8)
 	ParseModRegRnm(currentByte);
 
 	Assert(reg <= 1); //2-7 not used
-	char *instruction[8] = { "inc", "dec", "NOT USED", "NOT USED", "NOT USED", "NOT USED", "NOT USED", "NOT USED" };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = (reg == 0) ? Mnemonic_inc : (reg == 1) ? Mnemonic_dec : Mnemonic_notUsed;
 	
 	if (mod == 3)
 	{
-		FormatStringBufferFromBase(outputLine, "%s %s\n", instruction[reg], regs8bit[rnm]);
+		decoded->operand1 = Operand(Operand_register8, rnm);
 	}
 	else
 	{
-		ParseEffectiveAddressString(strEffectiveAddress);
-		FormatStringBufferFromBase(outputLine, "%s byte %s\n", instruction[reg], strEffectiveAddress->data);
+		ParseEffectiveAddressOperand(decoded->operand1);
+		decoded->operand1.flags = OperandFlag_sized;
 	}
 }
 
 internal ASM_OPERATION(DaaDasAaaAas)
 {
 	u8 index = (currentByte >> 3) & 0x3;
-	char *instruction[4] = { "daa", "das", "aaa", "aas" };
-	FormatStringBufferFromBase(outputLine, "%s\n", instruction[index]);
+	u8 instruction[4] = { Mnemonic_daa, Mnemonic_das, Mnemonic_aaa, Mnemonic_aas };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[index];
 }
 
 internal ASM_OPERATION(TestNotNegMulImulDivIdivRomImmediate)
@@ -600,52 +603,36 @@ internal ASM_OPERATION(TestNotNegMulImulDivIdivRomImmediate)
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte); //NOTE (Aske): reg is the instruction index here
 	Assert(reg != 1);
-	char *instruction[8] = { "test", "NOT USED", "not", "neg", "mul", "imul", "div", "idiv" };
+	u8 instruction[8] = { Mnemonic_test, Mnemonic_notUsed, Mnemonic_not, Mnemonic_neg,
+	                      Mnemonic_mul, Mnemonic_imul, Mnemonic_div, Mnemonic_idiv };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[reg];
+	decoded->flags |= isWide ? InstructionFlag_wide : 0;
 	
-	if (!reg) //Test immediate
+	if (mod == 3)
 	{
-		char *destination;
-		string_buffer *specifiedSize = PushStringBuffer(decoderState->ScratchPad, specifiedSize, 6);
-		if (mod == 3)
-		{
-			destination = regsAll[isWide][rnm];
-			Assert(!*specifiedSize->base);
-		}
-		else
-		{
-			ParseEffectiveAddressString(strEffectiveAddress);
-			destination = strEffectiveAddress->data;
-			FormatStringBufferFromBase(specifiedSize, (isWide ? "word " : "byte "));
-		}
+		decoded->operand1 = RegisterOperand(isWide, rnm);
+	}
+	else
+	{
+		ParseEffectiveAddressOperand(decoded->operand1);
+		decoded->operand1.flags = OperandFlag_sized;
+	}
 
-		s16 data;
+	if (!reg) //Test immediate
+	{
 		if (isWide)
 		{
 			u8 lo = GetNextByte(binaryInputFile);
 			u8 hi = GetNextByte(binaryInputFile);
-			data = CastU8HiLoToS16(lo, hi);
+			decoded->immediate = CastU8HiLoToS16(lo, hi);
 		}
 		else
 		{
 			s8 lo = GetNextByte(binaryInputFile);
-			data = lo;
-		}
-		FormatStringBufferFromBase(outputLine, "test %s%s, %hd\n",
-		                           specifiedSize->data, destination, data);
-	}
-	else //All other Reg/Mem ops
-	{
-		if (mod == 3)
-		{
-			FormatStringBufferFromBase(outputLine, "%s %s\n", 
-			                           instruction[reg], regsAll[isWide][rnm]);
-		}
-		else
-		{
-			ParseEffectiveAddressString(strEffectiveAddress);
-			FormatStringBufferFromBase(outputLine, "%s %s %s\n", instruction[reg], 
-			                           (isWide ? "word" : "byte"), strEffectiveAddress->data);
+			decoded->immediate = lo;
 		}
+		decoded->operand2 = Operand(Operand_immediate, 0);
 	}
 }
 
@@ -653,8 +640,9 @@ internal ASM_OPERATION(AamAad)
 {
 	b32 isForDivide = currentByte & 0x1;
 	currentByte = GetNextByte(binaryInputFile);
-	Assert(currentByte == 0xa);
-	FormatStringBufferFromBase(outputLine, "%s\n", isForDivide ? "aad" : "aam");
+	Assert(IsPastEndOfInput(binaryInputFile) || (currentByte == 0xa));
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = isForDivide ? Mnemonic_aad : Mnemonic_aam;
 }
 
 internal ASM_OPERATION(RolRorRclRcrSalShlShrSar)
@@ -669,20 +657,30 @@ internal ASM_OPERATION(RolRorRclRcrSalShlShrSar)
 	//sal is arithmetic and shl is logical.
 	//The former could imply a signed number, and unsigned for the latter.
 	//But since both left shifts ignore the sign bit, I defaulted to logical.
-	char *instruction[8] = { "rol", "ror", "rcl", "rcr", "shl", "shr", "NOT USED", "sar" };
+	u8 instruction[8] = { Mnemonic_rol, Mnemonic_ror, Mnemonic_rcl, Mnemonic_rcr,
+	                      Mnemonic_shl, Mnemonic_shr, Mnemonic_notUsed, Mnemonic_sar };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[reg];
+	decoded->flags |= isWide ? InstructionFlag_wide : 0;
 
 	if (mod == 3)
 	{
-		FormatStringBufferFromBase(outputLine, "%s %s, %s\n",
-		                           instruction[reg], regsAll[isWide][rnm],
-		                           (isCountClSpecified ? "cl" : "1"));
+		decoded->operand1 = RegisterOperand(isWide, rnm);
+	}
+	else
+	{
+		ParseEffectiveAddressOperand(decoded->operand1);
+		decoded->operand1.flags = OperandFlag_sized;
+	}
+
+	if (isCountClSpecified)
+	{
+		decoded->operand2 = Operand(Operand_register8, 1);
 	}
 	else
 	{
-		ParseEffectiveAddressString(strEffectiveAddress);
-		FormatStringBufferFromBase(outputLine, "%s %s %s, %s\n", instruction[reg], 
-		                           (isWide ? "word" : "byte"), strEffectiveAddress->data,
-		                           (isCountClSpecified ? "cl" : "1"));
+		decoded->immediate = 1;
+		decoded->operand2 = Operand(Operand_immediate, 0);
 	}
 }
 
@@ -703,8 +701,11 @@ internal ASM_OPERATION(TestAccumulator)
 		data = lo;
 	}
 
-	FormatStringBufferFromBase(outputLine, "test %s, %hd\n",
-	                           (isWide ? "ax" : "al"), data);
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = Mnemonic_test;
+	decoded->immediate = data;
+	decoded->operand1 = RegisterOperand(isWide, 0);
+	decoded->operand2 = Operand(Operand_immediate, 0);
 }
 
 internal ASM_OPERATION(RepneRepHltCmc)
@@ -721,16 +722,19 @@ internal ASM_OPERATION(RepneRepHltCmc)
 	u8 index = currentByte & 0x7;
 	Assert(index >= 2 && index <= 5);
 
-	char *instruction[8] = { "NOT USED", "NOT USED", "repn", "rep", "hlt\n", "cmc\n", "NOT USED", "NOT USED" };
+	u8 instruction[8] = { Mnemonic_notUsed, Mnemonic_notUsed, Mnemonic_repn, Mnemonic_rep,
+	                      Mnemonic_hlt, Mnemonic_cmc, Mnemonic_notUsed, Mnemonic_notUsed };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[index];
 	if (index <= 3)
 	{
 		b32 whenZeroFlagIsSet = currentByte & 0x1;
 		decoderState->RepeatState = whenZeroFlagIsSet ?
 			State_repeat_when_zf_set : State_repeat_when_zf_clear;
 		decoderState->endedWithNewLine = false;
+		decoded->instructionClass = InstructionClass_repeatPrefix;
 	}
 
-	FormatStringBufferFromBase(outputLine, instruction[index]);
 	//TODO (Aske): Should this be merged with MovsCmpsStosLodsScas?
 	//Removing state and also assuming that it's not possible/plausible
 	//to compile rep without a following string instruction
@@ -744,35 +748,21 @@ internal ASM_OPERATION(MovsCmpsStosLodsScas)
 	u8 index = currentByte & 0xf;
 	Assert(index >= 4 && index != 8 && index != 9);
 
-	char *instruction[16] =
+	u8 instruction[16] =
 	{
-		"NOT USED", "NOT USED", "NOT USED", "NOT USED",
-		"movsb", 	"movsw", 	"cmpsb", 	"cmpsw",
-		"NOT USED", "NOT USED", "stosb", 	"stosw",
-		"lodsb", 	"lodsw", 	"scasb", 	"scasw"
+		Mnemonic_notUsed, Mnemonic_notUsed, Mnemonic_notUsed, Mnemonic_notUsed,
+		Mnemonic_movsb, 	Mnemonic_movsw, 	Mnemonic_cmpsb, 	Mnemonic_cmpsw,
+		Mnemonic_notUsed, Mnemonic_notUsed, Mnemonic_stosb, 	Mnemonic_stosw,
+		Mnemonic_lodsb, 	Mnemonic_lodsw, 	Mnemonic_scasb, 	Mnemonic_scasw
 	};
 
-	string_buffer *repPrefix = PushStringBuffer(decoderState->ScratchPad, repPrefix, 2);
-	if (index == 6 || index == 7) //cmps
-	{
-		FormatStringBufferFromBase(repPrefix, "e");
-	}
-	else if (index == 14 || index == 15)  //scas
-	{
-		FormatStringBufferFromBase(repPrefix, "z");
-	}
-	else if (decoderState->RepeatState == State_repeat_when_zf_clear)
-	{
-		//NOTE (Aske): REP + z=0 doesn't make sense for unconditional instructions
-		Assert(!"Undefined behavior!");
-		FormatStringBufferFromBase(repPrefix, "e");
-	}
-	else
-	{
-		Assert(!*repPrefix->base);
-	}
+	//NOTE (Aske): REP + z=0 doesn't make sense for unconditional instructions
+	Assert(index == 6 || index == 7 || index == 14 || index == 15 ||
+	       decoderState->RepeatState != State_repeat_when_zf_clear);
 
-	FormatStringBufferFromBase(outputLine, "%s %s\n", repPrefix->data, instruction[index]);
+	decoded->instructionClass = InstructionClass_stringOperation;
+	decoded->mnemonic = instruction[index];
+	decoded->repeatPrefix = (u8)decoderState->RepeatState;
 	decoderState->RepeatState = State_repeat_none;
 }
 
@@ -783,39 +773,23 @@ internal ASM_OPERATION(CallJumpDirectIntrasegment16)
 	u8 hi = GetNextByte(binaryInputFile);
 	s16 ipInc = CastU8HiLoToS16(lo, hi);
 	//NOTE (Aske): jmp NEAR-LABEL needs to be farther than -128 to +127 bytes from instruction
-	Assert(!index || ipInc >= 128  || ipInc < -128);
-	char *instruction[2] = { "call", "jmp" };
+	Assert(!index || ipInc >= 128  || ipInc < -128 || IsPastEndOfInput(binaryInputFile));
+	u8 instruction[2] = { Mnemonic_call, Mnemonic_jmp };
+	decoded->instructionClass = InstructionClass_branch;
+	decoded->mnemonic = instruction[index];
 
 	//TODO (Aske): Verify it's not +2 (and thus relative to the start of this instruction)
-	u64 absoluteAddress = binaryInputFile->CurrentIndex + 1 + ipInc;
-	Assert((binaryInputFile->CurrentIndex + 1 + ipInc) <= Sint16Max);
-	Assert(absoluteAddress >= 0);
-#if LABEL_PADDING
-	
+	s64 absoluteAddress = binaryInputFile->CurrentIndex + 1 + ipInc;
 	//TODO (Aske): Should we write the label in the OutputPool if it's backwardOffset (ipInc < 0)?
 	//It would potentially reduce the lookup time in backwardOffsets
 	//But it may require duplicate logic for writing, and requires access to the OutputPool
-	if (absoluteAddress < binaryInputFile->ContentsSize)
-	{
-		ArrayLabelPosAdd(decoderState->postPassOffsets, absoluteAddress, 0);
-		FormatStringBufferFromBase(outputLine, "%s label__%d\n", instruction[index], absoluteAddress);
-	}
-	else
-	{
-		FormatStringBufferFromBase(outputLine, "%s %d\n", instruction[index], absoluteAddress);
-	}
-#elif LABEL_FIRST_PASS
-	//TODO (Aske): Replace absoluteAddress with label lookup from a first pass
-#else
-	FormatStringBufferFromBase(outputLine, "%s %u\n", instruction[index], absoluteAddress);
-	printf("near-label at %llu\n", absoluteAddress);
-#endif
+	SetBranchTarget(decoderState, decoded, binaryInputFile, absoluteAddress);
 }
 
 internal ASM_OPERATION(CallJumpDirectIntersegment)
 {
 	u8 index = (currentByte >> 4) & 0x1;
-	char *instruction[2] = { "jmp", "call" };
+	u8 instruction[2] = { Mnemonic_jmp, Mnemonic_call };
 
 	u8 olo = GetNextByte(binaryInputFile);
 	u8 ohi = GetNextByte(binaryInputFile);
@@ -825,7 +799,10 @@ internal ASM_OPERATION(CallJumpDirectIntersegment)
 	u8 shi = GetNextByte(binaryInputFile);
 	u16 segment = ((u16)shi << 8) | slo;
 
-	FormatStringBufferFromBase(outputLine, "%s %hd:%hu\n", instruction[index], segment, offset);
+	decoded->instructionClass = InstructionClass_farBranch;
+	decoded->mnemonic = instruction[index];
+	decoded->immediate = segment;
+	decoded->target = offset;
 }
 
 internal ASM_OPERATION(JumpDirectIntrasegment8)
@@ -835,42 +812,23 @@ internal ASM_OPERATION(JumpDirectIntrasegment8)
 
 	s64 absoluteAddress = binaryInputFile->CurrentIndex + 1 + ipInc;
 	Assert(absoluteAddress >= 0);
-	Assert(absoluteAddress <= Sint32Max); //TODO (Aske): Plausibly "<= Sint16Max" instead? Untested
-#if LABEL_PADDING
-	
-	if (absoluteAddress < binaryInputFile->ContentsSize)
-	{
-		ArrayLabelPosAdd(decoderState->postPassOffsets, absoluteAddress, 0);
-		FormatStringBufferFromBase(outputLine, "jmp short label__%d\n", absoluteAddress);
-	}
-	else
-	{
-		FormatStringBufferFromBase(outputLine, "jmp short %d\n", absoluteAddress);
-	}
-#elif LABEL_FIRST_PASS
-	//TODO (Aske): Replace absoluteAddress with label lookup from a first pass
-#else 
-	FormatStringBufferFromBase(outputLine, "jmp short %u\n", absoluteAddress);
-	printf("short label at %lld\n", absoluteAddress);
-#endif
+	decoded->instructionClass = InstructionClass_branch;
+	decoded->mnemonic = Mnemonic_jmpShort;
+	SetBranchTarget(decoderState, decoded, binaryInputFile, absoluteAddress);
 }
 
 internal ASM_OPERATION(RetIntraIntersegment)
 {
 	b32 isAlone = currentByte & 0x1;
 	b32 isIntersegment = (currentByte >> 3) & 0x1;
-	char *instruction[2] = { "ret", "retf" };
-	if (isAlone)
-	{
-		FormatStringBufferFromBase(outputLine, "%s\n", instruction[isIntersegment]);
-	}
-	else //adding immediate to SP
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = isIntersegment ? Mnemonic_retf : Mnemonic_ret;
+	if (!isAlone) //adding immediate to SP
 	{
 		u8 lo = GetNextByte(binaryInputFile);
 		u8 hi = GetNextByte(binaryInputFile);
-		s16 data = CastU8HiLoToS16(lo, hi);
-
-		FormatStringBufferFromBase(outputLine, "%s %hd\n", instruction[isIntersegment], data);
+		decoded->immediate = CastU8HiLoToS16(lo, hi);
+		decoded->operand1 = Operand(Operand_immediate, 0);
 	}
 }
 
@@ -878,80 +836,50 @@ internal ASM_OPERATION(AllJumps)
 {
 	u8 index = currentByte & 0xf;
 
-	char *instruction[16] =
-	{ /*           jnae/jc jae/jnc jz    jnz    jna   jnbe */
-		"jo", "jno", "jb", "jnb", "je", "jne", "jbe", "ja",
-		"js", "jns", "jp", "jnp", "jl", "jnl", "jle", "jg"
-	};/*              jpe   jpo   jnge   jge    jng   jnle */
+	u8 instruction[16] =
+	{ /*                                jnae/jc      jae/jnc      jz           jnz          jna          jnbe */
+		Mnemonic_jo, Mnemonic_jno, Mnemonic_jb, Mnemonic_jnb, Mnemonic_je, Mnemonic_jne, Mnemonic_jbe, Mnemonic_ja,
+		Mnemonic_js, Mnemonic_jns, Mnemonic_jp, Mnemonic_jnp, Mnemonic_jl, Mnemonic_jnl, Mnemonic_jle, Mnemonic_jg
+	};/*                          jpe          jpo          jnge         jge          jng          jnle */
 
 	s8 relativeAddress = GetNextByte(binaryInputFile);
 
-#if LABEL_PADDING
 	s64 absoluteAddress = binaryInputFile->CurrentIndex + 1 + relativeAddress;
 	Assert(absoluteAddress >= 0);
-
-	if (absoluteAddress < binaryInputFile->ContentsSize)
-	{
-		ArrayLabelPosAdd(decoderState->postPassOffsets, absoluteAddress, 0);
-		FormatStringBufferFromBase(outputLine, "%s label__%d\n", instruction[index], absoluteAddress);
-	}
-	else
-	{
-		FormatStringBufferFromBase(outputLine, "%s $+2%+d\n", instruction[index], relativeAddress);
-	}
-#elif LABEL_FIRST_PASS
-	//TODO (Aske): Replace absoluteAddress with label lookup from a first pass
-#else //$ operator is NASM functionality
-	FormatStringBufferFromBase(outputLine, "%s $+2%+d\n", instruction[index], relativeAddress);
-	printf("relative label at %lld\n", binaryInputFile->CurrentIndex - relativeAddress);
-#endif
+	decoded->instructionClass = InstructionClass_relativeBranch;
+	decoded->mnemonic = instruction[index];
+	SetBranchTarget(decoderState, decoded, binaryInputFile, absoluteAddress);
 }
 
 internal ASM_OPERATION(LoopLoopeLoopneJcxz)
 {
 	u8 index = currentByte & 0x3;
 
-	/*                        loopnz    loopz */
-	char *instruction[4] = { "loopne", "loope", "loop", "jcxz" };
+	/*                                           loopnz           loopz */
+	u8 instruction[4] = { Mnemonic_loopne, Mnemonic_loope, Mnemonic_loop, Mnemonic_jcxz };
 
 	s8 lo = GetNextByte(binaryInputFile);
 	s16 relativeAddress = lo;
 
-#if LABEL_PADDING
 	s64 absoluteAddress = binaryInputFile->CurrentIndex + 1 + relativeAddress;
 	Assert(absoluteAddress >= 0);
-
-	if (absoluteAddress < binaryInputFile->ContentsSize)
-	{
-		ArrayLabelPosAdd(decoderState->postPassOffsets, absoluteAddress, 0);
-		FormatStringBufferFromBase(outputLine, "%s label__%u\n", instruction[index], absoluteAddress);
-	}
-	else
-	{
-		FormatStringBufferFromBase(outputLine, "%s $+2%+d\n", instruction[index], relativeAddress);
-	}
-#elif LABEL_FIRST_PASS
-	//TODO (Aske): Replace absoluteAddress with label lookup from a first pass
-#else //$ operator is NASM functionality
-	FormatStringBufferFromBase(outputLine, "%s $+2%+d\n", instruction[index], relativeAddress);
-	printf("relative label at %lld\n", binaryInputFile->CurrentIndex - relativeAddress);
-#endif
+	decoded->instructionClass = InstructionClass_relativeBranch;
+	decoded->mnemonic = instruction[index];
+	SetBranchTarget(decoderState, decoded, binaryInputFile, absoluteAddress);
 }
 
 internal ASM_OPERATION(IntIntoIret)
 {
 	u8 index = currentByte & 0x3;
 
-	char *instruction[4] = { "int3", "int", "into", "iret" };
+	u8 instruction[4] = { Mnemonic_int3, Mnemonic_int, Mnemonic_into, Mnemonic_iret };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[index];
 	
 	if (index == 1)
 	{
-		u8 interruptType = GetNextByte(binaryInputFile);
-		FormatStringBufferFromBase(outputLine, "int %hhu\n", interruptType);
-	}
-	else
-	{
-		FormatStringBufferFromBase(outputLine, "%s\n", instruction[index]);
+		decoded->immediate = GetNextByte(binaryInputFile);
+		decoded->operand1 = Operand(Operand_unsignedByte, 0);
 	}
 }
 
@@ -959,9 +887,10 @@ internal ASM_OPERATION(ClcStcCliStiCldStd)
 {
 	u8 index = currentByte & 0x7;
 	Assert(index <= 5);
-	char *instruction[8] = { "clc", "stc", "cli", "sti", "cld", "std", "NOT USED", "NOT USED" };
-
-	FormatStringBufferFromBase(outputLine, "%s\n", instruction[index]);
+	u8 instruction[8] = { Mnemonic_clc, Mnemonic_stc, Mnemonic_cli, Mnemonic_sti,
+	                      Mnemonic_cld, Mnemonic_std, Mnemonic_notUsed, Mnemonic_notUsed };
+	decoded->instructionClass = InstructionClass_operation;
+	decoded->mnemonic = instruction[index];
 }
 
 //NOTE (Aske): Not supported by NASM, as far as I can tell.
@@ -971,330 +900,123 @@ internal ASM_OPERATION(Escape)
 	u8 externalOpcode = currentByte & 0x7;
 	currentByte = GetNextByte(binaryInputFile);
 	ParseModRegRnm(currentByte); //NOTE (Aske): reg = source
+	decoded->instructionClass = InstructionClass_escape;
+	decoded->mnemonic = Mnemonic_esc;
+	decoded->immediate = externalOpcode;
+	decoded->operand1 = Operand(Operand_unsignedByte, 0);
 
 	//NOTE (Aske): I'm not sure the "source" is correct. I've been unable to verify it.
 	if (mod == 3)
 	{
-		FormatStringBufferFromBase(outputLine, "esc %hhu %s\n", externalOpcode, regs8bit[reg]);
+		decoded->operand2 = Operand(Operand_register8, reg);
 	}
 	else
 	{
-		ParseEffectiveAddressString(strEffectiveAddress);
-		FormatStringBufferFromBase(outputLine, "esc %hhu %s\n", externalOpcode, strEffectiveAddress->data);
+		ParseEffectiveAddressOperand(decoded->operand2);
 	}
 }
 
 internal ASM_OPERATION(LockPrefix)
 {
 	//TODO (Aske): Set state to decoder?
-	FormatStringBufferFromBase(outputLine, "lock ");
+	decoded->instructionClass = InstructionClass_lockPrefix;
+	decoded->mnemonic = Mnemonic_lock;
 	decoderState->endedWithNewLine = false;
 }
 
 internal ASM_OPERATION(SegmentPrefix)
 {
 	u8 index = (currentByte >> 3) & 0x3;
-	char *instruction[4] = { "es:", "cs:", "ss:", "ds:" };
-	FormatStringBufferFromBase(decoderState->SegmentOverridePrefix, instruction[index]);
+	decoded->instructionClass = InstructionClass_segmentPrefix;
+	decoderState->segmentOverride = 1 + index;
 	decoderState->endedWithNewLine = false;
 }
 
-//NOTE (Aske): Trying to be parallel with Table 4-13 in 8086 1979 user's manual (p. 169):
-internal void InitializeAsmOpsTable()
-{
-	for (u8 i = 0x00; i <= 0x03; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpRom;
-	for (u8 i = 0x04; i <= 0x05; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpAccumulator;
-	for (u8 i = 0x06; i <= 0x07; ++i) asmOps[i] = PushPopSegreg;
-	for (u8 i = 0x08; i <= 0x0b; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpRom;
-	for (u8 i = 0x0c; i <= 0x0d; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpAccumulator;
-	asmOps[0x0e]                                = PushPopSegreg;
-	asmOps[0x0f]                                = OpNotUsed;
-	for (u8 i = 0x10; i <= 0x13; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpRom;
-	for (u8 i = 0x14; i <= 0x15; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpAccumulator;
-	for (u8 i = 0x16; i <= 0x17; ++i) asmOps[i] = PushPopSegreg;
-	for (u8 i = 0x18; i <= 0x1b; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpRom;
-	for (u8 i = 0x1c; i <= 0x1d; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpAccumulator;
-	for (u8 i = 0x1e; i <= 0x1f; ++i) asmOps[i] = PushPopSegreg;
-	for (u8 i = 0x20; i <= 0x23; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpRom;
-	for (u8 i = 0x24; i <= 0x25; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpAccumulator;
-	asmOps[0x26]                                = SegmentPrefix;
-	asmOps[0x27]                                = DaaDasAaaAas;
-	for (u8 i = 0x28; i <= 0x2b; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpRom;
-	for (u8 i = 0x2c; i <= 0x2d; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpAccumulator;
-	asmOps[0x2e]                                = SegmentPrefix;
-	asmOps[0x2f]                                = DaaDasAaaAas;
-	for (u8 i = 0x30; i <= 0x33; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpRom;
-	for (u8 i = 0x34; i <= 0x35; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpAccumulator;
-	asmOps[0x36]                                = SegmentPrefix;
-	asmOps[0x37]                                = DaaDasAaaAas;
-	for (u8 i = 0x38; i <= 0x3b; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpRom;
-	for (u8 i = 0x3c; i <= 0x3d; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpAccumulator;
-	asmOps[0x3e]                                = SegmentPrefix;
-	asmOps[0x3f]                                = DaaDasAaaAas;
-	for (u8 i = 0x40; i <= 0x5f; ++i) asmOps[i] = IncDecPushPop;
-	for (u8 i = 0x60; i <= 0x6f; ++i) asmOps[i] = OpNotUsed;
-	for (u8 i = 0x70; i <= 0x7f; ++i) asmOps[i] = AllJumps;
-	for (u8 i = 0x80; i <= 0x83; ++i) asmOps[i] = AddOrAdcSbbAndSubXorCmpImmediate;
-	for (u8 i = 0x84; i <= 0x87; ++i) asmOps[i] = TestXchgRom;
-	for (u8 i = 0x88; i <= 0x8b; ++i) asmOps[i] = MovRom;
-	asmOps[0x8c]                                = MovSegreg;
-	asmOps[0x8d]                                = LeaLesLdsRom16;
-	asmOps[0x8e]                                = MovSegreg;
-	asmOps[0x8f]                                = PopRom16;
-	for (u8 i = 0x90; i <= 0x97; ++i) asmOps[i] = XchgAccReg16;
-	for (u8 i = 0x98; i <= 0x99; ++i) asmOps[i] = CbwCwdWaitPushfPopfSahfLahf;
-	asmOps[0x9a]                                = CallJumpDirectIntersegment;
-	for (u8 i = 0x9b; i <= 0x9f; ++i) asmOps[i] = CbwCwdWaitPushfPopfSahfLahf;
-	for (u8 i = 0xa0; i <= 0xa3; ++i) asmOps[i] = MovMemAccumulator;
-	for (u8 i = 0xa4; i <= 0xa7; ++i) asmOps[i] = MovsCmpsStosLodsScas;
-	for (u8 i = 0xa8; i <= 0xa9; ++i) asmOps[i] = TestAccumulator;
-	for (u8 i = 0xaa; i <= 0xaf; ++i) asmOps[i] = MovsCmpsStosLodsScas;
-	for (u8 i = 0xb0; i <= 0xbf; ++i) asmOps[i] = MovImmToRegister;
-	for (u8 i = 0xc0; i <= 0xc1; ++i) asmOps[i] = OpNotUsed;
-	for (u8 i = 0xc2; i <= 0xc3; ++i) asmOps[i] = RetIntraIntersegment;
-	for (u8 i = 0xc4; i <= 0xc5; ++i) asmOps[i] = LeaLesLdsRom16;
-	for (u8 i = 0xc6; i <= 0xc7; ++i) asmOps[i] = MovImmToMemory;
-	for (u8 i = 0xc8; i <= 0xc9; ++i) asmOps[i] = OpNotUsed;
-	for (u8 i = 0xca; i <= 0xcb; ++i) asmOps[i] = RetIntraIntersegment;
-	for (u8 i = 0xcc; i <= 0xcf; ++i) asmOps[i] = IntIntoIret;
-	for (u8 i = 0xd0; i <= 0xd3; ++i) asmOps[i] = RolRorRclRcrSalShlShrSar;
-	for (u8 i = 0xd4; i <= 0xd5; ++i) asmOps[i] = AamAad;
-	asmOps[0xd6]                                = OpNotUsed;
-	asmOps[0xd7]                                = Xlat;
-	for (u8 i = 0xd8; i <= 0xdf; ++i) asmOps[i] = Escape;
-	for (u8 i = 0xe0; i <= 0xe3; ++i) asmOps[i] = LoopLoopeLoopneJcxz;
-	for (u8 i = 0xe4; i <= 0xe7; ++i) asmOps[i] = InOutFixedPort8;
-	for (u8 i = 0xe8; i <= 0xe9; ++i) asmOps[i] = CallJumpDirectIntrasegment16;
-	asmOps[0xea]                                = CallJumpDirectIntersegment;
-	asmOps[0xeb]                                = JumpDirectIntrasegment8;
-	for (u8 i = 0xec; i <= 0xef; ++i) asmOps[i] = InOutVariablePort;
-	asmOps[0xf0]                                = LockPrefix;
-	asmOps[0xf1]                                = OpNotUsed;
-	for (u8 i = 0xf2; i <= 0xf5; ++i) asmOps[i] = RepneRepHltCmc;
-	for (u8 i = 0xf6; i <= 0xf7; ++i) asmOps[i] = TestNotNegMulImulDivIdivRomImmediate;
-	for (u8 i = 0xf8; i <= 0xfd; ++i) asmOps[i] = ClcStcCliStiCldStd;
-	asmOps[0xfe]                                = IncDecRom8;
-	asmOps[0xff]                                = IncDecCallJmpPushRom16;
-
-	for (s16 i = 0x00; i <= 0xff; ++i) Assert(asmOps[i]);
-}
+#include "opcode_table.cpp"
 
 #if LABEL_FIRST_PASS
 #include "label_pass.cpp"
 #endif
 
-int main(int argc, char* argv[])
-{
-	char* binaryFilePath = argc > 1 ? argv[1] : "..\\data\\listing_0042_completionist_decode";
-	char* outputAsmFileName = argc > 2 ? argv[2] : "..\\data\\test42.asm";
-
-#ifdef ASH_INTERNAL
-	LPVOID baseAddress = (LPVOID)Terabytes(2);
-#else
-	LPVOID baseAddress = 0;
-#endif
-
-	size_t outputMaxSize = Megabytes(16);
-	size_t scratchPadSize = Megabytes(17);
-	//Auto-zeroed
-	void* allocatedMemory = VirtualAlloc(baseAddress,
-	                                     outputMaxSize + scratchPadSize,
-	                                     MEM_COMMIT | MEM_RESERVE,
-	                                     PAGE_READWRITE);
-
-	memory_arena outputPool = {};
-	outputPool.base = (u8 *)allocatedMemory;
-	Assert(outputPool.base != 0);
-	outputPool.size = outputMaxSize;
-
-	memory_arena scratchPad = {};
-	scratchPad.base = (u8 *)allocatedMemory + outputMaxSize;
-	Assert(scratchPad.base != 0);
-	scratchPad.size = scratchPadSize;
-
-	//'x' 's' ':' '\0'
-	string_buffer *segmentOverridePrefix = PushStringBuffer(&scratchPad, segmentOverridePrefix, 4);
-	
-	decoder_state decoderState = {};
-	decoderState.ScratchPad = &scratchPad;
-	decoderState.SegmentOverridePrefix = segmentOverridePrefix;
-
-	
-	debug_read_file_result file = ReadEntireFile(binaryFilePath);
-	void* entireBinary = file.Contents;
-	u32 binaryLengthInBytes = file.ContentsSize;
-
-	byte_of_file byteCursor;
-
-	/*
-	 * NOTE (Aske): I'm not sure how to handle labels.
-	 * My ideas were:
-	 * 1. while decoding labels, keep a list of all the label locations and all the instruction lines.
-	 * 		And when you've parsed all instructions,
-	 * 		do a second pass where you build the final string output, including labels, from both lists.
-	 * 
-	 * 2. to do a label pass first, locating all the label locations.
-	 * 		Keeping them in an array, that you may sort before use.
-	 * 		Labels are then added together with the instruction pass.
-	 * 
-	 * 3. before every (full) instruction line, add enough room for a label,
-	 * 		and (over)write that label when encountered.
-	 * 		You might keep the "label space" locations in an expanding array.
-	 * 
-	 * I first went with idea 2, but thought it was too complicated so I went with idea 3 instead.
-	 * Idea 1 might be even simpler, but it felt like a solution from GC'ed languages that treat
-	 * "inserting" strings into other strings without concern for its cost. I wanted to not do that.
-	 * But now that I'm done, I'm not sure idea 3 really was less complicated or efficient.
-	* */
-#if LABEL_FIRST_PASS
-	array_s32 *labelDefinitions = PushPolyArray(&scratchPad, labelDefinitions, Megabytes(7), s32);
-	decoderState.labelAtByte = labelDefinitions;
-	InitializeLabelPassTable();
+#if LABEL_PADDING
+#include "listing_index.cpp"
 
-	while ((byteCursor = GetNextOpsByte(&file)).isValid)
+//NOTE (Aske): The label is padded with spaces to fill the entire label space,
+//so the trimming pass can find where the label ends.
+internal void WriteLabelIntoSpace(char *labelSpace, s64 byteAddress)
+{
+	format_cursor label = { labelSpaceSize, labelSpace };
+	EmitString(&label, "label__", 7);
+	EmitSigned(&label, byteAddress, false);
+	EmitString(&label, ":\n", 2);
+	size_t labelLength = label.at - labelSpace;
+	Assert(labelLength < labelSpaceSize);
+	for (char *at = labelSpace + labelLength; at < labelSpace + labelSpaceSize; ++at)
 	{
-		u8 currentByte = byteCursor.byte;
-		//TODO (Aske): Assert rep states (f2-f5) follow a string instruction (a4-a7, aa-af)
-		lpOps[currentByte](&decoderState, &file, currentByte);
+		*at = ' ';
 	}
+}
 
-	file.CurrentIndex = 0; //NOTE (Aske): Reset cursor for second parse
-
-	//NOTE (Aske): Probably not necessary to clean up the scratchpad, but it's easy to do.
-	//If this was production code, we'd manage the memory differently anyway
-	size_t labelExcessBuffer = labelDefinitions->size - labelDefinitions->count;
-	PopSize(&scratchPad, labelExcessBuffer);
-	labelDefinitions->size = labelDefinitions->count;
-	
-	Array32MergeSort(labelDefinitions, &scratchPad);
-		
-	s64 labelIdx = 0;
-	s32 nextLabelByte = Array32Get(decoderState.labelAtByte, labelIdx);
-#elif LABEL_PADDING
-	//TODO (Aske): These needs a rename once the functionality is done
-	array_label_position *labelPosFromInstructionPass = PushPolyArray(&scratchPad,
-	                                                  labelPosFromInstructionPass, Megabytes(3), label_position);
-	labelPosFromInstructionPass->type = Type_label_backward;
-	array_label_position *forwardOffsets = PushPolyArray(&scratchPad, forwardOffsets, Megabytes(3), label_position);
-	labelPosFromInstructionPass->type = Type_label_forward;
-	decoderState.postPassOffsets = forwardOffsets;
-#endif
-	InitializeAsmOpsTable();
-
-	
-	//NOTE (Aske): 33000 is an arbitrary limit, guided by Windows
-	s64 binaryFilePathLength;
-	StringLengthBounded(binaryFilePath, 33000, &binaryFilePathLength);
-	size_t binaryFileNameOffset;
-	//NOTE (Aske): I'm not sure if I needed to handle both slash types. My MVP skills need practicing.
-	StringLastIndexOf2(binaryFilePath, binaryFilePathLength, '\\', '/', &binaryFileNameOffset);
-	//NOTE (Aske): remove slash from binaryFileNameOffset
-	size_t binaryFileNameLength = binaryFilePathLength - (++binaryFileNameOffset);
-	
-	string_buffer *sourceFileComment = PushStringBuffer(&scratchPad, sourceFileComment,
-	                                                    binaryFileNameLength + 3);
-	FormatStringBufferFromBase(sourceFileComment, ";%s\n", binaryFilePath + binaryFileNameOffset);
-	AppendAndPrint(&outputPool, &sourceFileComment->asString);
-
-	string enforce16BitAsm = { 8, "bits 16\n" };
-	decoderState.endedWithNewLine = true;
-	AppendAndPrint(&outputPool, &enforce16BitAsm);
-	while ((byteCursor = GetNextOpsByte(&file)).isValid)
+//NOTE (Aske): A truncated instruction isn't rendered, so a jump into it has no line for its label to go on.
+//Those labels are dropped before the last FinalizeOutput.
+internal void DropLabelsFrom(array_label_position *forwardOffsets, s64 byteAddress)
+{
+	s64 keptCount = 0;
+	for (label_position *it = forwardOffsets->base; it < forwardOffsets->base + forwardOffsets->count; ++it)
 	{
-		u8 b = byteCursor.byte; //currentByte
-		SaveArena(&scratchPad);
-		
-#if LABEL_FIRST_PASS
-		if (b == nextLabelByte)
-		{
-			string_buffer *label = PushStringBuffer(&scratchPad, label, 48);
-			FormatStringBufferFromBase(label, "\nlabel__%u:\n", file.CurrentIndex);
-			AppendAndPrint(&outputPool, &label->asString);
-
-			nextLabelByte = Array32Get(decoderState.labelAtByte, ++labelIdx);
-		}
-		else
-		{
-			while (b > nextLabelByte)
-			{
-				Assert(!"Skipped a label");
-				nextLabelByte = Array32Get(decoderState.labelAtByte, ++labelIdx);
-			}
-		}
-#elif LABEL_PADDING
-		if (decoderState.endedWithNewLine)
+		if (it->byteAddress < byteAddress)
 		{
-			label_position labelPos;
-
-			size_t stringPoolPos = outputPool.used;
-			//NOTE (Aske): The label is already established from previous forward-looking jumps
-			b32 isPrerequested = ArrayLabelPosFromFilebyte(forwardOffsets, file.CurrentIndex, &labelPos);
-			if (isPrerequested)
-			{
-				string *label = PushString(&scratchPad, label, labelSpaceSize);
-				label->count = FormatString(labelSpaceSize, label->data,
-				                             "label__%u:\n", file.CurrentIndex);
-				Assert(label->count == labelSpaceSize);
-
-				Append(&outputPool, label);
-			}
-			else // Make space for future backward-looking label references
-			{
-				//NOTE (Aske): We wouldn't need to Make sure there's room for a null-terminator
-				//if we didn't use 
-				string *labelSpace = PushString(&scratchPad, labelSpace, labelSpaceSize + 1);
-				labelSpace->count = FormatString(labelSpaceSize, labelSpace->data,
-				                                 "                    ");
-				Assert(labelSpace->count == labelSpaceSize);
-				
-				Append(&outputPool, labelSpace);
-			}
-			ArrayLabelPosAdd(labelPosFromInstructionPass, file.CurrentIndex, stringPoolPos);
+			forwardOffsets->base[keptCount++] = *it;
 		}
-		//NOTE (Aske): Most instructions end with \n
-		decoderState.endedWithNewLine = true;
-#endif
-
-		string_buffer *asmInstructionLine = PushStringBuffer(&scratchPad, asmInstructionLine, 64);
-
-		asmOps[b](&decoderState, asmInstructionLine, &file, b);
-
-		AppendAndPrint(&outputPool, &asmInstructionLine->asString);
-		ZeroRestoreArena(&scratchPad);
 	}
+	forwardOffsets->count = keptCount;
+}
 
-#if LABEL_PADDING
+//NOTE (Aske): Everything decoded before byteCutoff is final, since no later jump can reach that far back.
+//Writes the missing labels into their label spaces, writes the output to the sink without the unused label spaces,
+//and moves the unfinished remainder to the front of outputPool.
+//A byteCutoff past the end of the file finalizes everything. Every finalized line goes in indexWriter, if it's given.
+internal void FinalizeOutput(memory_arena *outputPool,
+                             array_label_position *labelPosFromInstructionPass,
+                             array_label_position *forwardOffsets,
+                             s64 byteCutoff, output_sink *sink, listing_index_writer *indexWriter)
+{
 	//NOTE (Aske): Insert missing labels
+	s64 keptCount = 0;
 	for (label_position *it = forwardOffsets->base;
 		it < forwardOffsets->base + forwardOffsets->count; ++it)
 	{
-		label_position preWrittenLabelPos;
-		if (ArrayLabelPosFromFilebyteSorted(labelPosFromInstructionPass, it->byteAddress, &preWrittenLabelPos))
+		if (it->byteAddress >= byteCutoff)
 		{
-			string label = { labelSpaceSize, (char *)outputPool.base + preWrittenLabelPos.poolOffset };
-			if (label.data[0] == ' ')
-			{
-				size_t indexNullTerminator = FormatString(labelSpaceSize - 1, label.data,
-				                                          "label__%u:\n           ", it->byteAddress);
-				Assert(labelSpaceSize - 1 == indexNullTerminator);
-				//NOTE (Aske): Overwrite null-terminator
-				label.data[indexNullTerminator] = ' ';
-			}
+			forwardOffsets->base[keptCount++] = *it;
 		}
 		else
 		{
-			InvalidCodePath;
-		}
-	}
+			label_position preWrittenLabelPos;
+			if (ArrayLabelPosFromFilebyteSorted(labelPosFromInstructionPass, it->byteAddress, &preWrittenLabelPos))
+			{
+				char *labelSpace = (char *)outputPool->base + preWrittenLabelPos.poolOffset;
+				if (labelSpace[0] == ' ')
+				{
+					WriteLabelIntoSpace(labelSpace, it->byteAddress);
+				}
+			}
+			else
+			{
+				InvalidCodePath;
+			}
+		}
+	}
+	forwardOffsets->count = keptCount;
 
 	//NOTE (Aske): Remove unused label spaces before every instruction
-	string_buffer *trimmedOutput = PushStringBuffer(&scratchPad, trimmedOutput, outputPool.used);
 	s64 copyFrom = 0;
-	for (label_position *it = labelPosFromInstructionPass->base;
-		it < labelPosFromInstructionPass->base + labelPosFromInstructionPass->count; ++it)
+	label_position *it = labelPosFromInstructionPass->base;
+	label_position *labelPosEnd = labelPosFromInstructionPass->base + labelPosFromInstructionPass->count;
+	for (; (it < labelPosEnd) && (it->byteAddress < byteCutoff); ++it)
 	{
 		//Copy everything up until the first space
-		char *pretrimmedCursor = (char *)outputPool.base + it->poolOffset;
+		char *pretrimmedCursor = (char *)outputPool->base + it->poolOffset;
 		b32 labelExist = (*pretrimmedCursor != ' ');
 		if (labelExist)
 		{
@@ -1306,8 +1028,14 @@ int main(int argc, char* argv[])
 			
 		}
 		Assert(*pretrimmedCursor == ' ');
-		StringBufferWidePrepend(pretrimmedCursor - (char *)outputPool.base - copyFrom,
-		                        (outputPool.base + copyFrom), trimmedOutput);
+		SinkWrite(sink, outputPool->base + copyFrom,
+		          pretrimmedCursor - (char *)outputPool->base - copyFrom);
+		if (indexWriter)
+		{
+			u32 indexFlags = (labelExist ? ListingIndexFlag_hasLabel : 0) |
+			                 (it->isPrefixPending ? ListingIndexFlag_prefixPending : 0);
+			WriteListingIndexEntry(indexWriter, it->byteAddress, sink->totalWritten, indexFlags);
+		}
 
 		//Skip the spaces
 		s32 skipCount = 0;
@@ -1316,21 +1044,1278 @@ int main(int argc, char* argv[])
 			Assert(skipCount++ <= labelSpaceSize);
 		}
 
-		copyFrom = pretrimmedCursor - (char *)outputPool.base;
+		copyFrom = pretrimmedCursor - (char *)outputPool->base;
+	}
+
+	b32 isEverythingFinal = (it == labelPosEnd);
+	s64 finalizedEnd = isEverythingFinal ? outputPool->used : it->poolOffset;
+	u8 *remainderStart = outputPool->base + copyFrom;
+	u8 *endOfPretrim = outputPool->base + finalizedEnd;
+	SinkWrite(sink, remainderStart, endOfPretrim - remainderStart);
+	Assert(!isEverythingFinal || !(*endOfPretrim));
+
+	//NOTE (Aske): Drop the finalized output. The vacated tail is zeroed,
+	//since the label and trimming passes rely on the pool being zeroed past what's used.
+	s64 remainderSize = outputPool->used - finalizedEnd;
+	CopySize(remainderSize, outputPool->base + finalizedEnd, outputPool->base);
+	ZeroPopSize(outputPool, finalizedEnd);
+
+	ArrayLabelPosRemoveFirst(labelPosFromInstructionPass, it - labelPosFromInstructionPass->base);
+	for (label_position *remaining = labelPosFromInstructionPass->base;
+		remaining < labelPosFromInstructionPass->base + labelPosFromInstructionPass->count; ++remaining)
+	{
+		remaining->poolOffset -= finalizedEnd;
+	}
+}
+#endif
+
+//NOTE (Aske): The part of a record that's known before the handler runs. b was just read from file.
+internal decoded_instruction BeginInstructionRecord(decoder_state *decoderState, debug_read_file_result *file, u8 b)
+{
+	decoded_instruction result = {};
+	result.offset = file->CurrentIndex;
+	result.opcode = b;
+	if (decoderState->endedWithNewLine)
+	{
+		result.flags |= InstructionFlag_startsLine;
+		if ((decoderState->RepeatState != State_repeat_none) || decoderState->segmentOverride)
+		{
+			result.flags |= InstructionFlag_prefixPending;
+		}
+	}
+	//NOTE (Aske): Most instructions end with \n
+	decoderState->endedWithNewLine = true;
+	return result;
+}
+
+internal void FinishInstructionRecord(decoder_state *decoderState, debug_read_file_result *file,
+                                      decoded_instruction *decoded)
+{
+	decoded->length = (u8)((file->CurrentIndex + 1) - decoded->offset);
+	//NOTE (Aske): The handler may have read into the guard bytes. This is the only check for running out of input.
+	//The cursor is left past the end, so nothing more is decoded.
+	if (IsPastEndOfInput(file))
+	{
+		decoded->flags |= InstructionFlag_truncated;
+		decoderState->isInputTruncated = true;
+		decoderState->truncatedOffset = decoded->offset;
+
+		char helperMsgBuffer[64];
+		size_t messageLength = FormatString(ArrayCount(helperMsgBuffer), helperMsgBuffer,
+		                                    "Truncated instruction at byte %lld\n", decoded->offset);
+		ReportDecoderMessage(decoderState, helperMsgBuffer, messageLength);
+	}
+}
+
+//NOTE (Aske): Decodes the instruction starting with opcode b, which was just read from file, into a record
+internal decoded_instruction DecodeInstructionRecord(decoder_state *decoderState, debug_read_file_result *file, u8 b)
+{
+	decoded_instruction result = BeginInstructionRecord(decoderState, file, b);
+	opcodeTable.descriptors[b].handler(decoderState, &result, file, b);
+	FinishInstructionRecord(decoderState, file, &result);
+	return result;
+}
+
+#include "instruction_cache.cpp"
+
+//NOTE (Aske): Renders a record straight into outputPool, with a label space in front when it starts a new line.
+//Room for the longest line is committed up front, and only what was written is pushed.
+internal void RenderInstruction(decoder_state *decoderState, memory_arena *outputPool,
+                                decoded_instruction *decoded, output_sink *echoSink)
+{
+#if LABEL_PADDING
+	char *writeLocation = (char *)PrepareSize(outputPool, labelSpaceSize + MaxInstructionTextSize);
+	if (decoded->flags & InstructionFlag_startsLine)
+	{
+		label_position labelPos;
+
+		size_t stringPoolPos = outputPool->used;
+		//NOTE (Aske): The label is already established from previous forward-looking jumps
+		b32 isPrerequested = ArrayLabelPosFromFilebyte(decoderState->postPassOffsets, decoded->offset, &labelPos);
+		if (isPrerequested)
+		{
+			WriteLabelIntoSpace(writeLocation, decoded->offset);
+		}
+		else // Make space for future backward-looking label references
+		{
+			for (u32 i = 0; i < labelSpaceSize; ++i)
+			{
+				writeLocation[i] = ' ';
+			}
+		}
+		PushSize(outputPool, labelSpaceSize);
+		writeLocation += labelSpaceSize;
+		ArrayLabelSpaceAdd(decoderState->labelSpaces, decoded->offset, stringPoolPos,
+		                   decoded->flags & InstructionFlag_prefixPending);
+	}
+#else
+	char *writeLocation = (char *)PrepareSize(outputPool, MaxInstructionTextSize);
+#endif
+
+	s64 lineLength;
+	if (decoded->cachedText)
+	{
+		string cachedLine = CachedInstructionText(decoderState->instructionCache, decoded);
+		CopySize(cachedLine.count, cachedLine.data, writeLocation);
+		lineLength = cachedLine.count;
+	}
+	else
+	{
+		string_buffer line = {};
+		line.capacity = MaxInstructionTextSize;
+		line.data = writeLocation;
+		RenderInstructionText(&line, decoded);
+		lineLength = line.count;
+	}
+	PushSize(outputPool, lineLength);
+	SinkWrite(echoSink, writeLocation, lineLength);
+}
+
+//NOTE (Aske): Decodes and renders one instruction, for the places that go one at a time.
+//A truncated instruction isn't rendered.
+internal void DecodeInstruction(decoder_state *decoderState, memory_arena *outputPool,
+                                debug_read_file_result *file, u8 b, output_sink *echoSink)
+{
+	decoded_instruction decoded = DecodeInstructionRecord(decoderState, file, b);
+	if (!(decoded.flags & InstructionFlag_truncated))
+	{
+		RenderInstruction(decoderState, outputPool, &decoded, echoSink);
+	}
+}
+
+//NOTE (Aske): Input is read in windows of this size when streaming
+#define StreamWindowSize Kilobytes(64)
+//NOTE (Aske): How much input is decoded between each flush of finished output to the sink
+#define OutputFlushInterval Kilobytes(64)
+//NOTE (Aske): A near jump/call reaches at most 32K bytes back, so anything further back can't get a new label
+#define MaxBackwardJumpDistance Kilobytes(32)
+//NOTE (Aske): How many records are decoded before they're rendered
+#define DecodeBatchSize 4096
+#include "decode_dispatch.cpp"
+
+#define MaxDecodeWorkers 64
+#include "parallel_decode.cpp"
+
+struct decoder_options
+{
+	char *binaryFilePath;
+	char *outputAsmFileName;
+	b32 isStreaming;
+	b32 isDecommitOnReset;
+	u32 arenaMemoryFlags;
+	output_sink_type sinkType;
+	b32 isEchoDisabled;
+	b32 isReportingPageFaults;
+	b32 isBatch;
+	char *manifestPath;
+	s32 threadCount; //NOTE (Aske): 0 is one per processor
+	char *benchmarkName; //NOTE (Aske): The positional arguments are the corpus then
+	b32 isCachingInstructions;
+	char *resultCacheDirectory;
+	u64 resultCacheBudget;
+	b32 isWritingIndex;
+	char *updateListingPath; //NOTE (Aske): The old listing, when only the changed ranges are decoded again
+	char *changedRanges;
+	char *serverSocketPath;
+	b32 isWritingRecords; //NOTE (Aske): A record stream instead of a listing
+};
+
+internal decoder_options ParseCommandLine(int argc, char* argv[])
+{
+	decoder_options result = {};
+	result.binaryFilePath = (char *)"../data/listing_0042_completionist_decode";
+	result.outputAsmFileName = (char *)"../data/test42.asm";
+	result.sinkType = OutputSink_file;
+	result.threadCount = 1;
+
+	s32 positionalCount = 0;
+	for (s32 argIndex = 1; argIndex < argc; ++argIndex)
+	{
+		char *arg = argv[argIndex];
+		if (StringsAreEqual(arg, "-stream"))
+		{
+			result.isStreaming = true;
+		}
+		else if (StringsAreEqual(arg, "-arena:decommit"))
+		{
+			result.isDecommitOnReset = true;
+		}
+		else if (StringsAreEqual(arg, "-arena:thp"))
+		{
+			result.arenaMemoryFlags |= PlatformMemory_TransparentHugePages;
+		}
+		else if (StringsAreEqual(arg, "-arena:hugetlb"))
+		{
+			result.arenaMemoryFlags |= PlatformMemory_HugeTlb;
+		}
+		else if (StringsAreEqual(arg, "-arena:populate"))
+		{
+			result.arenaMemoryFlags |= PlatformMemory_Prefault;
+		}
+		else if (StringStartsWith(arg, "-resultcache:"))
+		{
+			result.resultCacheDirectory = arg + StringLength("-resultcache:");
+		}
+		else if (StringStartsWith(arg, "-resultcachesize:"))
+		{
+			result.resultCacheBudget = (u64)S32FromChar(arg + StringLength("-resultcachesize:")) * Megabytes(1);
+		}
+		else if (StringsAreEqual(arg, "-index"))
+		{
+			result.isWritingIndex = true;
+		}
+		else if (StringStartsWith(arg, "-update:"))
+		{
+			result.updateListingPath = arg + StringLength("-update:");
+		}
+		else if (StringStartsWith(arg, "-changed:"))
+		{
+			result.changedRanges = arg + StringLength("-changed:");
+		}
+		else if (StringStartsWith(arg, "-serve:"))
+		{
+			result.serverSocketPath = arg + StringLength("-serve:");
+		}
+		else if (StringsAreEqual(arg, "-records"))
+		{
+			result.isWritingRecords = true;
+		}
+		else if (StringsAreEqual(arg, "-cache"))
+		{
+			result.isCachingInstructions = true;
+		}
+		else if (StringsAreEqual(arg, "-faults"))
+		{
+			result.isReportingPageFaults = true;
+		}
+		else if (StringsAreEqual(arg, "-batch"))
+		{
+			result.isBatch = true;
+		}
+		else if (StringStartsWith(arg, "-manifest:"))
+		{
+			result.manifestPath = arg + StringLength("-manifest:");
+		}
+		else if (StringStartsWith(arg, "-bench:"))
+		{
+			result.benchmarkName = arg + StringLength("-bench:");
+		}
+		else if (StringStartsWith(arg, "-threads:"))
+		{
+			result.threadCount = S32FromChar(arg + StringLength("-threads:"));
+		}
+		else if (StringsAreEqual(arg, "-noecho"))
+		{
+			result.isEchoDisabled = true;
+		}
+		else if (StringsAreEqual(arg, "-sink:file"))
+		{
+			result.sinkType = OutputSink_file;
+		}
+		else if (StringsAreEqual(arg, "-sink:stdout"))
+		{
+			result.sinkType = OutputSink_stdout;
+		}
+		else if (StringsAreEqual(arg, "-sink:tee"))
+		{
+			result.sinkType = OutputSink_tee;
+		}
+		else if (StringsAreEqual(arg, "-sink:null"))
+		{
+			result.sinkType = OutputSink_null;
+		}
+		else if (arg[0] == '-')
+		{
+			fprintf(stderr, "Unknown option: %s\n", arg);
+		}
+		else if (result.isBatch || result.benchmarkName)
+		{
+			//NOTE (Aske): Collected by BatchJobsFromArguments once there's memory to put them in
+		}
+		else if (positionalCount == 0)
+		{
+			result.binaryFilePath = arg;
+			++positionalCount;
+		}
+		else if (positionalCount == 1)
+		{
+			result.outputAsmFileName = arg;
+			++positionalCount;
+		}
+		else
+		{
+			fprintf(stderr, "Ignoring argument: %s\n", arg);
+		}
 	}
 
-	u8 *remainderStart = outputPool.base + copyFrom;
-	u8 *endOfPretrim = outputPool.base + outputPool.used;
-	StringBufferWidePrepend(endOfPretrim - remainderStart, remainderStart, trimmedOutput);
+	//NOTE (Aske): Explicit huge pages already come from a pool that's never swapped or collapsed
+	if (result.arenaMemoryFlags & PlatformMemory_HugeTlb)
+	{
+		result.arenaMemoryFlags &= ~PlatformMemory_TransparentHugePages;
+	}
 
-	Assert(!(*endOfPretrim));
-	WriteEntireFile(outputAsmFileName, trimmedOutput->count, trimmedOutput->base);
+	//NOTE (Aske): The echo would be interleaved with the listing itself
+	if (result.sinkType == OutputSink_stdout || result.sinkType == OutputSink_tee)
+	{
+		result.isEchoDisabled = true;
+		//NOTE (Aske): ...and so would the listings of files decoded at the same time
+		if (result.threadCount != 1)
+		{
+			fprintf(stderr, "Decoding on one thread, since the listings go to stdout\n");
+			result.threadCount = 1;
+		}
+	}
+	if (result.threadCount != 1)
+	{
+		result.isEchoDisabled = true;
+	}
 
+#if LABEL_PADDING
+	if (result.updateListingPath && (result.isBatch || result.manifestPath))
+	{
+		fprintf(stderr, "Ignoring -update and -changed, since they're for one file at a time\n");
+		result.updateListingPath = 0;
+		result.changedRanges = 0;
+	}
+	if (result.updateListingPath && result.isStreaming)
+	{
+		fprintf(stderr, "Reading all of the input, since -update needs it in memory\n");
+		result.isStreaming = false;
+	}
+	if (result.isWritingRecords && (result.isWritingIndex || result.updateListingPath))
+	{
+		fprintf(stderr, "Ignoring -index and -update, since -records doesn't write a listing\n");
+		result.isWritingIndex = false;
+		result.updateListingPath = 0;
+		result.changedRanges = 0;
+	}
+	if (result.isWritingRecords && result.isStreaming)
+	{
+		fprintf(stderr, "Reading all of the input, since -records decodes it twice\n");
+		result.isStreaming = false;
+	}
+	if (result.isWritingRecords)
+	{
+		//NOTE (Aske): The records aren't text, so there are no lines to echo
+		result.isEchoDisabled = true;
+		//NOTE (Aske): Named <input>.rec in main, instead of going to the default listing
+		if (positionalCount < 2)
+		{
+			result.outputAsmFileName = 0;
+		}
+	}
 #else
-	WriteEntireFile(outputAsmFileName, outputPool.used - 1, outputPool.base);
+	if (result.isWritingIndex || result.updateListingPath || result.serverSocketPath || result.isWritingRecords)
+	{
+		fprintf(stderr, "Ignoring -index, -update, -serve and -records, since they need the label padding build\n");
+		result.isWritingIndex = false;
+		result.updateListingPath = 0;
+		result.changedRanges = 0;
+		result.serverSocketPath = 0;
+		result.isWritingRecords = false;
+	}
 #endif
 
-	printf("Wrote to completion: %s\n", outputAsmFileName);
+	return result;
+}
+
+struct batch_job
+{
+	char *binaryFilePath;
+	char *outputAsmFileName;
+};
+
+struct batch_jobs
+{
+	s32 count;
+	batch_job *base;
+};
+
+//NOTE (Aske): Outputs without an explicit path go next to their input, as <input>.asm, or <input>.rec with -records
+internal char* DefaultOutputFileName(memory_arena *arena, char *binaryFilePath, char *extension)
+{
+	s64 length = StringLength(binaryFilePath);
+	char *result = PushArray(arena, length + 5, char);
+	NaiveWiderCopy(length, binaryFilePath, result);
+	NaiveWiderCopy(4, extension, result + length);
+	return result;
+}
+
+//NOTE (Aske): -batch in1 [out1] in2 [out2] ...
+//An argument ending in the output extension is the output of the input before it, and anything else is an input,
+//so an input without an output gets the default output name wherever it is in the list.
+//Fails, with base 0, on an output that doesn't follow an input.
+internal batch_jobs BatchJobsFromArguments(memory_arena *arena, int argc, char* argv[], char *outputExtension)
+{
+	batch_jobs result = {};
+	result.base = PushArray(arena, argc, batch_job);
+
+	batch_job *job = 0; //NOTE (Aske): The last input, while it hasn't got an output yet
+	for (s32 argIndex = 1; argIndex < argc; ++argIndex)
+	{
+		char *arg = argv[argIndex];
+		if (arg[0] == '-')
+		{
+			continue;
+		}
+
+		if (StringEndsWith(arg, outputExtension))
+		{
+			if (!job)
+			{
+				fprintf(stderr, "Batch output without an input before it: %s\n", arg);
+				result = {};
+				return result;
+			}
+			job->outputAsmFileName = arg;
+			job = 0;
+		}
+		else
+		{
+			if (job)
+			{
+				job->outputAsmFileName = DefaultOutputFileName(arena, job->binaryFilePath, outputExtension);
+			}
+			job = result.base + result.count++;
+			job->binaryFilePath = arg;
+		}
+	}
+	if (job)
+	{
+		job->outputAsmFileName = DefaultOutputFileName(arena, job->binaryFilePath, outputExtension);
+	}
+
+	return result;
+}
 
+//NOTE (Aske): Returns the first job whose output is one of the inputs, or 0.
+//Checked up front, since the listing would replace the input before it's decoded, or before another job reads it.
+internal batch_job* JobOverwritingAnInput(batch_jobs *jobs)
+{
+	for (s32 outputIndex = 0; outputIndex < jobs->count; ++outputIndex)
+	{
+		batch_job *job = jobs->base + outputIndex;
+		for (s32 inputIndex = 0; inputIndex < jobs->count; ++inputIndex)
+		{
+			if (StringsAreEqual(job->outputAsmFileName, jobs->base[inputIndex].binaryFilePath))
+			{
+				return job;
+			}
+		}
+	}
 	return 0;
-}
\ No newline at end of file
+}
+
+internal b32 IsSpaceOrTab(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+//NOTE (Aske): One job per line: the input path, optionally followed by whitespace and the output path.
+//Empty lines and lines starting with # are skipped. Paths can't contain spaces.
+internal batch_jobs ReadBatchManifest(memory_arena *arena, char *manifestPath, char *outputExtension)
+{
+	batch_jobs result = {};
+
+	debug_read_file_result manifest = ReadEntireFile(manifestPath);
+	if (!manifest.Contents)
+	{
+		return result;
+	}
+
+	//NOTE (Aske): Copied, since the paths are terminated in place and the file may be mapped read-only.
+	//The arena is zeroed past used, so the copy is null-terminated.
+	char *text = PushArray(arena, manifest.ContentsSize + 1, char);
+	CopySize(manifest.ContentsSize, manifest.Contents, text);
+	FreeFileMemory(&manifest);
+
+	s64 lineCount = 1;
+	for (char *at = text; *at; ++at)
+	{
+		lineCount += (*at == '\n');
+	}
+	result.base = PushArray(arena, lineCount, batch_job);
+
+	char *at = text;
+	while (*at)
+	{
+		char *lineEnd = at;
+		while (*lineEnd && (*lineEnd != '\n'))
+		{
+			++lineEnd;
+		}
+		char *nextLine = *lineEnd ? lineEnd + 1 : lineEnd;
+		*lineEnd = 0;
+
+		while (IsSpaceOrTab(*at))
+		{
+			++at;
+		}
+		if (*at && (*at != '#'))
+		{
+			batch_job *job = result.base + result.count++;
+			job->binaryFilePath = at;
+			while (*at && !IsSpaceOrTab(*at))
+			{
+				++at;
+			}
+			char *inputEnd = at;
+			while (IsSpaceOrTab(*at))
+			{
+				++at;
+			}
+			*inputEnd = 0;
+
+			job->outputAsmFileName = at;
+			while (*at && !IsSpaceOrTab(*at))
+			{
+				++at;
+			}
+			*at = 0;
+
+			if (!*job->outputAsmFileName)
+			{
+				job->outputAsmFileName = DefaultOutputFileName(arena, job->binaryFilePath, outputExtension);
+			}
+		}
+
+		at = nextLine;
+	}
+
+	return result;
+}
+
+internal const char* MemoryFlagsName(u32 memoryFlags)
+{
+	const char *names[] =
+	{
+		"normal pages", "transparent huge pages", "hugetlb", "hugetlb",
+		"normal pages, prefaulted", "transparent huge pages, prefaulted", "hugetlb, prefaulted", "hugetlb, prefaulted",
+	};
+	return names[memoryFlags & 7];
+}
+
+//NOTE (Aske): Worst-case sized buffers that are mostly unused. They're pushed once and reused for every file,
+//instead of being pushed and zeroed again for each one.
+struct decoder_buffers
+{
+#if LABEL_PADDING
+	array_label_position *labelPosFromInstructionPass;
+	array_label_position *forwardOffsets;
+#endif
+	instruction_cache *instructionCache; //NOTE (Aske): Kept from file to file, 0 unless -cache is given
+};
+
+internal decoder_buffers PushDecoderBuffers(memory_arena *arena)
+{
+	decoder_buffers result = {};
+#if LABEL_PADDING
+	s64 labelPosCapacity = Megabytes(3) / sizeof(label_position);
+	array_label_position *labelPosFromInstructionPass = PushPolyArray(arena,
+	                                                  labelPosFromInstructionPass, labelPosCapacity, label_position);
+	labelPosFromInstructionPass->type = Type_label_backward;
+	array_label_position *forwardOffsets = PushPolyArray(arena, forwardOffsets, labelPosCapacity, label_position);
+	labelPosFromInstructionPass->type = Type_label_forward;
+	result.labelPosFromInstructionPass = labelPosFromInstructionPass;
+	result.forwardOffsets = forwardOffsets;
+#endif
+	return result;
+}
+
+struct decode_file_result
+{
+	b32 isInputValid;
+	b32 isInputTruncated; //NOTE (Aske): The last instruction was cut off, and left out of the listing
+	b32 wroteEverything;
+	u64 bytesDecoded;
+	u64 bytesWritten;
+	s32 splitChunkCount;
+	s32 redecodedChunkCount; //NOTE (Aske): Split chunks that had to be decoded again on the calling thread
+	b32 isFromResultCache; //NOTE (Aske): Copied from the result cache instead of decoded
+	b32 isUpdated; //NOTE (Aske): Spliced from the listing given with -update instead of decoded
+	s64 bytesRedecoded;
+	s32 updatedRegionCount;
+};
+
+//NOTE (Aske): The comment at the top of a listing, naming the file it was decoded from
+internal string_buffer* PushSourceFileComment(memory_arena *arena, char *sourceName)
+{
+	//NOTE (Aske): 33000 is an arbitrary limit, guided by Windows
+	s64 sourceNameLength;
+	StringLengthBounded(sourceName, 33000, &sourceNameLength);
+	size_t sourceFileNameOffset;
+	//NOTE (Aske): I'm not sure if I needed to handle both slash types. My MVP skills need practicing.
+	StringLastIndexOf2(sourceName, sourceNameLength, '\\', '/', &sourceFileNameOffset);
+	//NOTE (Aske): remove slash from sourceFileNameOffset
+	size_t sourceFileNameLength = sourceNameLength - (++sourceFileNameOffset);
+
+	string_buffer *sourceFileComment = PushStringBuffer(arena, sourceFileComment, sourceFileNameLength + 3);
+	FormatStringBufferFromBase(sourceFileComment, ";%s\n", sourceName + sourceFileNameOffset);
+	return sourceFileComment;
+}
+
+//NOTE (Aske): Decodes an entire input into outputSink. The input is either all in memory,
+//or read window by window from inputStream. sourceName goes in the comment at the top of the listing, if given.
+//The listing's index goes in indexWriter, if it's given. Both have to be empty to begin with.
+//Everything pushed on scratchPad is popped again, and outputPool is left empty.
+internal void DecodeListing(debug_read_file_result *file, input_stream *inputStream, char *sourceName,
+                            memory_arena *outputPool, memory_arena *scratchPad, decoder_buffers *buffers,
+                            split_workers *split, output_sink *outputSink, struct listing_index_writer *indexWriter,
+                            output_sink *echoSink, output_sink *messageSink, decode_file_result *result)
+{
+	SaveArena(scratchPad);
+
+	decoder_state decoderState = {};
+	decoderState.ScratchPad = scratchPad;
+	decoderState.messageSink = messageSink;
+	decoderState.indexWriter = indexWriter;
+
+	byte_of_file byteCursor;
+
+	/*
+	 * NOTE (Aske): I'm not sure how to handle labels.
+	 * My ideas were:
+	 * 1. while decoding labels, keep a list of all the label locations and all the instruction lines.
+	 * 		And when you've parsed all instructions,
+	 * 		do a second pass where you build the final string output, including labels, from both lists.
+	 * 
+	 * 2. to do a label pass first, locating all the label locations.
+	 * 		Keeping them in an array, that you may sort before use.
+	 * 		Labels are then added together with the instruction pass.
+	 * 
+	 * 3. before every (full) instruction line, add enough room for a label,
+	 * 		and (over)write that label when encountered.
+	 * 		You might keep the "label space" locations in an expanding array.
+	 * 
+	 * I first went with idea 2, but thought it was too complicated so I went with idea 3 instead.
+	 * Idea 1 might be even simpler, but it felt like a solution from GC'ed languages that treat
+	 * "inserting" strings into other strings without concern for its cost. I wanted to not do that.
+	 * But now that I'm done, I'm not sure idea 3 really was less complicated or efficient.
+	* */
+#if LABEL_FIRST_PASS
+	array_s32 *labelDefinitions = PushPolyArray(scratchPad, labelDefinitions, Megabytes(7) / sizeof(s32), s32);
+	decoderState.labelAtByte = labelDefinitions;
+
+	//TODO (Aske): Assert rep states (f2-f5) follow a string instruction (a4-a7, aa-af)
+	FindLabelDefinitions(labelDefinitions, file, scratchPad);
+
+	//NOTE (Aske): Probably not necessary to clean up the scratchpad, but it's easy to do.
+	//If this was production code, we'd manage the memory differently anyway
+	size_t labelExcessBuffer = (labelDefinitions->size - labelDefinitions->count) * sizeof(s32);
+	PopSize(scratchPad, labelExcessBuffer);
+	labelDefinitions->size = labelDefinitions->count;
+		
+	//NOTE (Aske): Sint32Max once the labels run out, since no instruction starts there
+#define LabelByteAt(index) (((index) < labelDefinitions->count) ? Array32Get(labelDefinitions, (index)) : Sint32Max)
+	s64 labelIdx = 0;
+	s32 nextLabelByte = LabelByteAt(labelIdx);
+#elif LABEL_PADDING
+	//TODO (Aske): These needs a rename once the functionality is done
+	array_label_position *labelPosFromInstructionPass = buffers->labelPosFromInstructionPass;
+	array_label_position *forwardOffsets = buffers->forwardOffsets;
+	labelPosFromInstructionPass->count = 0;
+	forwardOffsets->count = 0;
+	decoderState.postPassOffsets = forwardOffsets;
+	decoderState.labelSpaces = labelPosFromInstructionPass;
+#endif
+
+	if (sourceName)
+	{
+		string_buffer *sourceFileComment = PushSourceFileComment(scratchPad, sourceName);
+		AppendAndPrint(outputPool, &sourceFileComment->asString, echoSink);
+	}
+
+	string enforce16BitAsm = { 8, "bits 16\n" };
+	decoderState.endedWithNewLine = true;
+	AppendAndPrint(outputPool, &enforce16BitAsm, echoSink);
+#if LABEL_PADDING
+	if (indexWriter)
+	{
+		StartListingIndex(indexWriter, sourceName ? 2 : 1);
+	}
+#endif
+#if LABEL_PADDING
+	//NOTE (Aske): Decodes the whole file and leaves the cursor at the end, so the serial loop has nothing left to do
+	if (split && !inputStream && (file->ContentsSize >= SplitMinimumFileSize))
+	{
+		DecodeSplit(split, &decoderState, outputPool, file, outputSink, echoSink,
+		            &result->splitChunkCount, &result->redecodedChunkCount);
+	}
+#endif
+	decoderState.instructionCache = buffers->instructionCache;
+	//NOTE (Aske): A batch of instructions is decoded into records, and then all of them are rendered.
+	//Batches end at every flush, so the output is flushed at the same places as when going one by one.
+	decoded_instructions decodedBatch = PushDecodedInstructions(scratchPad, DecodeBatchSize);
+	s64 lastFlushIndex = 0;
+	b32 isDecoding = true;
+	while (isDecoding)
+	{
+		decodedBatch.count = 0;
+		s64 stopIndex = lastFlushIndex + OutputFlushInterval;
+#if DECODER_THREADED_DISPATCH
+		isDecoding = DecodeRecordBatchThreaded(&decoderState, file, inputStream, &decodedBatch, stopIndex);
+#else
+		isDecoding = DecodeRecordBatch(&decoderState, file, inputStream, &decodedBatch, stopIndex);
+#endif
+		//NOTE (Aske): A truncated instruction leaves the cursor past the end
+		s64 nextIndex = Minimum(file->CurrentIndex + 1, (s64)file->ContentsSize);
+
+		for (s64 i = 0; i < decodedBatch.count; ++i)
+		{
+			decoded_instruction decoded = GetDecodedInstruction(&decodedBatch, i);
+
+#if LABEL_FIRST_PASS
+			if (decoded.offset == nextLabelByte)
+			{
+				SaveArena(scratchPad);
+				string_buffer *label = PushStringBuffer(scratchPad, label, 48);
+				FormatStringBufferFromBase(label, "\nlabel__%u:\n", decoded.offset);
+				AppendAndPrint(outputPool, &label->asString, echoSink);
+				ZeroRestoreArena(scratchPad);
+
+				nextLabelByte = LabelByteAt(labelIdx + 1);
+				++labelIdx;
+			}
+			else
+			{
+				while (decoded.offset > nextLabelByte)
+				{
+					Assert(!"Skipped a label");
+					nextLabelByte = LabelByteAt(labelIdx + 1);
+				++labelIdx;
+				}
+			}
+#endif
+			RenderInstruction(&decoderState, outputPool, &decoded, echoSink);
+		}
+
+		if ((nextIndex - lastFlushIndex) >= OutputFlushInterval)
+		{
+#if LABEL_PADDING
+			FinalizeOutput(outputPool, labelPosFromInstructionPass, forwardOffsets,
+			               nextIndex - MaxBackwardJumpDistance, outputSink, indexWriter);
+#else
+			SinkWrite(outputSink, outputPool->base, outputPool->used);
+			ResetArena(outputPool);
+#endif
+			lastFlushIndex = nextIndex;
+		}
+	}
+
+#if LABEL_PADDING
+	if (decoderState.isInputTruncated)
+	{
+		DropLabelsFrom(forwardOffsets, decoderState.truncatedOffset);
+	}
+	FinalizeOutput(outputPool, labelPosFromInstructionPass, forwardOffsets, Sint64Max, outputSink, indexWriter);
+	if (indexWriter)
+	{
+		FinishListingIndex(indexWriter, file->ContentsSize, outputSink->totalWritten);
+	}
+#else
+	SinkWrite(outputSink, outputPool->base, outputPool->used - 1);
+#endif
+	result->bytesDecoded = file->ContentsSize;
+	result->isInputTruncated = decoderState.isInputTruncated;
+
+	ZeroRestoreArena(scratchPad);
+	ResetArena(outputPool);
+}
+
+#include "result_cache.cpp"
+#if LABEL_PADDING
+#include "incremental_update.cpp"
+#include "record_stream.cpp"
+#endif
+
+//NOTE (Aske): Decodes one binary into one listing. Everything pushed on the arenas is popped again before returning,
+//so batch mode can reuse the same (already committed) arenas for every file.
+internal decode_file_result DecodeFile(decoder_options *options, char *binaryFilePath, char *outputAsmFileName,
+                                       memory_arena *outputPool, memory_arena *scratchPad, decoder_buffers *buffers,
+                                       split_workers *split, result_cache *resultCache)
+{
+	decode_file_result result = {};
+	SaveArena(scratchPad);
+
+	debug_read_file_result file = {};
+	input_stream inputStream = {};
+	if (options->isStreaming)
+	{
+		//NOTE (Aske): Memory use is bounded by the window and flush sizes, no matter the size of the input
+		inputStream.file = PlatformOpenFileForReading(binaryFilePath);
+		inputStream.windowCapacity = StreamWindowSize;
+		inputStream.window = (u8 *)PushSize(scratchPad, inputStream.windowCapacity + InputGuardSize);
+		inputStream.reachedEndOfFile = !inputStream.file.isValid;
+		file.CurrentIndex = -1;
+		file.Contents = inputStream.window;
+		file.ContentsSize = inputStream.file.size;
+		RefillInputWindow(&inputStream, &file);
+	}
+	else
+	{
+		file = ReadEntireFile(binaryFilePath);
+	}
+	//NOTE (Aske): Empty inputs count as unreadable too, since there's nothing to decode
+	result.isInputValid = options->isStreaming ? (inputStream.file.isValid && (inputStream.file.size > 0)) :
+	                                             (file.Contents != 0);
+	if (!result.isInputValid)
+	{
+		//NOTE (Aske): Nothing is opened for writing, so a listing left from an earlier run stays as it was
+		if (options->isStreaming)
+		{
+			PlatformCloseFile(&inputStream.file);
+		}
+		ZeroRestoreArena(scratchPad);
+		return result;
+	}
+
+	//NOTE (Aske): An update is written next to the listing and renamed over it once it's complete,
+	//since the old listing it copies from is usually the one it replaces
+	char *listingPath = outputAsmFileName;
+	char *indexPath = 0;
+	char *writtenIndexPath = 0;
+	output_sink indexSink = {};
+	struct listing_index_writer *indexWriter = 0;
+#if LABEL_PADDING
+	b32 isWritingToFile = (options->sinkType == OutputSink_file) || (options->sinkType == OutputSink_tee);
+	if (isWritingToFile && (options->isWritingIndex || options->updateListingPath))
+	{
+		indexPath = ListingIndexPath(scratchPad, outputAsmFileName);
+		writtenIndexPath = indexPath;
+		if (options->updateListingPath)
+		{
+			listingPath = UpdateTemporaryPath(scratchPad, outputAsmFileName);
+			writtenIndexPath = UpdateTemporaryPath(scratchPad, indexPath);
+		}
+		InitializeOutputSink(&indexSink, OutputSink_file, writtenIndexPath, scratchPad);
+		indexWriter = PushStruct(scratchPad, listing_index_writer);
+		indexWriter->sink = &indexSink;
+	}
+#endif
+
+	output_sink outputSink;
+	output_sink echoSink;
+	InitializeOutputSink(&outputSink, options->sinkType, listingPath, scratchPad);
+	InitializeOutputSink(&echoSink, options->isEchoDisabled ? OutputSink_null : OutputSink_stdout, 0, scratchPad);
+	//NOTE (Aske): Messages about odd opcodes go to stderr, whether or not the lines are echoed,
+	//so they never end up in a listing written to stdout
+	output_sink messageSink;
+	InitializeOutputSink(&messageSink, OutputSink_stderr, 0, scratchPad);
+
+#if LABEL_PADDING
+	if (indexWriter && options->updateListingPath)
+	{
+		result.isUpdated = UpdateListing(options->updateListingPath, options->changedRanges, &file, binaryFilePath,
+		                                 &outputSink, indexWriter, &echoSink, &messageSink, scratchPad, &result);
+		if (!result.isUpdated)
+		{
+			fprintf(stderr, "Decoding all of %s, since %s or its index doesn't fit it\n",
+			        binaryFilePath, options->updateListingPath);
+		}
+	}
+#endif
+
+	//NOTE (Aske): The key needs all of the input, so streamed inputs aren't cached.
+	//Nor are indexed ones, since the index isn't stored with the listing, or record streams, which aren't listings.
+	result_cache_entry cacheEntry = {};
+	b32 isCached = resultCache && !options->isStreaming &&
+	               (options->sinkType != OutputSink_null) && !indexWriter && !options->isWritingRecords;
+	if (isCached)
+	{
+		cacheEntry = ResultCacheEntryFor(resultCache, scratchPad, &file, binaryFilePath);
+		result.isFromResultCache = CopyCachedListing(resultCache, &cacheEntry, &outputSink, &echoSink);
+	}
+
+	if (result.isFromResultCache)
+	{
+		result.bytesDecoded = file.ContentsSize;
+	}
+#if LABEL_PADDING
+	else if (options->isWritingRecords)
+	{
+		WriteRecordStream(&file, scratchPad, buffers, &outputSink, &messageSink, &result);
+	}
+#endif
+	else if (!result.isUpdated)
+	{
+		if (isCached)
+		{
+			BeginStoringListing(&cacheEntry, &outputSink);
+		}
+		DecodeListing(&file, options->isStreaming ? &inputStream : 0, binaryFilePath, outputPool, scratchPad, buffers,
+		              split, &outputSink, indexWriter, &echoSink, &messageSink, &result);
+		//NOTE (Aske): A truncated input is decoded every time, so the message about it shows up every time
+		FinishStoringListing(resultCache, &cacheEntry, &outputSink, !result.isInputTruncated);
+	}
+
+	CloseOutputSink(&echoSink);
+	CloseOutputSink(&messageSink);
+	result.wroteEverything = CloseOutputSink(&outputSink);
+	result.bytesWritten = outputSink.totalWritten;
+	if (indexWriter)
+	{
+		result.wroteEverything = CloseOutputSink(&indexSink) && result.wroteEverything;
+	}
+	if (listingPath != outputAsmFileName)
+	{
+		//NOTE (Aske): A listing that wasn't written completely never replaces the old one.
+		//Every way of producing it sets bytesDecoded to the whole input, so that tells it was produced at all.
+		b32 isListingComplete = result.isInputValid && (result.bytesDecoded == file.ContentsSize) &&
+		                        result.wroteEverything;
+		if (isListingComplete)
+		{
+			result.wroteEverything = PlatformRenameFile(listingPath, outputAsmFileName) &&
+			                         PlatformRenameFile(writtenIndexPath, indexPath);
+		}
+		else
+		{
+			PlatformDeleteFile(listingPath);
+			PlatformDeleteFile(writtenIndexPath);
+		}
+	}
+
+	if (options->isStreaming)
+	{
+		PlatformCloseFile(&inputStream.file);
+	}
+	else
+	{
+		FreeFileMemory(&file);
+	}
+
+	ZeroRestoreArena(scratchPad);
+	return result;
+}
+#include "decoder_library.cpp"
+
+//NOTE (Aske): Every worker owns its arenas and buffers, and DecodeFile makes a fresh decoder_state per file.
+//The only thing shared between workers is read-only: the options, the job list and the opcode table.
+struct decode_worker
+{
+	s32 workerIndex;
+	s32 workerCount;
+	work_deque *deques;
+
+	decoder_options *options;
+	batch_jobs *jobs;
+	decode_file_result *results; //NOTE (Aske): Indexed by job, so each slot only has one writer
+
+	memory_arena outputPool;
+	memory_arena scratchPad;
+	decoder_buffers buffers;
+	split_workers *split; //NOTE (Aske): Only set when a single file is split up between threads
+	result_cache *resultCache; //NOTE (Aske): Shared by every worker, 0 unless -resultcache is given
+
+	s32 stealCount;
+	platform_thread thread;
+};
+
+//NOTE (Aske): Nothing adds jobs, so once every deque is empty every job has been claimed
+internal PLATFORM_THREAD_PROC(DecodeWorkerProc)
+{
+	decode_worker *worker = (decode_worker *)data;
+	u32 jobIndex;
+	while (TakeNextWork(worker->deques, worker->workerCount, worker->workerIndex, &jobIndex, &worker->stealCount))
+	{
+		batch_job *job = worker->jobs->base + jobIndex;
+		worker->results[jobIndex] = DecodeFile(worker->options, job->binaryFilePath, job->outputAsmFileName,
+		                                       &worker->outputPool, &worker->scratchPad, &worker->buffers,
+		                                       worker->split, worker->resultCache);
+	}
+}
+
+#if !DECODER_LIBRARY
+#include "benchmark.cpp"
+#if LABEL_PADDING
+#include "decode_server.cpp"
+#endif
+
+int main(int argc, char* argv[])
+{
+	decoder_options options = ParseCommandLine(argc, argv);
+	InitializeMemoryKernels();
+
+#ifdef ASH_INTERNAL
+	void *baseAddress = (void *)Terabytes(2);
+#else
+	void *baseAddress = 0;
+#endif
+
+	//NOTE (Aske): Only address space is reserved up front. Pages are committed as the arenas grow,
+	//so a tiny file only ever touches a few pages.
+	size_t outputMaxSize = Gigabytes(16);
+	size_t scratchPadSize = Gigabytes(16);
+
+	u32 arenaFlags = 0;
+	if (options.isDecommitOnReset)
+	{
+		arenaFlags |= ArenaFlag_DecommitOnReset;
+	}
+
+	//NOTE (Aske): Each worker gets its own reservation. The address space is plentiful, only committed pages cost.
+	size_t workerReservationStride = outputMaxSize + scratchPadSize + 2 * HugePageSize;
+	decode_worker workers[MaxDecodeWorkers] = {};
+	for (s32 workerIndex = 0; workerIndex < MaxDecodeWorkers; ++workerIndex)
+	{
+		decode_worker *worker = workers + workerIndex;
+		worker->workerIndex = workerIndex;
+		worker->options = &options;
+	}
+
+	//NOTE (Aske): Worker 0 runs on the main thread, and its scratch pad also holds the job list and results
+	decode_worker *mainWorker = workers;
+	b32 isReserved = ReserveArena(&mainWorker->outputPool, baseAddress, outputMaxSize,
+	                              arenaFlags, options.arenaMemoryFlags);
+	Assert(isReserved);
+	void *scratchPadAddress = baseAddress ? (u8 *)baseAddress + outputMaxSize + HugePageSize : 0;
+	isReserved = ReserveArena(&mainWorker->scratchPad, scratchPadAddress, scratchPadSize,
+	                          arenaFlags, options.arenaMemoryFlags);
+	Assert(isReserved);
+	memory_arena *scratchPad = &mainWorker->scratchPad;
+
+	if (options.benchmarkName)
+	{
+		return RunBenchmark(options.benchmarkName, scratchPad, argc, argv);
+	}
+#if LABEL_PADDING
+	if (options.serverSocketPath)
+	{
+		return RunDecodeServer(&options, &mainWorker->outputPool, scratchPad);
+	}
+#endif
+
+#if LABEL_PADDING
+	if ((options.updateListingPath || options.changedRanges) &&
+	    !AreChangedRangesUsable(scratchPad, options.updateListingPath, options.changedRanges, options.binaryFilePath))
+	{
+		return 1;
+	}
+#endif
+
+	batch_jobs jobs = {};
+	char *outputExtension = options.isWritingRecords ? (char *)".rec" : (char *)".asm";
+	if (options.manifestPath)
+	{
+		jobs = ReadBatchManifest(scratchPad, options.manifestPath, outputExtension);
+		if (!jobs.base)
+		{
+			fprintf(stderr, "Failed reading manifest: %s\n", options.manifestPath);
+			return 1;
+		}
+	}
+	else if (options.isBatch)
+	{
+		jobs = BatchJobsFromArguments(scratchPad, argc, argv, outputExtension);
+		if (!jobs.base)
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		jobs.base = PushStruct(scratchPad, batch_job);
+		jobs.base->binaryFilePath = options.binaryFilePath;
+		jobs.base->outputAsmFileName = options.outputAsmFileName ? options.outputAsmFileName :
+		                               DefaultOutputFileName(scratchPad, options.binaryFilePath, outputExtension);
+		jobs.count = 1;
+	}
+	batch_job *overwritingJob = JobOverwritingAnInput(&jobs);
+	if (overwritingJob)
+	{
+		fprintf(stderr, "Refusing to write over an input: %s\n", overwritingJob->outputAsmFileName);
+		return 1;
+	}
+	b32 isBatch = (options.manifestPath || options.isBatch);
+	decode_file_result *results = PushArray(scratchPad, jobs.count, decode_file_result);
+
+	s32 threadCount = options.threadCount ? options.threadCount : PlatformGetProcessorCount();
+	//NOTE (Aske): A lone file is split up between the threads instead
+	b32 isSplitting = !isBatch && (threadCount > 1);
+	if (isSplitting && options.isStreaming)
+	{
+		fprintf(stderr, "Decoding on one thread, since splitting a file up needs all of it in memory\n");
+		isSplitting = false;
+	}
+	s32 workerCount = isSplitting ? 1 : Maximum(1, Minimum(threadCount, Minimum(MaxDecodeWorkers, jobs.count)));
+	s32 splitWorkerCount = isSplitting ? Minimum(threadCount, MaxDecodeWorkers - 1) : 0;
+
+	for (s32 workerIndex = 1; workerIndex < (workerCount + splitWorkerCount); ++workerIndex)
+	{
+		decode_worker *worker = workers + workerIndex;
+		u8 *workerAddress = baseAddress ? (u8 *)baseAddress + workerIndex * workerReservationStride : 0;
+		isReserved = ReserveArena(&worker->outputPool, workerAddress, outputMaxSize,
+		                          arenaFlags, options.arenaMemoryFlags);
+		Assert(isReserved);
+		workerAddress = workerAddress ? workerAddress + outputMaxSize + HugePageSize : 0;
+		isReserved = ReserveArena(&worker->scratchPad, workerAddress, scratchPadSize,
+		                          arenaFlags, options.arenaMemoryFlags);
+		Assert(isReserved);
+	}
+
+	//NOTE (Aske): The split workers take the slots after the batch worker, and all of them get their own thread
+	split_workers split = {};
+	if (isSplitting)
+	{
+		split.count = splitWorkerCount;
+		for (s32 splitIndex = 0; splitIndex < splitWorkerCount; ++splitIndex)
+		{
+			decode_worker *worker = workers + workerCount + splitIndex;
+			split.outputPools[splitIndex] = &worker->outputPool;
+			split.scratchPads[splitIndex] = &worker->scratchPad;
+		}
+		mainWorker->split = &split;
+	}
+
+	work_deque *deques = PushArray(scratchPad, workerCount + 1, work_deque);
+	//NOTE (Aske): Cache line aligned, since each deque is padded to fill exactly one
+	deques = (work_deque *)AlignPow2((umm)deques, sizeof(work_deque));
+	//NOTE (Aske): Neighbouring jobs go to the same worker, stealing evens out the differences in size
+	DistributeWork(deques, workerCount, jobs.count);
+
+	for (s32 workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+	{
+		decode_worker *worker = workers + workerIndex;
+		worker->buffers = PushDecoderBuffers(&worker->scratchPad);
+		if (options.isCachingInstructions)
+		{
+			worker->buffers.instructionCache = PushInstructionCache(&worker->scratchPad);
+		}
+		worker->workerCount = workerCount;
+		worker->deques = deques;
+		worker->jobs = &jobs;
+		worker->results = results;
+	}
+
+	//NOTE (Aske): The eviction thread has an arena of its own, for listing the cache directory
+	result_cache resultCache = {};
+	memory_arena resultCacheScratchPad = {};
+	if (options.resultCacheDirectory)
+	{
+		u64 budget = options.resultCacheBudget ? options.resultCacheBudget : DefaultResultCacheBudget;
+		isReserved = ReserveArena(&resultCacheScratchPad, 0, Gigabytes(1), arenaFlags, 0);
+		Assert(isReserved);
+		if (StartResultCache(&resultCache, options.resultCacheDirectory, budget, &resultCacheScratchPad))
+		{
+			for (s32 workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+			{
+				workers[workerIndex].resultCache = &resultCache;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Decoding without the result cache, since it can't be made in: %s\n",
+			        options.resultCacheDirectory);
+		}
+	}
+
+	platform_page_faults faultsBeforeDecode = PlatformGetPageFaults();
+	f64 secondsBeforeDecode = PlatformGetWallClockSeconds();
+	for (s32 workerIndex = 1; workerIndex < workerCount; ++workerIndex)
+	{
+		decode_worker *worker = workers + workerIndex;
+		b32 isStarted = PlatformStartThread(&worker->thread, DecodeWorkerProc, worker);
+		Assert(isStarted);
+	}
+	DecodeWorkerProc(mainWorker);
+	s32 stealCount = mainWorker->stealCount;
+	for (s32 workerIndex = 1; workerIndex < workerCount; ++workerIndex)
+	{
+		PlatformJoinThread(&workers[workerIndex].thread);
+		stealCount += workers[workerIndex].stealCount;
+	}
+	f64 secondsAfterDecode = PlatformGetWallClockSeconds();
+	platform_page_faults faultsAfterDecode = PlatformGetPageFaults();
+	if (mainWorker->resultCache)
+	{
+		StopResultCache(&resultCache);
+	}
+
+	s32 failedCount = 0;
+	u64 totalBytesDecoded = 0;
+	u64 totalBytesWritten = 0;
+	for (s32 jobIndex = 0; jobIndex < jobs.count; ++jobIndex)
+	{
+		batch_job *job = jobs.base + jobIndex;
+		decode_file_result *decoded = results + jobIndex;
+		totalBytesDecoded += decoded->bytesDecoded;
+		totalBytesWritten += decoded->bytesWritten;
+
+		if (!decoded->isInputValid)
+		{
+			fprintf(stderr, "Failed reading: %s\n", job->binaryFilePath);
+			++failedCount;
+		}
+		else if (!decoded->wroteEverything)
+		{
+			fprintf(stderr, "Failed writing to: %s\n", job->outputAsmFileName);
+			++failedCount;
+		}
+		else if (!isBatch && options.sinkType == OutputSink_file)
+		{
+			fprintf(stderr, "Wrote to completion: %s\n", job->outputAsmFileName);
+		}
+	}
+
+	if (isBatch)
+	{
+		f64 seconds = secondsAfterDecode - secondsBeforeDecode;
+		f64 megabyte = (f64)Megabytes(1);
+		fprintf(stderr, "Decoded %d files (%d failed) in %.3f s, %.0f files/s, on %d threads with %d steals\n",
+		        jobs.count, failedCount, seconds, jobs.count / seconds, workerCount, stealCount);
+		fprintf(stderr, "Read %llu bytes (%.2f MB/s), wrote %llu bytes (%.2f MB/s)\n",
+		        (unsigned long long)totalBytesDecoded, (totalBytesDecoded / megabyte) / seconds,
+		        (unsigned long long)totalBytesWritten, (totalBytesWritten / megabyte) / seconds);
+	}
+
+	if (results->splitChunkCount)
+	{
+		fprintf(stderr, "Split into %d chunks on %d threads, %d decoded again serially, in %.3f s\n",
+		        results->splitChunkCount, splitWorkerCount, results->redecodedChunkCount,
+		        secondsAfterDecode - secondsBeforeDecode);
+	}
+
+	if (results->isUpdated)
+	{
+		fprintf(stderr, "Updated %s by decoding %lld of %llu bytes again, in %d regions\n",
+		        jobs.base->outputAsmFileName, (long long)results->bytesRedecoded,
+		        (unsigned long long)results->bytesDecoded, results->updatedRegionCount);
+	}
+
+	if (mainWorker->resultCache)
+	{
+		f64 megabyte = (f64)Megabytes(1);
+		fprintf(stderr, "Result cache: %llu of %d listings copied from it, %llu stored, %llu evicted (%.2f MB)\n",
+		        (unsigned long long)resultCache.hitCount, jobs.count, (unsigned long long)resultCache.storedCount,
+		        (unsigned long long)resultCache.evictedCount, resultCache.evictedBytes / megabyte);
+	}
+
+	if (options.isCachingInstructions)
+	{
+		s64 lookupCount = 0;
+		s64 hitCount = 0;
+		s32 fillCount = 0;
+		for (s32 workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+		{
+			instruction_cache *cache = workers[workerIndex].buffers.instructionCache;
+			lookupCount += cache->lookupCount;
+			hitCount += cache->hitCount;
+			fillCount += cache->fillCount;
+		}
+		fprintf(stderr, "Instruction cache: %lld hits of %lld lookups (%.1f%%), %d encodings cached\n",
+		        (long long)hitCount, (long long)lookupCount,
+		        lookupCount ? (100.0 * hitCount) / lookupCount : 0.0, fillCount);
+	}
+
+	if (options.isReportingPageFaults)
+	{
+		//NOTE (Aske): On stderr, so it can't end up in a listing written to stdout
+		fprintf(stderr, "Page faults while decoding: %llu minor, %llu major\n",
+		        (unsigned long long)(faultsAfterDecode.minor - faultsBeforeDecode.minor),
+		        (unsigned long long)(faultsAfterDecode.major - faultsBeforeDecode.major));
+		fprintf(stderr, "Arena backing (requested -> used): %s -> %s\n",
+		        MemoryFlagsName(options.arenaMemoryFlags), MemoryFlagsName(mainWorker->outputPool.memoryFlags));
+	}
+
+	return (failedCount == 0) ? 0 : 1;
+}
+#endif
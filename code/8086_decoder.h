@@ -27,12 +27,48 @@ typedef intptr_t smm;
 #define ASH_INTERNAL 1
 #endif
 
+//NOTE (Aske): LABEL_FIRST_PASS finds every label before decoding, so it has no use for the padding
+#if LABEL_FIRST_PASS
+#if !defined(LABEL_PADDING)
+#define LABEL_PADDING 0
+#elif LABEL_PADDING
+#error "LABEL_FIRST_PASS only builds with LABEL_PADDING=0"
+#endif
+#endif
+
 #if !defined(LABEL_PADDING)
 #define LABEL_PADDING 1
 #endif
 
+//NOTE (Aske): Labels as values are a GCC/Clang extension. Otherwise the decode loop calls through the opcode table.
+#if !defined(DECODER_COMPUTED_GOTO)
+#if defined(__GNUC__)
+#define DECODER_COMPUTED_GOTO 1
+#else
+#define DECODER_COMPUTED_GOTO 0
+#endif
+#endif
+
+//NOTE (Aske): Whether listings are decoded with the computed-goto dispatch. Off by default, since
+//-bench:dispatch measured it slower than the table here. Run it on your own machine before turning it on.
+#if !defined(DECODER_THREADED_DISPATCH) || !DECODER_COMPUTED_GOTO
+#undef DECODER_THREADED_DISPATCH
+#define DECODER_THREADED_DISPATCH 0
+#endif
+
+//NOTE (Aske): The SIMD copy and zero kernels are x64 only. Elsewhere CopySize and ZeroSize stay on the plain loops.
+#if !defined(DECODER_SIMD_KERNELS)
+#if defined(__x86_64__) || defined(_M_X64)
+#define DECODER_SIMD_KERNELS 1
+#else
+#define DECODER_SIMD_KERNELS 0
+#endif
+#endif
+
+#define Sint16Min (-0x8000)
 #define Sint16Max 0x7FFF
 #define Sint32Max 0x7FFFFFFF
+#define Sint64Max 0x7FFFFFFFFFFFFFFF
 #define Uint16Max 0xFFFF
 #define Uint32Max 0xFFFFFFFF
 #define Uint64Max 0xFFFFFFFFFFFFFFFF
@@ -56,6 +92,22 @@ typedef intptr_t smm;
 #define InvalidDefaultCase default: {InvalidCodePath;} break
 #define InvalidCase(Value) case Value: {InvalidCodePath;} break
 
+//NOTE (Aske): Compare-exchange and add return the value that was there before, and are full barriers on both compilers.
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AtomicCompareExchangeU64(destination, expected, desired) \
+    (u64)_InterlockedCompareExchange64((volatile __int64 *)(destination), (__int64)(desired), (__int64)(expected))
+//NOTE (Aske): MSVC gives volatile reads acquire semantics on x86/x64
+#define AtomicLoadU64(source) (*(volatile u64 *)(source))
+#define AtomicAddU64(destination, value) \
+    (u64)_InterlockedExchangeAdd64((volatile __int64 *)(destination), (__int64)(value))
+#else
+#define AtomicCompareExchangeU64(destination, expected, desired) \
+    __sync_val_compare_and_swap((destination), (expected), (desired))
+#define AtomicLoadU64(source) __atomic_load_n((source), __ATOMIC_ACQUIRE)
+#define AtomicAddU64(destination, value) __sync_fetch_and_add((destination), (value))
+#endif
+
 inline u32 SafeTruncateUInt64(u64 value)
 {
     Assert(value <= Uint32Max);
@@ -84,7 +136,6 @@ internal void* NaiveWiderCopy(size_t byteCount, void *sourceInit, void *destInit
     size_t clusterCount = byteCount >> 3;
     u32 remainder = byteCount & 7;
 
-    //TODO (Aske): Use SIMD
     u64 *wideSource = (u64 *)sourceInit;
     u64 *wideDest = (u64 *)destInit;
     if(clusterCount)
@@ -102,21 +153,178 @@ internal void* NaiveWiderCopy(size_t byteCount, void *sourceInit, void *destInit
     return (destination);
 }
 
+internal void* NaiveZeroSize(void *ptr, size_t size)
+{
+    u8 *byte = (u8 *)ptr;
+    while(size--) { *byte++ = 0; }
+    return (byte);
+}
+
+//NOTE (Aske): CopySize and ZeroSize hand anything of 16 bytes or more to these. InitializeMemoryKernels
+//(memory_kernels.cpp) points them at the widest SIMD kernels the CPU has. Until then, they're the loops above.
+//Both return the end of what they wrote.
+typedef void *copy_kernel(size_t byteCount, void *source, void *dest);
+typedef void *zero_kernel(void *ptr, size_t size);
+global_variable copy_kernel *CopyKernel = NaiveWiderCopy;
+global_variable zero_kernel *ZeroKernel = NaiveZeroSize;
+
+//NOTE (Aske): Under 16 bytes, as two moves of the same width that overlap in the middle.
+//Everything is loaded before anything is stored, so source and dest may overlap.
+internal void CopySmall(size_t byteCount, u8 *source, u8 *dest)
+{
+    if (byteCount >= 8)
+    {
+        u64 head = *(u64 *)source;
+        u64 tail = *(u64 *)(source + byteCount - 8);
+        *(u64 *)dest = head;
+        *(u64 *)(dest + byteCount - 8) = tail;
+    }
+    else if (byteCount >= 4)
+    {
+        u32 head = *(u32 *)source;
+        u32 tail = *(u32 *)(source + byteCount - 4);
+        *(u32 *)dest = head;
+        *(u32 *)(dest + byteCount - 4) = tail;
+    }
+    else if (byteCount)
+    {
+        u8 first = source[0];
+        u8 middle = source[byteCount >> 1];
+        u8 last = source[byteCount - 1];
+        dest[0] = first;
+        dest[byteCount >> 1] = middle;
+        dest[byteCount - 1] = last;
+    }
+}
+
+internal void ZeroSmall(size_t size, u8 *dest)
+{
+    if (size >= 8)
+    {
+        *(u64 *)dest = 0;
+        *(u64 *)(dest + size - 8) = 0;
+    }
+    else if (size >= 4)
+    {
+        *(u32 *)dest = 0;
+        *(u32 *)(dest + size - 4) = 0;
+    }
+    else if (size)
+    {
+        dest[0] = 0;
+        dest[size >> 1] = 0;
+        dest[size - 1] = 0;
+    }
+}
+
+//NOTE (Aske): Forward, so the ranges may overlap as long as dest comes first.
+//Most lines are 5-40 bytes, so the short ones are done right here instead of through the kernel.
+internal void CopySize(size_t byteCount, void *source, void *dest)
+{
+    if (byteCount < 16)
+    {
+        CopySmall(byteCount, (u8 *)source, (u8 *)dest);
+    }
+    else
+    {
+        CopyKernel(byteCount, source, dest);
+    }
+}
+
+internal void ZeroSize(void *ptr, size_t size)
+{
+    if (size < 16)
+    {
+        ZeroSmall(size, (u8 *)ptr);
+    }
+    else
+    {
+        ZeroKernel(ptr, size);
+    }
+}
+
+//NOTE (Aske): How memory is backed. The platform layer clears the flags it can't honour.
+enum platform_memory_flags
+{
+    PlatformMemory_TransparentHugePages = 0x1,  //Ask the kernel to back the memory with huge pages when it can
+    PlatformMemory_HugeTlb = 0x2,               //Explicit huge pages from the preallocated pool
+    PlatformMemory_Prefault = 0x4,              //Fault the pages in when committing, instead of on first touch
+};
+
+//NOTE (Aske): Provided by the platform layer. Reserved memory is only address space,
+//it has to be committed before use. Freshly committed memory is zeroed.
+internal void* PlatformReserveMemory(void *baseAddress, size_t size, u32 *memoryFlags);
+internal b32 PlatformCommitMemory(void *address, size_t size, u32 *memoryFlags);
+internal void PlatformDecommitMemory(void *address, size_t size, u32 memoryFlags);
+
+#define AlignPow2(value, alignment) (((value) + ((alignment) - 1)) & ~((alignment) - 1))
+
+//NOTE (Aske): Commits happen in steps of this size. 64K is the allocation granularity on Windows
+//and a multiple of the page size everywhere else. Huge pages have to be committed whole.
+#define ArenaCommitGranularity Kilobytes(64)
+#define HugePageSize Megabytes(2)
+
+enum arena_flags
+{
+    ArenaFlag_Growable = 0x1,         //size is only reserved, and pages are committed as used grows
+    ArenaFlag_DecommitOnReset = 0x2,  //Whole granules freed by resets, pops and restores are decommitted
+};
+
 struct memory_arena
 {
     size_t size;
     u8 *base;
     size_t used;
+    size_t committed; //NOTE (Aske): Only meaningful for growable arenas
+    size_t commitGranularity;
+    u32 flags;
+    u32 memoryFlags;
     u32 _savePointCount;
     size_t _savePoints[8];
 };
 
-internal void ZeroSize(void *ptr, size_t size)
+#define ZeroArray(array) for (size_t i = 0; i < ArrayCount(array); ++i) array[i] = 0
+
+internal void InitializeArena(memory_arena *arena, void *base, size_t size, u32 flags)
 {
-    u8 *byte = (u8 *)ptr;
-    while(size--) { *byte++ = 0; }
+    *arena = {};
+    arena->base = (u8 *)base;
+    arena->size = size;
+    arena->flags = flags;
+    arena->committed = (flags & ArenaFlag_Growable) ? 0 : size;
+    arena->commitGranularity = ArenaCommitGranularity;
+}
+
+//NOTE (Aske): Reserves the address space for a growable arena, backed as memoryFlags asks for
+internal b32 ReserveArena(memory_arena *arena, void *baseAddress, size_t size, u32 flags, u32 memoryFlags)
+{
+    void *base = PlatformReserveMemory(baseAddress, size, &memoryFlags);
+    InitializeArena(arena, base, size, flags | ArenaFlag_Growable);
+    arena->memoryFlags = memoryFlags;
+    if (memoryFlags & (PlatformMemory_TransparentHugePages | PlatformMemory_HugeTlb))
+    {
+        arena->commitGranularity = HugePageSize;
+    }
+    return (base != 0);
+}
+
+//NOTE (Aske): Everything from used and up must be zero, since strings rely on it for null-terminators.
+//Decommitted pages come back zeroed, so only the part that stays committed is cleared.
+internal void ZeroArenaFrom(memory_arena *arena, size_t newUsed, size_t oldUsed)
+{
+    if ((arena->flags & ArenaFlag_Growable) && (arena->flags & ArenaFlag_DecommitOnReset))
+    {
+        size_t keepCommitted = AlignPow2(newUsed + 1, arena->commitGranularity);
+        if (keepCommitted < arena->committed)
+        {
+            PlatformDecommitMemory(arena->base + keepCommitted, arena->committed - keepCommitted,
+                                   arena->memoryFlags);
+            arena->committed = keepCommitted;
+        }
+        oldUsed = Minimum(oldUsed, keepCommitted);
+    }
+    ZeroSize(arena->base + newUsed, oldUsed - newUsed);
 }
-#define ZeroArray(array) for (size_t i = 0; i < ArrayCount(array); ++i) array[i] = 0
 
 internal void PopSize(memory_arena *arena, size_t size)
 {
@@ -128,7 +336,7 @@ internal void ZeroPopSize(memory_arena *arena, size_t size)
     Assert(arena->used >= size);
     size_t oldMemoryIndex = arena->used;
     arena->used -= size;
-    ZeroSize(arena->base + arena->used, oldMemoryIndex - arena->used);
+    ZeroArenaFrom(arena, arena->used, oldMemoryIndex);
 }
 
 internal void SaveArena(memory_arena *arena)
@@ -148,19 +356,168 @@ internal void ZeroRestoreArena(memory_arena *arena)
     Assert(arena->_savePointCount > 0);
     size_t oldMemoryIndex = arena->used;
     arena->used = arena->_savePoints[--arena->_savePointCount];
-    ZeroSize(arena->base + arena->used, oldMemoryIndex - arena->used);
+    ZeroArenaFrom(arena, arena->used, oldMemoryIndex);
+}
+
+internal void ResetArena(memory_arena *arena)
+{
+    size_t oldMemoryIndex = arena->used;
+    arena->used = 0;
+    arena->_savePointCount = 0;
+    ZeroArenaFrom(arena, 0, oldMemoryIndex);
+}
+
+internal void CommitArenaUpTo(memory_arena *arena, size_t requiredSize)
+{
+    size_t newCommitted = Minimum(AlignPow2(requiredSize, arena->commitGranularity), arena->size);
+    b32 isCommitted = PlatformCommitMemory(arena->base + arena->committed, newCommitted - arena->committed,
+                                           &arena->memoryFlags);
+    Assert(isCommitted);
+    arena->committed = newCommitted;
 }
 
 internal void * PushSize(memory_arena *arena, size_t size)
 {
     //Last byte needs to be 0 for strings, so (newUsed <= size) is not allowed
     Assert((arena->used + size) < arena->size);
+    if ((arena->used + size) >= arena->committed)
+    {
+        CommitArenaUpTo(arena, arena->used + size + 1);
+    }
     u8 *result = arena->base + arena->used;
     arena->used += size;
     return (void *)result;
 }
 
+//NOTE (Aske): Where the next push will go, with at least size bytes committed there, but nothing pushed.
+//For writing something in place whose size is only known once it's written, and then pushing just that much.
+internal void * PrepareSize(memory_arena *arena, size_t size)
+{
+    Assert((arena->used + size) < arena->size);
+    if ((arena->used + size) >= arena->committed)
+    {
+        CommitArenaUpTo(arena, arena->used + size + 1);
+    }
+    return (void *)(arena->base + arena->used);
+}
+
 #define PushStruct(arena, type) (type *)PushSize((arena), sizeof(type))
 //NOTE (Aske): bufferSize is in bytes
 #define PushStructBuffer(arena, type, bufferSize) (type *)PushSize((arena), (bufferSize + sizeof(type)))
-#define PushArray(arena, count, type) (type *)PushSize(arena, (count)*sizeof(type))
\ No newline at end of file
+#define PushArray(arena, count, type) (type *)PushSize(arena, (count)*sizeof(type))
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Services the platform layer provides to the decoder
+//(win32_platform.cpp or posix_platform.cpp)
+//-------------------------------------------------------------------------
+
+//NOTE (Aske): Contents holds the bytes [WindowOffset, WindowOffset + WindowSize) of the file.
+//When the entire file is read that's all of it, when streaming it's the current window.
+//CurrentIndex and ContentsSize are always relative to the start of the file.
+struct debug_read_file_result
+{
+    u64 ContentsSize;
+    void* Contents;
+    s64 CurrentIndex;
+    s64 WindowOffset;
+    u64 WindowSize;
+};
+
+//NOTE (Aske): Contents is always followed by at least InputGuardSize readable bytes, which are zero past the end
+//of the file. So the bytes of an instruction are read without checking each one, and running off the end
+//is caught once per instruction instead.
+#define InputGuardSize 16
+
+internal debug_read_file_result ReadEntireFile(char* filename);
+internal void FreeFileMemory(debug_read_file_result *file);
+internal b32 WriteEntireFile(char* filename, u32 memorySize, void* memory);
+
+struct platform_file
+{
+    b32 isValid;
+    u64 size; //NOTE (Aske): Only known up front when reading
+    umm handle;
+};
+
+internal platform_file PlatformOpenFileForReading(char *filename);
+internal platform_file PlatformOpenFileForWriting(char *filename);
+//NOTE (Aske): Only returns fewer bytes than requested at the end of the file
+internal u64 PlatformReadFromFile(platform_file *file, void *destination, u64 size);
+internal b32 PlatformWriteToFile(platform_file *file, void *source, u64 size);
+internal void PlatformCloseFile(platform_file *file);
+internal platform_file PlatformGetStandardOutput();
+internal platform_file PlatformGetStandardError();
+
+struct platform_file_info
+{
+    char *name; //NOTE (Aske): Without the directory
+    u64 size;
+    u64 lastWriteTime; //NOTE (Aske): In the platform's own units, only for comparing to each other
+};
+
+struct platform_directory_listing
+{
+    s32 count;
+    platform_file_info *files;
+};
+
+//NOTE (Aske): Regular files only. Names and all are pushed on arena. A missing directory lists as empty.
+internal platform_directory_listing PlatformListDirectory(memory_arena *arena, char *directory);
+//NOTE (Aske): Succeeds when the directory is already there
+internal b32 PlatformCreateDirectory(char *path);
+internal b32 PlatformDeleteFile(char *path);
+//NOTE (Aske): Replaces newPath if it exists, in one step
+internal b32 PlatformRenameFile(char *oldPath, char *newPath);
+//NOTE (Aske): Sets the last write time to now
+internal void PlatformTouchFile(char *path);
+//NOTE (Aske): Fails for anything but a regular file. The name is left 0.
+internal b32 PlatformGetFileInfo(char *path, platform_file_info *info);
+
+struct platform_write_chunk
+{
+    void *data;
+    u64 size;
+};
+
+//NOTE (Aske): Writes all chunks in order, in as few system calls as possible
+internal b32 PlatformWriteGather(platform_file *file, platform_write_chunk *chunks, u32 chunkCount);
+
+//NOTE (Aske): Sockets are platform_files, read and written like any other, and closed with PlatformCloseFile.
+//A listening socket at path, replacing a socket file that's left there.
+internal platform_file PlatformListenOnLocalSocket(char *path);
+//NOTE (Aske): Blocks until a connection comes in on listener
+internal platform_file PlatformAcceptConnection(platform_file *listener);
+//NOTE (Aske): Blocks until at least one of the files can be read from (or was hung up), and sets isReadable for each
+internal b32 PlatformWaitForReadable(platform_file *files, s32 count, b32 *isReadable);
+
+//NOTE (Aske): Memory is expected to be zeroed
+internal void* PlatformAllocateMemory(void *baseAddress, size_t size);
+internal void PlatformFreeMemory(void *memory, size_t size);
+
+struct platform_page_faults
+{
+    u64 minor; //NOTE (Aske): Windows doesn't tell them apart, so everything is counted as minor there
+    u64 major;
+};
+
+internal platform_page_faults PlatformGetPageFaults();
+
+//NOTE (Aske): Monotonic, only meaningful as a difference between two calls
+internal f64 PlatformGetWallClockSeconds();
+internal void PlatformSleepMilliseconds(u32 milliseconds);
+
+#define PLATFORM_THREAD_PROC(name) void name(void *data)
+typedef PLATFORM_THREAD_PROC(platform_thread_proc);
+
+//NOTE (Aske): Has to stay at the same address until joined, since the new thread is handed a pointer to it
+struct platform_thread
+{
+    b32 isValid;
+    umm handle;
+    platform_thread_proc *proc;
+    void *data;
+};
+
+internal b32 PlatformStartThread(platform_thread *thread, platform_thread_proc *proc, void *data);
+internal void PlatformJoinThread(platform_thread *thread);
+internal s32 PlatformGetProcessorCount();
@@ -4,10 +4,11 @@
 //But mostly I just suspect there's simpler solutions in this context, if pursued.
 //I get that feeling any time I use a generallized solution for a specific use-case.
 
-#define PushPolyArray(arena, arrayPtrName, bufferSize, type)\
-PushStructBuffer(arena, array_##type, bufferSize);		\
-arrayPtrName->base = (##type *)(arrayPtrName + 1);		\
-arrayPtrName->size = bufferSize
+//NOTE (Aske): elementCount is the capacity in elements, not bytes
+#define PushPolyArray(arena, arrayPtrName, elementCount, type)\
+PushStructBuffer(arena, array_##type, (elementCount) * sizeof(type));	\
+arrayPtrName->base = (type *)(arrayPtrName + 1);						\
+arrayPtrName->size = elementCount
 
 struct array_s32
 {
@@ -114,7 +115,7 @@ internal void Array32MergeSortAscending(array_s32 *array, memory_arena *arena)
                     destination = array->base;
                 }
 
-                NaiveWiderCopy(clusterSize * sizeof(s32), source, destination);
+                CopySize(clusterSize * sizeof(s32), source, destination);
             }
         }
 
@@ -171,8 +172,9 @@ enum label_type
 
 struct label_position
 {
-    s32 byteAddress;
-    s32 poolOffset;
+    s64 byteAddress;
+    s64 poolOffset;
+    b32 isPrefixPending; //NOTE (Aske): Only for label spaces. The line starts with InstructionFlag_prefixPending
 };
 
 struct array_label_position
@@ -183,15 +185,22 @@ struct array_label_position
     label_type type;
 };
 
-internal void ArrayLabelPosAdd(array_label_position *array, s32 byteAddress, s32 stringPoolPos)
+internal void ArrayLabelPosAdd(array_label_position *array, s64 byteAddress, s64 stringPoolPos)
 {
     Assert(array->count < array->size);
     label_position *labelPos = (array->base + array->count++);
     labelPos->byteAddress = byteAddress;
     labelPos->poolOffset = stringPoolPos;
+    labelPos->isPrefixPending = false;
 }
 
-internal b32 ArrayLabelPosFromFilebyteSorted(array_label_position *array, s32 fileByte, label_position *result)
+internal void ArrayLabelSpaceAdd(array_label_position *array, s64 byteAddress, s64 stringPoolPos, b32 isPrefixPending)
+{
+    ArrayLabelPosAdd(array, byteAddress, stringPoolPos);
+    array->base[array->count - 1].isPrefixPending = isPrefixPending;
+}
+
+internal b32 ArrayLabelPosFromFilebyteSorted(array_label_position *array, s64 fileByte, label_position *result)
 {
     label_position *left = array->base;
     label_position *right = array->base + (array->count - 1);
@@ -212,7 +221,7 @@ internal b32 ArrayLabelPosFromFilebyteSorted(array_label_position *array, s32 fi
     return false;
 }
 
-internal b32 ArrayLabelPosFromFilebyte(array_label_position *array, s32 fileByte, label_position *result)
+internal b32 ArrayLabelPosFromFilebyte(array_label_position *array, s64 fileByte, label_position *result)
 {
 
     for (label_position *cursor = array->base; cursor < (array->base + array->count); ++cursor)
@@ -228,6 +237,14 @@ internal b32 ArrayLabelPosFromFilebyte(array_label_position *array, s32 fileByte
     return false;
 }
 
+internal void ArrayLabelPosRemoveFirst(array_label_position *array, s64 removeCount)
+{
+    Assert(removeCount <= array->count);
+    array->count -= removeCount;
+    //NOTE (Aske): Forward copy, so overlapping is fine when the destination comes first
+    CopySize(array->count * sizeof(label_position), array->base + removeCount, array->base);
+}
+
 
 
 struct bit_array
@@ -0,0 +1,881 @@
+//NOTE (Aske): -bench:<name> file... runs a benchmark over the files instead of writing listings.
+//Every variant runs BenchmarkRepeatCount times over the whole corpus, and the fastest run is reported,
+//since that's the one the rest of the machine disturbed the least.
+#define BenchmarkRepeatCount 10
+
+struct benchmark_corpus
+{
+	s32 count;
+	debug_read_file_result *files;
+	u64 totalSize;
+};
+
+internal benchmark_corpus LoadBenchmarkCorpus(memory_arena *arena, int argc, char* argv[])
+{
+	benchmark_corpus result = {};
+	result.files = PushArray(arena, argc, debug_read_file_result);
+	for (s32 argIndex = 1; argIndex < argc; ++argIndex)
+	{
+		char *arg = argv[argIndex];
+		if (arg[0] == '-')
+		{
+			continue;
+		}
+
+		debug_read_file_result file = ReadEntireFile(arg);
+		if (file.Contents)
+		{
+			result.files[result.count++] = file;
+			result.totalSize += file.ContentsSize;
+		}
+		else
+		{
+			printf("Failed reading: %s\n", arg);
+		}
+	}
+	return result;
+}
+
+internal void FreeBenchmarkCorpus(benchmark_corpus *corpus)
+{
+	for (s32 fileIndex = 0; fileIndex < corpus->count; ++fileIndex)
+	{
+		FreeFileMemory(corpus->files + fileIndex);
+	}
+}
+
+internal void PrintBenchmarkResult(char *variantName, f64 seconds, u64 byteCount, s64 itemCount, char *itemName)
+{
+	f64 megabyte = (f64)Megabytes(1);
+	printf("%-12s %8.3f ms  %9.2f MB/s  %7.2f ns/%s\n", variantName, seconds * 1000.0,
+	       (byteCount / megabyte) / seconds, (seconds * 1000000000.0) / itemCount, itemName);
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): -bench:dispatch, the function table against computed goto
+//-------------------------------------------------------------------------
+
+typedef b32 decode_record_batch(decoder_state *decoderState, debug_read_file_result *file,
+                                input_stream *inputStream, decoded_instructions *batch, s64 stopIndex);
+
+//NOTE (Aske): The checksum keeps the records from being optimized away, and shows both produce the same ones
+internal u64 DecodeCorpusRecords(benchmark_corpus *corpus, decode_record_batch *decodeBatch,
+                                 decoded_instructions *batch, memory_arena *scratchPad, s64 *instructionCount)
+{
+	u64 checksum = 0;
+	*instructionCount = 0;
+	for (s32 fileIndex = 0; fileIndex < corpus->count; ++fileIndex)
+	{
+		debug_read_file_result file = corpus->files[fileIndex];
+		file.CurrentIndex = -1;
+
+		decoder_state decoderState = {};
+		decoderState.ScratchPad = scratchPad;
+		decoderState.endedWithNewLine = true;
+
+		b32 isDecoding = true;
+		while (isDecoding)
+		{
+			batch->count = 0;
+			isDecoding = decodeBatch(&decoderState, &file, 0, batch, Sint64Max);
+			for (s64 i = 0; i < batch->count; ++i)
+			{
+				checksum = checksum * 31 + batch->offset[i] + batch->length[i] + batch->mnemonic[i] +
+				           batch->operand1[i].value + batch->operand2[i].value;
+			}
+			*instructionCount += batch->count;
+		}
+	}
+	return checksum;
+}
+
+internal f64 TimeCorpusRecords(benchmark_corpus *corpus, decode_record_batch *decodeBatch,
+                               decoded_instructions *batch, memory_arena *scratchPad,
+                               s64 *instructionCount, u64 *checksum)
+{
+	f64 fastestSeconds = 0;
+	for (s32 repeat = 0; repeat < BenchmarkRepeatCount; ++repeat)
+	{
+		f64 secondsBefore = PlatformGetWallClockSeconds();
+		*checksum = DecodeCorpusRecords(corpus, decodeBatch, batch, scratchPad, instructionCount);
+		f64 seconds = PlatformGetWallClockSeconds() - secondsBefore;
+		if ((repeat == 0) || (seconds < fastestSeconds))
+		{
+			fastestSeconds = seconds;
+		}
+	}
+	return fastestSeconds;
+}
+
+internal b32 BenchmarkDispatch(benchmark_corpus *corpus, memory_arena *scratchPad)
+{
+	SaveArena(scratchPad);
+	decoded_instructions batch = PushDecodedInstructions(scratchPad, DecodeBatchSize);
+
+	s64 tableCount;
+	u64 tableChecksum;
+	f64 tableSeconds = TimeCorpusRecords(corpus, DecodeRecordBatch, &batch, scratchPad, &tableCount, &tableChecksum);
+	PrintBenchmarkResult("table", tableSeconds, corpus->totalSize, tableCount, "instruction");
+
+	b32 result = true;
+#if DECODER_COMPUTED_GOTO
+	s64 threadedCount;
+	u64 threadedChecksum;
+	f64 threadedSeconds = TimeCorpusRecords(corpus, DecodeRecordBatchThreaded, &batch, scratchPad,
+	                                        &threadedCount, &threadedChecksum);
+	PrintBenchmarkResult("threaded", threadedSeconds, corpus->totalSize, threadedCount, "instruction");
+	printf("threaded is %.2fx the speed of table\n", tableSeconds / threadedSeconds);
+
+	result = (tableCount == threadedCount) && (tableChecksum == threadedChecksum);
+	if (!result)
+	{
+		printf("The two dispatch engines decoded different records!\n");
+	}
+#else
+	printf("threaded isn't available, since this compiler doesn't have computed goto\n");
+#endif
+
+	ZeroRestoreArena(scratchPad);
+	return result;
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): -bench:format, FormatStringList against the fixed-shape emitters
+//-------------------------------------------------------------------------
+
+//NOTE (Aske): How RenderInstructionText rendered a record before it had the emitters, through the general formatter.
+//Kept to measure against, and to check the emitters give the same text.
+//NOTE (Aske): Long enough for "word cs:[bx + si -32768]"
+#define GenericOperandTextSize 32
+
+internal size_t FormatOperandGeneric(char *output, decoded_instruction *decoded, instruction_operand *operand)
+{
+	char *size = "";
+	if ((operand->flags & OperandFlag_sized) && (decoded->flags & InstructionFlag_wide))
+	{
+		size = "word ";
+	}
+	else if (operand->flags & OperandFlag_sized)
+	{
+		size = "byte ";
+	}
+
+	size_t result = 0;
+	switch (operand->kind)
+	{
+		case Operand_register8:
+		{
+			result = FormatString(GenericOperandTextSize, output, "%s%s", size, regs8bit[operand->value].text);
+		} break;
+		case Operand_register16:
+		{
+			result = FormatString(GenericOperandTextSize, output, "%s%s", size, regs16bit[operand->value].text);
+		} break;
+		case Operand_segmentRegister:
+		{
+			result = FormatString(GenericOperandTextSize, output, "%s%s", size, segmentRegisters[operand->value].text);
+		} break;
+		case Operand_memory:
+		{
+			char *segment = segmentPrefixes[decoded->segmentPrefix].text;
+			u8 rnm = operand->value;
+			if (decoded->mod == 0 && rnm == 6) //110 - DIRECT ADDRESS "+ 16-bit displacement"
+			{
+				result = FormatString(GenericOperandTextSize, output, "%s%s[%hu]", size, segment, decoded->displacement);
+			}
+			else if (decoded->mod == 0 || decoded->displacement == 0)
+			{
+				result = FormatString(GenericOperandTextSize, output, "%s%s[%s]", size, segment, rnmForNon3Mods[rnm].text);
+			}
+			else
+			{
+				result = FormatString(GenericOperandTextSize, output, "%s%s[%s %+hd]",
+				                      size, segment, rnmForNon3Mods[rnm].text, decoded->displacement);
+			}
+		} break;
+		case Operand_directAddress:
+		{
+			result = FormatString(GenericOperandTextSize, output, "%s[%hd]", size, decoded->displacement);
+		} break;
+		case Operand_immediate:
+		{
+			result = FormatString(GenericOperandTextSize, output, "%s%hd", size, decoded->immediate);
+		} break;
+		case Operand_unsignedByte:
+		{
+			result = FormatString(GenericOperandTextSize, output, "%hhu", (u8)decoded->immediate);
+		} break;
+		InvalidDefaultCase;
+	}
+	return result;
+}
+
+internal void RenderInstructionTextGeneric(string_buffer *outputLine, decoded_instruction *decoded)
+{
+	char *name = mnemonicNames[decoded->mnemonic].text;
+	char operand1[GenericOperandTextSize];
+	char operand2[GenericOperandTextSize];
+	if (decoded->operand1.kind) FormatOperandGeneric(operand1, decoded, &decoded->operand1);
+	if (decoded->operand2.kind) FormatOperandGeneric(operand2, decoded, &decoded->operand2);
+
+	switch (decoded->instructionClass)
+	{
+		case InstructionClass_none:
+		case InstructionClass_segmentPrefix:
+		{
+			outputLine->count = 0;
+		} break;
+		case InstructionClass_operation:
+		{
+			if (decoded->operand2.kind)
+			{
+				FormatStringBufferFromBase(outputLine, "%s %s, %s\n", name, operand1, operand2);
+			}
+			else if (decoded->operand1.kind)
+			{
+				FormatStringBufferFromBase(outputLine, "%s %s\n", name, operand1);
+			}
+			else
+			{
+				FormatStringBufferFromBase(outputLine, "%s\n", name);
+			}
+		} break;
+		case InstructionClass_stringOperation:
+		{
+			//NOTE (Aske): Completes the "rep"/"repn" that the prefix's record left on the line
+			char *repeatSuffix = "";
+			if (decoded->mnemonic == Mnemonic_cmpsb || decoded->mnemonic == Mnemonic_cmpsw)
+			{
+				repeatSuffix = "e";
+			}
+			else if (decoded->mnemonic == Mnemonic_scasb || decoded->mnemonic == Mnemonic_scasw)
+			{
+				repeatSuffix = "z";
+			}
+			else if (decoded->repeatPrefix == State_repeat_when_zf_clear)
+			{
+				repeatSuffix = "e";
+			}
+			FormatStringBufferFromBase(outputLine, "%s %s\n", repeatSuffix, name);
+		} break;
+		case InstructionClass_branch:
+		{
+			if (decoded->flags & InstructionFlag_hasLabel)
+			{
+				FormatStringBufferFromBase(outputLine, "%s label__%lld\n", name, decoded->target);
+			}
+			else
+			{
+				FormatStringBufferFromBase(outputLine, "%s %lld\n", name, decoded->target);
+			}
+		} break;
+		case InstructionClass_relativeBranch:
+		{
+			if (decoded->flags & InstructionFlag_hasLabel)
+			{
+				FormatStringBufferFromBase(outputLine, "%s label__%lld\n", name, decoded->target);
+			}
+			else //$ operator is NASM functionality
+			{
+				s32 relativeAddress = (s32)(decoded->target - (decoded->offset + decoded->length));
+				FormatStringBufferFromBase(outputLine, "%s $+2%+d\n", name, relativeAddress);
+			}
+		} break;
+		case InstructionClass_farBranch:
+		{
+			FormatStringBufferFromBase(outputLine, "%s %hd:%hu\n", name, decoded->immediate, (u16)decoded->target);
+		} break;
+		case InstructionClass_escape:
+		{
+			FormatStringBufferFromBase(outputLine, "%s %s %s\n", name, operand1, operand2);
+		} break;
+		case InstructionClass_repeatPrefix:
+		{
+			FormatStringBufferFromBase(outputLine, "%s", name);
+		} break;
+		case InstructionClass_lockPrefix:
+		{
+			FormatStringBufferFromBase(outputLine, "%s ", name);
+		} break;
+		InvalidDefaultCase;
+	}
+}
+
+typedef void render_instruction_text(string_buffer *outputLine, decoded_instruction *decoded);
+
+//NOTE (Aske): The records are decoded once up front, so only the rendering is timed
+internal s64 DecodeCorpusToRecords(benchmark_corpus *corpus, decoded_instructions *batch, memory_arena *scratchPad,
+                                   decoded_instruction *records)
+{
+	s64 result = 0;
+	for (s32 fileIndex = 0; fileIndex < corpus->count; ++fileIndex)
+	{
+		debug_read_file_result file = corpus->files[fileIndex];
+		file.CurrentIndex = -1;
+
+		decoder_state decoderState = {};
+		decoderState.ScratchPad = scratchPad;
+		decoderState.endedWithNewLine = true;
+
+		b32 isDecoding = true;
+		while (isDecoding)
+		{
+			batch->count = 0;
+			isDecoding = DecodeRecordBatch(&decoderState, &file, 0, batch, Sint64Max);
+			for (s64 i = 0; i < batch->count; ++i)
+			{
+				records[result++] = GetDecodedInstruction(batch, i);
+			}
+		}
+	}
+	return result;
+}
+
+internal f64 TimeRendering(decoded_instruction *records, s64 recordCount, render_instruction_text *render,
+                           string_buffer *line, u64 *textSize, u64 *checksum)
+{
+	f64 fastestSeconds = 0;
+	for (s32 repeat = 0; repeat < BenchmarkRepeatCount; ++repeat)
+	{
+		*textSize = 0;
+		*checksum = 0;
+		f64 secondsBefore = PlatformGetWallClockSeconds();
+		for (s64 i = 0; i < recordCount; ++i)
+		{
+			render(line, records + i);
+			*textSize += line->count;
+			*checksum = *checksum * 31 + (line->count ? (u8)line->data[line->count - 1] : 0);
+		}
+		f64 seconds = PlatformGetWallClockSeconds() - secondsBefore;
+		if ((repeat == 0) || (seconds < fastestSeconds))
+		{
+			fastestSeconds = seconds;
+		}
+	}
+	return fastestSeconds;
+}
+
+internal b32 BenchmarkFormat(benchmark_corpus *corpus, memory_arena *scratchPad)
+{
+	SaveArena(scratchPad);
+	decoded_instructions batch = PushDecodedInstructions(scratchPad, DecodeBatchSize);
+	//NOTE (Aske): Every instruction is at least a byte long
+	decoded_instruction *records = PushArray(scratchPad, corpus->totalSize, decoded_instruction);
+	s64 recordCount = DecodeCorpusToRecords(corpus, &batch, scratchPad, records);
+
+	string_buffer *genericLine = PushStringBuffer(scratchPad, genericLine, 128);
+	string_buffer *emittedLine = PushStringBuffer(scratchPad, emittedLine, 128);
+
+	u64 genericSize;
+	u64 genericChecksum;
+	f64 genericSeconds = TimeRendering(records, recordCount, RenderInstructionTextGeneric, genericLine,
+	                                   &genericSize, &genericChecksum);
+	PrintBenchmarkResult("generic", genericSeconds, genericSize, recordCount, "instruction");
+
+	u64 emittedSize;
+	u64 emittedChecksum;
+	f64 emittedSeconds = TimeRendering(records, recordCount, RenderInstructionText, emittedLine,
+	                                   &emittedSize, &emittedChecksum);
+	PrintBenchmarkResult("emitters", emittedSeconds, emittedSize, recordCount, "instruction");
+	printf("emitters is %.2fx the speed of generic\n", genericSeconds / emittedSeconds);
+
+	b32 result = true;
+	for (s64 i = 0; (i < recordCount) && result; ++i)
+	{
+		RenderInstructionTextGeneric(genericLine, records + i);
+		RenderInstructionText(emittedLine, records + i);
+		result = (genericLine->count == emittedLine->count);
+		for (s64 charIndex = 0; result && (charIndex < genericLine->count); ++charIndex)
+		{
+			result = (genericLine->data[charIndex] == emittedLine->data[charIndex]);
+		}
+		if (!result)
+		{
+			printf("The two renderers disagree at offset %lld: \"%.*s\" and \"%.*s\"\n", (long long)records[i].offset,
+			       (int)genericLine->count, genericLine->data, (int)emittedLine->count, emittedLine->data);
+		}
+	}
+
+	ZeroRestoreArena(scratchPad);
+	return result;
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): -bench:itoa, U64ToAscii against U64ToDecimal and U64ToHex
+//-------------------------------------------------------------------------
+
+typedef void convert_u64(format_cursor *dest, u64 value);
+
+internal void DecimalWithDivisions(format_cursor *dest, u64 value)
+{
+	U64ToAscii(dest, value, 10, "0123456789");
+}
+
+internal void DecimalWithPairs(format_cursor *dest, u64 value)
+{
+	U64ToDecimal(dest, value);
+}
+
+internal void HexWithTable(format_cursor *dest, u64 value)
+{
+	U64ToAscii(dest, value, 16, "0123456789abcdef");
+}
+
+internal void HexWithMask(format_cursor *dest, u64 value)
+{
+	U64ToHex(dest, value, false);
+}
+
+internal void UpperHexWithTable(format_cursor *dest, u64 value)
+{
+	U64ToAscii(dest, value, 16, "0123456789ABCDEF");
+}
+
+internal void UpperHexWithMask(format_cursor *dest, u64 value)
+{
+	U64ToHex(dest, value, true);
+}
+
+//NOTE (Aske): How EmitSigned wrote a number before U64ToDecimal
+internal void SignedWithDivisions(format_cursor *dest, s64 value)
+{
+	if (value < 0)
+	{
+		OutChar(dest, '-');
+	}
+	DecimalWithDivisions(dest, (value < 0) ? (u64)0 - (u64)value : (u64)value);
+}
+
+internal b32 TextsAreEqual(char *a, format_cursor *aCursor, char *b, format_cursor *bCursor)
+{
+	b32 result = ((aCursor->at - a) == (bCursor->at - b));
+	for (s64 i = 0; result && (i < (aCursor->at - a)); ++i)
+	{
+		result = (a[i] == b[i]);
+	}
+	return result;
+}
+
+internal b32 ConvertersAgree(convert_u64 *reference, convert_u64 *converter, u64 value)
+{
+	char referenceText[24];
+	char text[24];
+	format_cursor referenceCursor = { sizeof(referenceText), referenceText };
+	format_cursor cursor = { sizeof(text), text };
+	reference(&referenceCursor, value);
+	converter(&cursor, value);
+	b32 result = TextsAreEqual(referenceText, &referenceCursor, text, &cursor);
+	if (!result)
+	{
+		printf("Converted %llu to \"%.*s\" instead of \"%.*s\"\n", (unsigned long long)value,
+		       (int)(cursor.at - text), text, (int)(referenceCursor.at - referenceText), referenceText);
+	}
+	return result;
+}
+
+//NOTE (Aske): Every u16 and s16, which is every displacement and immediate there is, and the edges of u64
+internal b32 CheckConverters()
+{
+	convert_u64 *references[3] = { DecimalWithDivisions, HexWithTable, UpperHexWithTable };
+	convert_u64 *converters[3] = { DecimalWithPairs, HexWithMask, UpperHexWithMask };
+	b32 result = true;
+	for (s32 converterIndex = 0; converterIndex < 3; ++converterIndex)
+	{
+		convert_u64 *reference = references[converterIndex];
+		convert_u64 *converter = converters[converterIndex];
+		for (u64 value = 0; result && (value <= Uint16Max); ++value)
+		{
+			result = ConvertersAgree(reference, converter, value);
+		}
+		u64 powerOfTen = 1;
+		for (s32 exponent = 0; result && (exponent < 20); ++exponent, powerOfTen *= 10)
+		{
+			result = ConvertersAgree(reference, converter, powerOfTen - 1) &&
+			         ConvertersAgree(reference, converter, powerOfTen) &&
+			         ConvertersAgree(reference, converter, powerOfTen + 1);
+		}
+		for (s32 shift = 0; result && (shift < 64); ++shift)
+		{
+			result = ConvertersAgree(reference, converter, ((u64)1 << shift) - 1) &&
+			         ConvertersAgree(reference, converter, (u64)1 << shift);
+		}
+		result = result && ConvertersAgree(reference, converter, Uint64Max);
+	}
+
+	for (s32 value = Sint16Min; result && (value <= Sint16Max); ++value)
+	{
+		char referenceText[24];
+		char text[24];
+		format_cursor referenceCursor = { sizeof(referenceText), referenceText };
+		format_cursor cursor = { sizeof(text), text };
+		SignedWithDivisions(&referenceCursor, value);
+		EmitSigned(&cursor, value, false);
+		result = TextsAreEqual(referenceText, &referenceCursor, text, &cursor);
+		if (!result)
+		{
+			printf("Emitted %d as \"%.*s\"\n", value, (int)(cursor.at - text), text);
+		}
+	}
+	return result;
+}
+
+internal f64 TimeConversions(u64 *values, s64 valueCount, convert_u64 *converter, u64 *textSize)
+{
+	char text[32];
+	f64 fastestSeconds = 0;
+	for (s32 repeat = 0; repeat < BenchmarkRepeatCount; ++repeat)
+	{
+		*textSize = 0;
+		f64 secondsBefore = PlatformGetWallClockSeconds();
+		for (s64 i = 0; i < valueCount; ++i)
+		{
+			format_cursor cursor = { sizeof(text), text };
+			converter(&cursor, values[i]);
+			*textSize += cursor.at - text;
+		}
+		f64 seconds = PlatformGetWallClockSeconds() - secondsBefore;
+		if ((repeat == 0) || (seconds < fastestSeconds))
+		{
+			fastestSeconds = seconds;
+		}
+	}
+	return fastestSeconds;
+}
+
+//NOTE (Aske): Times the numbers the corpus actually renders: displacements, immediates and branch targets
+internal b32 BenchmarkIntegerToAscii(benchmark_corpus *corpus, memory_arena *scratchPad)
+{
+	b32 result = CheckConverters();
+	printf("Every u16 and s16 %s\n", result ? "converts the same" : "doesn't convert the same!");
+
+	SaveArena(scratchPad);
+	decoded_instructions batch = PushDecodedInstructions(scratchPad, DecodeBatchSize);
+	decoded_instruction *records = PushArray(scratchPad, corpus->totalSize, decoded_instruction);
+	s64 recordCount = DecodeCorpusToRecords(corpus, &batch, scratchPad, records);
+
+	u64 *values = PushArray(scratchPad, recordCount * 3, u64);
+	s64 valueCount = 0;
+	for (s64 i = 0; i < recordCount; ++i)
+	{
+		decoded_instruction *decoded = records + i;
+		if (decoded->displacement)
+		{
+			values[valueCount++] = (u16)decoded->displacement;
+		}
+		if (decoded->immediate)
+		{
+			values[valueCount++] = (u16)decoded->immediate;
+		}
+		if (decoded->instructionClass == InstructionClass_branch ||
+		    decoded->instructionClass == InstructionClass_relativeBranch)
+		{
+			values[valueCount++] = (u64)decoded->target;
+		}
+	}
+
+	char *names[4] = { "divisions", "pairs", "hex table", "hex mask" };
+	convert_u64 *converters[4] = { DecimalWithDivisions, DecimalWithPairs, HexWithTable, HexWithMask };
+	f64 seconds[4];
+	for (s32 converterIndex = 0; converterIndex < 4; ++converterIndex)
+	{
+		u64 textSize;
+		seconds[converterIndex] = TimeConversions(values, valueCount, converters[converterIndex], &textSize);
+		PrintBenchmarkResult(names[converterIndex], seconds[converterIndex], textSize, valueCount, "number");
+	}
+	printf("pairs is %.2fx the speed of divisions, hex mask is %.2fx the speed of hex table\n",
+	       seconds[0] / seconds[1], seconds[2] / seconds[3]);
+
+	ZeroRestoreArena(scratchPad);
+	return result;
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): -bench:memory, the plain copy and zero loops against the SIMD kernels
+//-------------------------------------------------------------------------
+
+#define MemoryCheckMaxSize 300
+#define MemoryCheckBufferSize 512
+//NOTE (Aske): Every size moves about this much per timed run, in as many calls as that takes
+#define MemoryBenchmarkRunSize Megabytes(16)
+#define MemoryBenchmarkBufferSize Megabytes(2)
+
+internal b32 BuffersAreEqual(u8 *a, u8 *b, size_t size)
+{
+	b32 result = true;
+	for (size_t i = 0; result && (i < size); ++i)
+	{
+		result = (a[i] == b[i]);
+	}
+	return result;
+}
+
+internal void FillPattern(u8 *buffer, size_t size, u32 seed)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		buffer[i] = (u8)((i * 131 + seed * 71) ^ (i >> 3));
+	}
+}
+
+//NOTE (Aske): Every size up to MemoryCheckMaxSize from every alignment, against NaiveSlowCopy and NaiveZeroSize,
+//checking the bytes around the range too. Copies also go backwards by up to two AVX-512 vectors within one
+//buffer, which is the overlap the callers rely on.
+internal b32 CheckMemoryKernel(u32 level, u8 *source, u8 *expected, u8 *actual)
+{
+	copy_kernel *copy = copyKernels[level];
+	zero_kernel *zero = zeroKernels[level];
+	FillPattern(source, MemoryCheckBufferSize, 1);
+
+	b32 result = true;
+	for (size_t size = 0; result && (size <= MemoryCheckMaxSize); ++size)
+	{
+		for (u32 sourceAlign = 0; result && (sourceAlign < 8); ++sourceAlign)
+		{
+			for (u32 destAlign = 0; result && (destAlign < 8); ++destAlign)
+			{
+				FillPattern(expected, MemoryCheckBufferSize, 2);
+				FillPattern(actual, MemoryCheckBufferSize, 2);
+				NaiveSlowCopy(size, source + sourceAlign, expected + 64 + destAlign);
+				copy(size, source + sourceAlign, actual + 64 + destAlign);
+				result = BuffersAreEqual(expected, actual, MemoryCheckBufferSize);
+
+				NaiveZeroSize(expected + 64 + destAlign, size);
+				zero(actual + 64 + destAlign, size);
+				result = result && BuffersAreEqual(expected, actual, MemoryCheckBufferSize);
+				if (!result)
+				{
+					printf("%s gets %llu bytes wrong from +%u to +%u\n", memoryKernelNames[level],
+					       (unsigned long long)size, sourceAlign, destAlign);
+				}
+			}
+		}
+
+		for (u32 distance = 1; result && (distance <= 128); ++distance)
+		{
+			FillPattern(expected, MemoryCheckBufferSize, 3);
+			FillPattern(actual, MemoryCheckBufferSize, 3);
+			NaiveSlowCopy(size, expected + 8 + distance, expected + 8);
+			copy(size, actual + 8 + distance, actual + 8);
+			result = BuffersAreEqual(expected, actual, MemoryCheckBufferSize);
+			if (!result)
+			{
+				printf("%s gets %llu bytes wrong copying back by %u\n", memoryKernelNames[level],
+				       (unsigned long long)size, distance);
+			}
+		}
+	}
+	return result;
+}
+
+//NOTE (Aske): What the callers get: the short ones in CopySize itself, the rest through whichever kernel is set
+internal void *CopyThroughCopySize(size_t byteCount, void *source, void *dest)
+{
+	CopySize(byteCount, source, dest);
+	return (u8 *)dest + byteCount;
+}
+
+internal void *ZeroThroughZeroSize(void *ptr, size_t size)
+{
+	ZeroSize(ptr, size);
+	return (u8 *)ptr + size;
+}
+
+//NOTE (Aske): Calls move one after another through the buffers, like lines appended to the output,
+//and start over at the beginning when the next one doesn't fit. A zero_kernel is timed when copy is 0.
+internal f64 TimeMemoryKernel(copy_kernel *copy, zero_kernel *zero, u8 *source, u8 *dest, size_t size)
+{
+	s64 callCount = Maximum(MemoryBenchmarkRunSize / size, 1);
+	f64 fastestSeconds = 0;
+	for (s32 repeat = 0; repeat < BenchmarkRepeatCount; ++repeat)
+	{
+		size_t at = 0;
+		f64 secondsBefore = PlatformGetWallClockSeconds();
+		for (s64 i = 0; i < callCount; ++i)
+		{
+			if ((at + size) > MemoryBenchmarkBufferSize)
+			{
+				at = 0;
+			}
+			if (copy)
+			{
+				copy(size, source + at, dest + at);
+			}
+			else
+			{
+				zero(dest + at, size);
+			}
+			at += size;
+		}
+		f64 seconds = PlatformGetWallClockSeconds() - secondsBefore;
+		if ((repeat == 0) || (seconds < fastestSeconds))
+		{
+			fastestSeconds = seconds;
+		}
+	}
+	return fastestSeconds / callCount;
+}
+
+//NOTE (Aske): One row of nanoseconds per call, one column per kernel, and how many times faster the last is
+internal void PrintMemoryRow(char *name, f64 *seconds, u32 levelCount)
+{
+	printf("%-10s", name);
+	for (u32 level = 0; level < levelCount; ++level)
+	{
+		printf(" %9.2f", seconds[level] * 1000000000.0);
+	}
+	printf("  %6.2fx\n", seconds[0] / seconds[levelCount - 1]);
+}
+
+internal void PrintMemoryHeader(char *name, u32 levelCount)
+{
+	printf("\n%-10s", name);
+	for (u32 level = 0; level < levelCount; ++level)
+	{
+		printf(" %9s", memoryKernelNames[level]);
+	}
+	printf("  (ns per call)\n");
+}
+
+//NOTE (Aske): Checks every kernel the CPU has, then times them on a spread of sizes, and on copying
+//the corpus's rendered lines one after another the way they're appended to the output.
+internal b32 BenchmarkMemory(benchmark_corpus *corpus, memory_arena *scratchPad)
+{
+	SaveArena(scratchPad);
+	u32 levelCount = DetectMemoryKernelLevel() + 1;
+	printf("Kernels this CPU has:");
+	for (u32 level = 0; level < levelCount; ++level)
+	{
+		printf(" %s", memoryKernelNames[level]);
+	}
+	printf("\n");
+
+	u8 *checkSource = (u8 *)PushSize(scratchPad, MemoryCheckBufferSize);
+	u8 *checkExpected = (u8 *)PushSize(scratchPad, MemoryCheckBufferSize);
+	u8 *checkActual = (u8 *)PushSize(scratchPad, MemoryCheckBufferSize);
+	b32 result = true;
+	for (u32 level = 1; result && (level < levelCount); ++level)
+	{
+		result = CheckMemoryKernel(level, checkSource, checkExpected, checkActual);
+	}
+	printf("Every kernel %s\n", result ? "copies and zeroes like the plain loops" : "doesn't work like the plain loops!");
+
+	u8 *source = (u8 *)PushSize(scratchPad, MemoryBenchmarkBufferSize);
+	u8 *dest = (u8 *)PushSize(scratchPad, MemoryBenchmarkBufferSize);
+	for (u64 i = 0; i < MemoryBenchmarkBufferSize; ++i)
+	{
+		source[i] = ((u8 *)corpus->files[0].Contents)[i % corpus->files[0].ContentsSize];
+	}
+
+	//NOTE (Aske): naive is the plain loop on its own, the others go through CopySize and ZeroSize
+	size_t sizes[] = { 5, 8, 13, 16, 24, 32, 40, 64, 100, 256, Kilobytes(1), Kilobytes(4), Kilobytes(64),
+	                   MemoryBenchmarkBufferSize };
+	char *tableNames[2] = { "copy", "zero" };
+	f64 seconds[MemoryKernel_count];
+	for (s32 isZeroing = 0; isZeroing < 2; ++isZeroing)
+	{
+		PrintMemoryHeader(tableNames[isZeroing], levelCount);
+		for (u32 sizeIndex = 0; sizeIndex < ArrayCount(sizes); ++sizeIndex)
+		{
+			for (u32 level = 0; level < levelCount; ++level)
+			{
+				SetMemoryKernels(level);
+				copy_kernel *copy = level ? CopyThroughCopySize : NaiveWiderCopy;
+				zero_kernel *zero = level ? ZeroThroughZeroSize : NaiveZeroSize;
+				seconds[level] = TimeMemoryKernel(isZeroing ? 0 : copy, zero, source, dest, sizes[sizeIndex]);
+			}
+			char name[16];
+			FormatString(sizeof(name), name, "%llu B", (unsigned long long)sizes[sizeIndex]);
+			PrintMemoryRow(name, seconds, levelCount);
+		}
+	}
+
+	decoded_instructions batch = PushDecodedInstructions(scratchPad, DecodeBatchSize);
+	decoded_instruction *records = PushArray(scratchPad, corpus->totalSize, decoded_instruction);
+	s64 recordCount = DecodeCorpusToRecords(corpus, &batch, scratchPad, records);
+	u8 *lineLengths = PushArray(scratchPad, recordCount, u8);
+	char *text = (char *)PushSize(scratchPad, recordCount * MaxInstructionTextSize);
+	u64 textSize = 0;
+	for (s64 i = 0; i < recordCount; ++i)
+	{
+		string_buffer line = {};
+		line.capacity = MaxInstructionTextSize;
+		line.data = text + textSize;
+		RenderInstructionText(&line, records + i);
+		lineLengths[i] = (u8)line.count;
+		textSize += line.count;
+	}
+	char *output = (char *)PushSize(scratchPad, textSize + MaxInstructionTextSize);
+
+	for (u32 level = 0; level < levelCount; ++level)
+	{
+		SetMemoryKernels(level);
+		copy_kernel *copy = level ? CopyThroughCopySize : NaiveWiderCopy;
+		f64 fastestSeconds = 0;
+		for (s32 repeat = 0; repeat < BenchmarkRepeatCount; ++repeat)
+		{
+			u64 at = 0;
+			f64 secondsBefore = PlatformGetWallClockSeconds();
+			for (s64 i = 0; i < recordCount; ++i)
+			{
+				copy(lineLengths[i], text + at, output + at);
+				at += lineLengths[i];
+			}
+			f64 runSeconds = PlatformGetWallClockSeconds() - secondsBefore;
+			if ((repeat == 0) || (runSeconds < fastestSeconds))
+			{
+				fastestSeconds = runSeconds;
+			}
+		}
+		seconds[level] = fastestSeconds / recordCount;
+	}
+	result = result && BuffersAreEqual((u8 *)text, (u8 *)output, textSize);
+	printf("\n%lld lines of %.1f bytes on average:\n", (long long)recordCount, (f64)textSize / recordCount);
+	PrintMemoryHeader("lines", levelCount);
+	PrintMemoryRow("appended", seconds, levelCount);
+
+	InitializeMemoryKernels();
+	ZeroRestoreArena(scratchPad);
+	return result;
+}
+
+//-------------------------------------------------------------------------
+
+internal int RunBenchmark(char *benchmarkName, memory_arena *scratchPad, int argc, char* argv[])
+{
+	SaveArena(scratchPad);
+	benchmark_corpus corpus = LoadBenchmarkCorpus(scratchPad, argc, argv);
+	if (!corpus.count)
+	{
+		printf("Nothing to benchmark on. Pass the files to decode after -bench:%s\n", benchmarkName);
+		ZeroRestoreArena(scratchPad);
+		return 1;
+	}
+	printf("%s: %d files, %llu bytes, fastest of %d runs\n", benchmarkName, corpus.count,
+	       (unsigned long long)corpus.totalSize, BenchmarkRepeatCount);
+
+	b32 isSuccess = false;
+	if (StringsAreEqual(benchmarkName, "dispatch"))
+	{
+		isSuccess = BenchmarkDispatch(&corpus, scratchPad);
+	}
+	else if (StringsAreEqual(benchmarkName, "format"))
+	{
+		isSuccess = BenchmarkFormat(&corpus, scratchPad);
+	}
+	else if (StringsAreEqual(benchmarkName, "itoa"))
+	{
+		isSuccess = BenchmarkIntegerToAscii(&corpus, scratchPad);
+	}
+	else if (StringsAreEqual(benchmarkName, "memory"))
+	{
+		isSuccess = BenchmarkMemory(&corpus, scratchPad);
+	}
+	else
+	{
+		printf("Unknown benchmark: %s\n", benchmarkName);
+	}
+
+	FreeBenchmarkCorpus(&corpus);
+	ZeroRestoreArena(scratchPad);
+	return isSuccess ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+#!/bin/sh
+
+mkdir -p ../build
+cd ../build
+
+# Mirrors build.bat for gcc/clang.
+# -Wno-write-strings: string literals are passed as char* throughout the decoder.
+# -Wno-unused-*: unused parameters and variables will happen all the time in debug mode.
+# -Wno-unknown-pragmas: #pragma region is only meaningful to Visual Studio.
+CommonCompilerFlags="-O0 -g -fno-exceptions -fno-rtti -Wall -Wno-write-strings -Wno-unused-variable -Wno-unused-but-set-variable -Wno-unused-function -Wno-unused-parameter -Wno-format-security -Wno-sign-compare -Wno-unknown-pragmas"
+CommonCompilerFlags="-DASH_INTERNAL=1 -DASH_SLOW=1 $CommonCompilerFlags"
+
+# TODO: Replace -O0 with -O2 when not in learning mode
+c++ $CommonCompilerFlags -pthread ../code/8086_decoder.cpp -o 8086_decoder
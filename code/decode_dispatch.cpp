@@ -0,0 +1,117 @@
+//NOTE (Aske): The two ways of getting from an opcode to its handler. Both fill a batch with records,
+//until it's full or the cursor reaches stopIndex, and return false once there's nothing left to decode.
+//The table version goes through the function pointer in the opcode descriptor and works everywhere.
+//The threaded version jumps to a label per handler with computed goto, and every label ends with
+//its own fetch and jump to the next handler, so each one gets its own slot in the branch predictor.
+//The handlers are called directly there, so the compiler can inline them too.
+
+internal b32 DecodeRecordBatch(decoder_state *decoderState, debug_read_file_result *file, input_stream *inputStream,
+                               decoded_instructions *batch, s64 stopIndex)
+{
+	while ((batch->count < batch->capacity) && ((file->CurrentIndex + 1) < stopIndex))
+	{
+		byte_of_file byteCursor = GetNextOpsByte(file);
+		if (!byteCursor.isValid)
+		{
+			return false;
+		}
+
+		decoded_instruction decoded = DecodeInstructionRecordCached(decoderState->instructionCache, decoderState,
+		                                                            file, byteCursor.byte);
+		if (decoded.flags & InstructionFlag_truncated)
+		{
+			return false;
+		}
+		AddDecodedInstruction(batch, &decoded);
+
+		if (inputStream)
+		{
+			RefillInputWindow(inputStream, file);
+		}
+	}
+	return true;
+}
+
+#if DECODER_COMPUTED_GOTO
+//NOTE (Aske): Prefixes are folded into the dispatch. After a prefix the next opcode is dispatched
+//without checking stopIndex, so a prefix never ends up in a different batch than its instruction.
+//The batch can still fill up in between, which the renderer handles like it always has.
+//A hit in the instruction cache skips the handler, and goes straight to Dispatch_cached.
+#define DispatchNextInstruction()                                                                      \
+	FinishInstructionRecord(decoderState, file, &decoded);                                             \
+	if (decoded.flags & InstructionFlag_truncated)                                                     \
+	{                                                                                                  \
+		return false;                                                                                  \
+	}                                                                                                  \
+	if (cacheKey)                                                                                      \
+	{                                                                                                  \
+		InsertCachedInstruction(decoderState->instructionCache, decoderState, &decoded, cacheKey);     \
+	}                                                                                                  \
+	DispatchCachedInstruction()
+
+#define DispatchCachedInstruction()                                                                    \
+	AddDecodedInstruction(batch, &decoded);                                                            \
+	if (inputStream)                                                                                   \
+	{                                                                                                  \
+		RefillInputWindow(inputStream, file);                                                          \
+	}                                                                                                  \
+	if ((batch->count >= batch->capacity) ||                                                           \
+	    (!(opcodeTable.descriptors[opcode].flags & OpcodeFlag_prefix) && ((file->CurrentIndex + 1) >= stopIndex))) \
+	{                                                                                                  \
+		return true;                                                                                   \
+	}                                                                                                  \
+	byteCursor = GetNextOpsByte(file);                                                                 \
+	if (!byteCursor.isValid)                                                                           \
+	{                                                                                                  \
+		return false;                                                                                  \
+	}                                                                                                  \
+	opcode = byteCursor.byte;                                                                          \
+	if (decoderState->instructionCache &&                                                              \
+	    LookupCachedInstruction(decoderState->instructionCache, decoderState, file, &decoded, &cacheKey)) \
+	{                                                                                                  \
+		goto Dispatch_cached;                                                                          \
+	}                                                                                                  \
+	decoded = BeginInstructionRecord(decoderState, file, opcode);                                      \
+	goto *handlerLabels[opcodeTable.descriptors[opcode].handlerIndex]
+
+internal b32 DecodeRecordBatchThreaded(decoder_state *decoderState, debug_read_file_result *file,
+                                       input_stream *inputStream, decoded_instructions *batch, s64 stopIndex)
+{
+#define HandlerLabelAddress(name) &&Dispatch_##name,
+	static void *handlerLabels[OpcodeHandlerCount] = { OPCODE_HANDLERS(HandlerLabelAddress) };
+#undef HandlerLabelAddress
+
+	if ((batch->count >= batch->capacity) || ((file->CurrentIndex + 1) >= stopIndex))
+	{
+		return true;
+	}
+	byte_of_file byteCursor = GetNextOpsByte(file);
+	if (!byteCursor.isValid)
+	{
+		return false;
+	}
+	u8 opcode = byteCursor.byte;
+	u64 cacheKey = 0;
+	decoded_instruction decoded;
+	if (decoderState->instructionCache &&
+	    LookupCachedInstruction(decoderState->instructionCache, decoderState, file, &decoded, &cacheKey))
+	{
+		goto Dispatch_cached;
+	}
+	decoded = BeginInstructionRecord(decoderState, file, opcode);
+	goto *handlerLabels[opcodeTable.descriptors[opcode].handlerIndex];
+
+Dispatch_cached:
+	//NOTE (Aske): Never a prefix, and the record is already finished
+	DispatchCachedInstruction();
+
+#define HandlerLabel(name)                           \
+Dispatch_##name:                                     \
+	name(decoderState, &decoded, file, opcode);      \
+	DispatchNextInstruction();
+	OPCODE_HANDLERS(HandlerLabel)
+#undef HandlerLabel
+}
+#undef DispatchNextInstruction
+#undef DispatchCachedInstruction
+#endif
@@ -0,0 +1,337 @@
+//NOTE (Aske): -serve:<socket path> keeps running and answers requests for parts of listings over a Unix domain socket,
+//so a tool that asks for a few instructions at a time doesn't pay for starting a process and decoding the whole file.
+//Every file that's asked for is decoded once, in full and with its index, and kept in memory until it changes.
+//A request for a range of offsets is then a seek in the index and a copy out of the listing.
+//A file is decoded again when its size or last write time isn't what it was when it was decoded.
+//
+//Every message, both ways, is a u32 with the number of bytes that follow, and then those bytes. All little-endian.
+//A request is a server_request followed by the path of the binary, without a null-terminator.
+//An answer is a server_response followed by the text: every line of the listing with an instruction that starts
+//in [startOffset, endOffset), with their label lines, and the line startOffset falls in the middle of, if it does.
+//A range that starts at or past the end of the input gets no text.
+//A connection can send any number of requests, and gets the answers in the same order.
+#define MaxServedFiles 16
+#define MaxServerConnections 32
+#define MaxServerPathLength 4096
+#define ServedListingReservation Gigabytes(8)
+#define ServedIndexReservation Gigabytes(1)
+
+enum server_request_kind
+{
+	ServerRequest_range = 1,
+	ServerRequest_stop = 2, //NOTE (Aske): Answered, and then the server shuts down
+};
+
+enum server_status
+{
+	ServerStatus_ok = 0,
+	ServerStatus_unreadable = 1, //NOTE (Aske): Missing, empty or not a regular file
+	ServerStatus_badRequest = 2,
+	ServerStatus_tooLarge = 3, //NOTE (Aske): The text wouldn't fit in one message, so ask for a smaller range
+};
+
+enum server_response_flags
+{
+	ServerResponseFlag_decoded = 0x1, //NOTE (Aske): The file wasn't in memory, or had changed, and was decoded for this
+	ServerResponseFlag_truncated = 0x2, //NOTE (Aske): The file ends in the middle of an instruction
+};
+
+struct server_request
+{
+	u32 kind;
+	u32 unused;
+	s64 startOffset;
+	s64 endOffset;
+};
+
+struct server_response
+{
+	u32 status;
+	u32 flags;
+	s64 inputSize;
+	s64 firstOffset; //NOTE (Aske): Of the first instruction in the text, -1 when the text is empty
+	s64 firstLineNumber; //NOTE (Aske): In the whole listing, from 1. Its label line's, if it has one.
+};
+
+//NOTE (Aske): Each file has arenas of its own, so one can be thrown away without touching the others.
+//They decommit on reset, so a file that's decoded again or evicted gives its pages back.
+struct served_file
+{
+	b32 isLoaded;
+	b32 isTruncated;
+	char path[MaxServerPathLength + 1];
+	u64 size;
+	u64 lastWriteTime;
+	s64 lastUsed; //NOTE (Aske): The request count when it was last asked for, for evicting the least recently used
+
+	memory_arena listing;
+	memory_arena indexData;
+	listing_index index; //NOTE (Aske): Points into indexData
+};
+
+struct decode_server
+{
+	memory_arena *outputPool;
+	memory_arena *scratchPad;
+	decoder_buffers buffers;
+	served_file *files;
+
+	s64 requestCount;
+	s64 decodeCount;
+};
+
+internal void UnloadServedFile(served_file *served)
+{
+	served->isLoaded = false;
+	served->index = {};
+	ResetArena(&served->listing);
+	ResetArena(&served->indexData);
+}
+
+internal served_file *FindServedFile(decode_server *server, char *path)
+{
+	for (s32 fileIndex = 0; fileIndex < MaxServedFiles; ++fileIndex)
+	{
+		served_file *served = server->files + fileIndex;
+		if (served->isLoaded && StringsAreEqual(served->path, path))
+		{
+			return served;
+		}
+	}
+	return 0;
+}
+
+//NOTE (Aske): An empty slot if there is one, or else the least recently used, which is evicted
+internal served_file *SlotForServedFile(decode_server *server)
+{
+	served_file *result = server->files;
+	for (s32 fileIndex = 0; (fileIndex < MaxServedFiles) && result->isLoaded; ++fileIndex)
+	{
+		served_file *served = server->files + fileIndex;
+		if (!served->isLoaded || (served->lastUsed < result->lastUsed))
+		{
+			result = served;
+		}
+	}
+	return result;
+}
+
+internal b32 LoadServedFile(decode_server *server, served_file *served, char *path, platform_file_info *info)
+{
+	UnloadServedFile(served);
+	if (!served->listing.base)
+	{
+		b32 isReserved = ReserveArena(&served->listing, 0, ServedListingReservation, ArenaFlag_DecommitOnReset, 0) &&
+		                 ReserveArena(&served->indexData, 0, ServedIndexReservation, ArenaFlag_DecommitOnReset, 0);
+		Assert(isReserved);
+	}
+
+	debug_read_file_result file = ReadEntireFile(path);
+	if (!file.Contents)
+	{
+		return false;
+	}
+
+	SaveArena(server->scratchPad);
+	output_sink listingSink;
+	output_sink indexSink;
+	output_sink echoSink;
+	InitializeArenaSink(&listingSink, &served->listing);
+	InitializeArenaSink(&indexSink, &served->indexData);
+	InitializeOutputSink(&echoSink, OutputSink_null, 0, server->scratchPad);
+	listing_index_writer *indexWriter = PushStruct(server->scratchPad, listing_index_writer);
+	indexWriter->sink = &indexSink;
+
+	decode_file_result decoded = {};
+	DecodeListing(&file, 0, path, server->outputPool, server->scratchPad, &server->buffers,
+	              0, &listingSink, indexWriter, &echoSink, 0, &decoded);
+	ZeroRestoreArena(server->scratchPad);
+
+	debug_read_file_result indexFile = {};
+	indexFile.Contents = served->indexData.base;
+	indexFile.ContentsSize = served->indexData.used;
+	served->isLoaded = ReadListingIndex(&indexFile, file.ContentsSize, served->listing.used, &served->index);
+	Assert(served->isLoaded);
+
+	s64 pathLength = StringLength(path);
+	NaiveSlowCopy(pathLength, path, served->path);
+	served->path[pathLength] = 0;
+	served->size = info->size;
+	served->lastWriteTime = info->lastWriteTime;
+	served->isTruncated = decoded.isInputTruncated;
+	++server->decodeCount;
+
+	FreeFileMemory(&file);
+	return served->isLoaded;
+}
+
+internal void AnswerRangeRequest(decode_server *server, server_request *request, char *path,
+                                 server_response *response, string *text)
+{
+	//NOTE (Aske): Checked on every request, since that's cheap next to decoding something that's out of date
+	platform_file_info info;
+	b32 isReadable = PlatformGetFileInfo(path, &info);
+	served_file *served = FindServedFile(server, path);
+	if (served && (!isReadable || (served->size != info.size) || (served->lastWriteTime != info.lastWriteTime)))
+	{
+		UnloadServedFile(served);
+		served = 0;
+	}
+	if (isReadable && !served)
+	{
+		served = SlotForServedFile(server);
+		isReadable = LoadServedFile(server, served, path, &info);
+		response->flags |= ServerResponseFlag_decoded;
+	}
+	if (!isReadable)
+	{
+		response->status = ServerStatus_unreadable;
+		return;
+	}
+
+	served->lastUsed = server->requestCount;
+	response->inputSize = served->size;
+	if (served->isTruncated)
+	{
+		response->flags |= ServerResponseFlag_truncated;
+	}
+
+	listing_index *index = &served->index;
+	listing_index_cursor first = ListingIndexSeek(index, request->startOffset, 0);
+	if (!first.isValid)
+	{
+		first = ListingIndexFirst(index);
+	}
+	//NOTE (Aske): The seek stops at the last line, so a range starting past the input would get it otherwise
+	if ((request->startOffset < request->endOffset) && (request->startOffset < (s64)served->size) && first.isValid &&
+	    (first.entry.inputOffset < request->endOffset))
+	{
+		//NOTE (Aske): The text ends where the first line at or after endOffset starts
+		listing_index_cursor last = ListingIndexSeek(index, request->endOffset - 1, 0);
+		ListingIndexNext(&last);
+		s64 textStart = ListingIndexLineStart(&first.entry);
+		s64 textEnd = last.isValid ? ListingIndexLineStart(&last.entry) : (s64)index->listingSize;
+		if ((textEnd - textStart) > (s64)(Uint32Max - sizeof(server_response)))
+		{
+			response->status = ServerStatus_tooLarge;
+			return;
+		}
+
+		text->count = textEnd - textStart;
+		text->data = (char *)served->listing.base + textStart;
+		response->firstOffset = first.entry.inputOffset;
+		response->firstLineNumber = first.entry.lineNumber - ((first.entry.flags & ListingIndexFlag_hasLabel) ? 1 : 0);
+	}
+}
+
+//NOTE (Aske): Reads one request from connection and answers it. Returns false when the connection should be closed,
+//because it hung up or sent something that isn't a request. Reading blocks, so a client that stops
+//in the middle of a request holds up the others until it's done.
+internal b32 ServeRequest(decode_server *server, platform_file *connection, b32 *isServing)
+{
+	u32 messageSize;
+	if ((PlatformReadFromFile(connection, &messageSize, sizeof(messageSize)) != sizeof(messageSize)) ||
+	    (messageSize < sizeof(server_request)) || (messageSize > (sizeof(server_request) + MaxServerPathLength)))
+	{
+		return false;
+	}
+
+	server_request request;
+	char path[MaxServerPathLength + 1];
+	u64 pathLength = messageSize - sizeof(server_request);
+	if ((PlatformReadFromFile(connection, &request, sizeof(request)) != sizeof(request)) ||
+	    (PlatformReadFromFile(connection, path, pathLength) != pathLength))
+	{
+		return false;
+	}
+	path[pathLength] = 0;
+	++server->requestCount;
+
+	//NOTE (Aske): Stop and bad-request replies have no text either, so they get the same -1
+	server_response response = {};
+	response.firstOffset = -1;
+	string text = {};
+	if ((request.kind == ServerRequest_range) && pathLength && (StringLength(path) == (s64)pathLength))
+	{
+		AnswerRangeRequest(server, &request, path, &response, &text);
+	}
+	else if (request.kind == ServerRequest_stop)
+	{
+		*isServing = false;
+	}
+	else
+	{
+		response.status = ServerStatus_badRequest;
+	}
+
+	u32 responseSize = (u32)(sizeof(response) + text.count);
+	platform_write_chunk chunks[3] = {
+		{ &responseSize, sizeof(responseSize) },
+		{ &response, sizeof(response) },
+		{ text.data, (u64)text.count },
+	};
+	return PlatformWriteGather(connection, chunks, ArrayCount(chunks));
+}
+
+internal int RunDecodeServer(decoder_options *options, memory_arena *outputPool, memory_arena *scratchPad)
+{
+	char *socketPath = options->serverSocketPath;
+	platform_file connections[1 + MaxServerConnections];
+	b32 isReadable[ArrayCount(connections)];
+	connections[0] = PlatformListenOnLocalSocket(socketPath);
+	if (!connections[0].isValid)
+	{
+		fprintf(stderr, "Failed listening on: %s\n", socketPath);
+		return 1;
+	}
+	s32 connectionCount = 1;
+
+	decode_server server = {};
+	server.outputPool = outputPool;
+	server.scratchPad = scratchPad;
+	server.buffers = PushDecoderBuffers(scratchPad);
+	if (options->isCachingInstructions)
+	{
+		server.buffers.instructionCache = PushInstructionCache(scratchPad);
+	}
+	server.files = PushArray(scratchPad, MaxServedFiles, served_file);
+
+	fprintf(stderr, "Serving listings on: %s\n", socketPath);
+
+	b32 isServing = true;
+	while (isServing && PlatformWaitForReadable(connections, connectionCount, isReadable))
+	{
+		//NOTE (Aske): Backwards, so a closed connection can be replaced by the last one, which was already served
+		for (s32 connectionIndex = connectionCount - 1; isServing && (connectionIndex > 0); --connectionIndex)
+		{
+			if (isReadable[connectionIndex] && !ServeRequest(&server, connections + connectionIndex, &isServing))
+			{
+				PlatformCloseFile(connections + connectionIndex);
+				connections[connectionIndex] = connections[--connectionCount];
+			}
+		}
+
+		if (isServing && isReadable[0])
+		{
+			platform_file connection = PlatformAcceptConnection(connections);
+			if (connection.isValid && (connectionCount < (s32)ArrayCount(connections)))
+			{
+				connections[connectionCount++] = connection;
+			}
+			else
+			{
+				PlatformCloseFile(&connection);
+			}
+		}
+	}
+
+	for (s32 connectionIndex = 0; connectionIndex < connectionCount; ++connectionIndex)
+	{
+		PlatformCloseFile(connections + connectionIndex);
+	}
+	PlatformDeleteFile(socketPath);
+
+	fprintf(stderr, "Served %lld requests, decoding %lld files\n",
+	        (long long)server.requestCount, (long long)server.decodeCount);
+	return 0;
+}
@@ -0,0 +1,445 @@
+//NOTE (Aske): The decoder first turns the bytes into decoded_instruction records, and the text is rendered from
+//those in a separate step. Anything that wants the operands, lengths or branch targets can read the records
+//instead of parsing the listing, and anything that doesn't want the text can skip rendering it.
+//Every handler call makes one record, so prefixes get records of their own, just like they get no line of their own.
+
+enum mnemonic
+{
+	Mnemonic_notUsed,
+	Mnemonic_add, Mnemonic_or, Mnemonic_adc, Mnemonic_sbb, Mnemonic_and, Mnemonic_sub, Mnemonic_xor, Mnemonic_cmp,
+	Mnemonic_mov, Mnemonic_inc, Mnemonic_dec, Mnemonic_call, Mnemonic_callFar, Mnemonic_jmp, Mnemonic_jmpFar,
+	Mnemonic_jmpShort, Mnemonic_push, Mnemonic_pop, Mnemonic_test, Mnemonic_xchg, Mnemonic_in, Mnemonic_out,
+	Mnemonic_xlat, Mnemonic_les, Mnemonic_lds, Mnemonic_lea,
+	Mnemonic_cbw, Mnemonic_cwd, Mnemonic_wait, Mnemonic_pushf, Mnemonic_popf, Mnemonic_sahf, Mnemonic_lahf,
+	Mnemonic_daa, Mnemonic_das, Mnemonic_aaa, Mnemonic_aas, Mnemonic_aam, Mnemonic_aad,
+	Mnemonic_not, Mnemonic_neg, Mnemonic_mul, Mnemonic_imul, Mnemonic_div, Mnemonic_idiv,
+	Mnemonic_rol, Mnemonic_ror, Mnemonic_rcl, Mnemonic_rcr, Mnemonic_shl, Mnemonic_shr, Mnemonic_sar,
+	Mnemonic_hlt, Mnemonic_cmc,
+	Mnemonic_movsb, Mnemonic_movsw, Mnemonic_cmpsb, Mnemonic_cmpsw, Mnemonic_stosb, Mnemonic_stosw,
+	Mnemonic_lodsb, Mnemonic_lodsw, Mnemonic_scasb, Mnemonic_scasw,
+	Mnemonic_ret, Mnemonic_retf,
+	Mnemonic_jo, Mnemonic_jno, Mnemonic_jb, Mnemonic_jnb, Mnemonic_je, Mnemonic_jne, Mnemonic_jbe, Mnemonic_ja,
+	Mnemonic_js, Mnemonic_jns, Mnemonic_jp, Mnemonic_jnp, Mnemonic_jl, Mnemonic_jnl, Mnemonic_jle, Mnemonic_jg,
+	Mnemonic_loopne, Mnemonic_loope, Mnemonic_loop, Mnemonic_jcxz,
+	Mnemonic_int3, Mnemonic_int, Mnemonic_into, Mnemonic_iret,
+	Mnemonic_clc, Mnemonic_stc, Mnemonic_cli, Mnemonic_sti, Mnemonic_cld, Mnemonic_std,
+	Mnemonic_esc, Mnemonic_lock, Mnemonic_rep, Mnemonic_repn,
+
+	Mnemonic_count,
+};
+
+//NOTE (Aske): short_text, like the operand tables, so rendering never has to measure them
+global_variable short_text mnemonicNames[Mnemonic_count] =
+{
+	ShortText("NOT USED"),
+	ShortText("add"), ShortText("or"), ShortText("adc"), ShortText("sbb"),
+	ShortText("and"), ShortText("sub"), ShortText("xor"), ShortText("cmp"),
+	ShortText("mov"), ShortText("inc"), ShortText("dec"), ShortText("call"),
+	ShortText("call far"), ShortText("jmp"), ShortText("jmp far"),
+	ShortText("jmp short"), ShortText("push"), ShortText("pop"), ShortText("test"),
+	ShortText("xchg"), ShortText("in"), ShortText("out"),
+	ShortText("xlat"), ShortText("les"), ShortText("lds"), ShortText("lea"),
+	ShortText("cbw"), ShortText("cwd"), ShortText("wait"), ShortText("pushf"),
+	ShortText("popf"), ShortText("sahf"), ShortText("lahf"),
+	ShortText("daa"), ShortText("das"), ShortText("aaa"), ShortText("aas"), ShortText("aam"), ShortText("aad"),
+	ShortText("not"), ShortText("neg"), ShortText("mul"), ShortText("imul"), ShortText("div"), ShortText("idiv"),
+	ShortText("rol"), ShortText("ror"), ShortText("rcl"), ShortText("rcr"),
+	ShortText("shl"), ShortText("shr"), ShortText("sar"),
+	ShortText("hlt"), ShortText("cmc"),
+	ShortText("movsb"), ShortText("movsw"), ShortText("cmpsb"),
+	ShortText("cmpsw"), ShortText("stosb"), ShortText("stosw"),
+	ShortText("lodsb"), ShortText("lodsw"), ShortText("scasb"), ShortText("scasw"),
+	ShortText("ret"), ShortText("retf"),
+	ShortText("jo"), ShortText("jno"), ShortText("jb"), ShortText("jnb"),
+	ShortText("je"), ShortText("jne"), ShortText("jbe"), ShortText("ja"),
+	ShortText("js"), ShortText("jns"), ShortText("jp"), ShortText("jnp"),
+	ShortText("jl"), ShortText("jnl"), ShortText("jle"), ShortText("jg"),
+	ShortText("loopne"), ShortText("loope"), ShortText("loop"), ShortText("jcxz"),
+	ShortText("int3"), ShortText("int"), ShortText("into"), ShortText("iret"),
+	ShortText("clc"), ShortText("stc"), ShortText("cli"), ShortText("sti"), ShortText("cld"), ShortText("std"),
+	ShortText("esc"), ShortText("lock"), ShortText("rep"), ShortText("repn"),
+};
+
+//NOTE (Aske): How the record is rendered
+enum instruction_class
+{
+	InstructionClass_none,          //Unused or unimplemented opcode, renders as nothing
+	InstructionClass_operation,     //mnemonic, then up to two operands separated by a comma
+	InstructionClass_stringOperation,
+	InstructionClass_branch,        //Near branch to target, written as a number when it's outside the file
+	InstructionClass_relativeBranch,//Short branch to target, written as $+2 relative when it's outside the file
+	InstructionClass_farBranch,     //segment in immediate, offset in target
+	InstructionClass_escape,
+	InstructionClass_repeatPrefix,
+	InstructionClass_lockPrefix,
+	InstructionClass_segmentPrefix,
+};
+
+enum operand_kind
+{
+	Operand_none,
+	Operand_register8,
+	Operand_register16,
+	Operand_segmentRegister,
+	Operand_memory,         //value is rnm, with the record's mod, displacement and segmentPrefix
+	Operand_directAddress,  //[displacement], only from the accumulator moves, which never get a segment prefix
+	Operand_immediate,      //The record's immediate
+	Operand_unsignedByte,   //The record's immediate as a port, interrupt type or escape opcode
+};
+
+enum operand_flags
+{
+	OperandFlag_sized = 0x1, //"byte " or "word " is written in front, depending on InstructionFlag_wide
+};
+
+struct instruction_operand
+{
+	u8 kind;
+	u8 value;
+	u8 flags;
+};
+
+enum instruction_flags
+{
+	InstructionFlag_wide = 0x1,
+	InstructionFlag_startsLine = 0x2, //NOTE (Aske): Not preceded by a prefix, so it gets a label space
+	InstructionFlag_hasLabel = 0x4,   //NOTE (Aske): The branch target is inside the file, and is written as a label
+	InstructionFlag_truncated = 0x8,  //NOTE (Aske): The file ended in the middle of it
+	InstructionFlag_prefixPending = 0x10, //NOTE (Aske): Starts a line, but a segment or rep prefix from before it still applies
+};
+
+struct decoded_instruction
+{
+	s64 offset;
+	s64 target;
+	s16 displacement;
+	s16 immediate;
+	u8 length;
+	u8 opcode;
+	u8 instructionClass;
+	u8 mnemonic;
+	u8 flags;
+	u8 mod;
+	u8 segmentPrefix; //NOTE (Aske): 0 for none, otherwise 1 + the segment register
+	u8 repeatPrefix;  //NOTE (Aske): The repeat_state a string operation was decoded with
+	instruction_operand operand1;
+	instruction_operand operand2;
+	u16 cachedText; //NOTE (Aske): 1 + the instruction cache entry with the rendered line, 0 when it isn't cached
+};
+
+internal instruction_operand RegisterOperand(b32 isWide, u8 reg)
+{
+	instruction_operand result = { (u8)(isWide ? Operand_register16 : Operand_register8), reg, 0 };
+	return result;
+}
+
+internal instruction_operand Operand(operand_kind kind, u8 value)
+{
+	instruction_operand result = { (u8)kind, value, 0 };
+	return result;
+}
+
+//NOTE (Aske): ToInstructionLine for records. The destination is written first.
+internal void SetOperands(decoded_instruction *decoded, instruction_operand operand1, instruction_operand operand2,
+                          b32 isOp1Dest)
+{
+	decoded->operand1 = isOp1Dest ? operand1 : operand2;
+	decoded->operand2 = isOp1Dest ? operand2 : operand1;
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Structure-of-arrays storage for many records
+//-------------------------------------------------------------------------
+
+struct decoded_instructions
+{
+	s64 count;
+	s64 capacity;
+
+	s64 *offset;
+	s64 *target;
+	s16 *displacement;
+	s16 *immediate;
+	u8 *length;
+	u8 *opcode;
+	u8 *instructionClass;
+	u8 *mnemonic;
+	u8 *flags;
+	u8 *mod;
+	u8 *segmentPrefix;
+	u8 *repeatPrefix;
+	instruction_operand *operand1;
+	instruction_operand *operand2;
+	u16 *cachedText;
+};
+
+internal decoded_instructions PushDecodedInstructions(memory_arena *arena, s64 capacity)
+{
+	decoded_instructions result = {};
+	result.capacity = capacity;
+	result.offset = PushArray(arena, capacity, s64);
+	result.target = PushArray(arena, capacity, s64);
+	result.displacement = PushArray(arena, capacity, s16);
+	result.immediate = PushArray(arena, capacity, s16);
+	result.length = PushArray(arena, capacity, u8);
+	result.opcode = PushArray(arena, capacity, u8);
+	result.instructionClass = PushArray(arena, capacity, u8);
+	result.mnemonic = PushArray(arena, capacity, u8);
+	result.flags = PushArray(arena, capacity, u8);
+	result.mod = PushArray(arena, capacity, u8);
+	result.segmentPrefix = PushArray(arena, capacity, u8);
+	result.repeatPrefix = PushArray(arena, capacity, u8);
+	result.operand1 = PushArray(arena, capacity, instruction_operand);
+	result.operand2 = PushArray(arena, capacity, instruction_operand);
+	result.cachedText = PushArray(arena, capacity, u16);
+	return result;
+}
+
+internal void AddDecodedInstruction(decoded_instructions *instructions, decoded_instruction *decoded)
+{
+	Assert(instructions->count < instructions->capacity);
+	s64 i = instructions->count++;
+	instructions->offset[i] = decoded->offset;
+	instructions->target[i] = decoded->target;
+	instructions->displacement[i] = decoded->displacement;
+	instructions->immediate[i] = decoded->immediate;
+	instructions->length[i] = decoded->length;
+	instructions->opcode[i] = decoded->opcode;
+	instructions->instructionClass[i] = decoded->instructionClass;
+	instructions->mnemonic[i] = decoded->mnemonic;
+	instructions->flags[i] = decoded->flags;
+	instructions->mod[i] = decoded->mod;
+	instructions->segmentPrefix[i] = decoded->segmentPrefix;
+	instructions->repeatPrefix[i] = decoded->repeatPrefix;
+	instructions->operand1[i] = decoded->operand1;
+	instructions->operand2[i] = decoded->operand2;
+	instructions->cachedText[i] = decoded->cachedText;
+}
+
+internal decoded_instruction GetDecodedInstruction(decoded_instructions *instructions, s64 i)
+{
+	Assert(i < instructions->count);
+	decoded_instruction result;
+	result.offset = instructions->offset[i];
+	result.target = instructions->target[i];
+	result.displacement = instructions->displacement[i];
+	result.immediate = instructions->immediate[i];
+	result.length = instructions->length[i];
+	result.opcode = instructions->opcode[i];
+	result.instructionClass = instructions->instructionClass[i];
+	result.mnemonic = instructions->mnemonic[i];
+	result.flags = instructions->flags[i];
+	result.mod = instructions->mod[i];
+	result.segmentPrefix = instructions->segmentPrefix[i];
+	result.repeatPrefix = instructions->repeatPrefix[i];
+	result.operand1 = instructions->operand1[i];
+	result.operand2 = instructions->operand2[i];
+	result.cachedText = instructions->cachedText[i];
+	return result;
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Rendering
+//-------------------------------------------------------------------------
+
+//NOTE (Aske): Every piece of operand text there is. They're short_text, so each one is emitted with one fixed-size copy.
+global_variable short_text regs16bit[8] =
+{
+	ShortText("ax"), ShortText("cx"), ShortText("dx"), ShortText("bx"),
+	ShortText("sp"), ShortText("bp"), ShortText("si"), ShortText("di"),
+};
+global_variable short_text regs8bit[8] =
+{
+	ShortText("al"), ShortText("cl"), ShortText("dl"), ShortText("bl"),
+	ShortText("ah"), ShortText("ch"), ShortText("dh"), ShortText("bh"),
+};
+global_variable short_text segmentRegisters[4] = { ShortText("es"), ShortText("cs"), ShortText("ss"), ShortText("ds") };
+//NOTE (Aske): rnm[6] requires displacement
+global_variable short_text rnmForNon3Mods[8] =
+{
+	ShortText("bx + si"), ShortText("bx + di"), ShortText("bp + si"), ShortText("bp + di"),
+	ShortText("si"), ShortText("di"), ShortText("bp"), ShortText("bx"),
+};
+global_variable short_text segmentPrefixes[5] =
+{
+	ShortText(""), ShortText("es:"), ShortText("cs:"), ShortText("ss:"), ShortText("ds:"),
+};
+//NOTE (Aske): Indexed by OperandFlag_sized, then by InstructionFlag_wide
+global_variable short_text operandSizes[3] = { ShortText(""), ShortText("byte "), ShortText("word ") };
+
+internal void EmitOperand(format_cursor *dest, decoded_instruction *decoded, instruction_operand *operand)
+{
+	short_text *size = operandSizes;
+	if (operand->flags & OperandFlag_sized)
+	{
+		size = operandSizes + 1 + (decoded->flags & InstructionFlag_wide);
+	}
+
+	switch (operand->kind)
+	{
+		case Operand_register8:
+		{
+			EmitShortText(dest, size);
+			EmitShortText(dest, regs8bit + operand->value);
+		} break;
+		case Operand_register16:
+		{
+			EmitShortText(dest, size);
+			EmitShortText(dest, regs16bit + operand->value);
+		} break;
+		case Operand_segmentRegister:
+		{
+			EmitShortText(dest, size);
+			EmitShortText(dest, segmentRegisters + operand->value);
+		} break;
+		case Operand_memory:
+		{
+			EmitShortText(dest, size);
+			EmitShortText(dest, segmentPrefixes + decoded->segmentPrefix);
+			OutChar(dest, '[');
+			u8 rnm = operand->value;
+			if (decoded->mod == 0 && rnm == 6) //110 - DIRECT ADDRESS "+ 16-bit displacement"
+			{
+				EmitUnsigned(dest, (u16)decoded->displacement);
+			}
+			else
+			{
+				EmitShortText(dest, rnmForNon3Mods + rnm);
+				if (decoded->mod != 0 && decoded->displacement != 0)
+				{
+					OutChar(dest, ' ');
+					EmitSigned(dest, decoded->displacement, true);
+				}
+			}
+			OutChar(dest, ']');
+		} break;
+		case Operand_directAddress:
+		{
+			EmitShortText(dest, size);
+			OutChar(dest, '[');
+			EmitSigned(dest, decoded->displacement, false);
+			OutChar(dest, ']');
+		} break;
+		case Operand_immediate:
+		{
+			EmitShortText(dest, size);
+			EmitSigned(dest, decoded->immediate, false);
+		} break;
+		case Operand_unsignedByte:
+		{
+			EmitUnsigned(dest, (u8)decoded->immediate);
+		} break;
+		InvalidDefaultCase;
+	}
+}
+
+//NOTE (Aske): The longest line RenderInstructionText writes, with room to spare for its null-terminator
+#define MaxInstructionTextSize 64
+
+//NOTE (Aske): Writes the text of one record into outputLine, without the label space.
+//Each shape is spelled out with the emitters, and the operands go straight into the line.
+internal void RenderInstructionText(string_buffer *outputLine, decoded_instruction *decoded)
+{
+	short_text *name = mnemonicNames + decoded->mnemonic;
+	format_cursor line = { (size_t)outputLine->capacity, outputLine->data };
+
+	switch (decoded->instructionClass)
+	{
+		case InstructionClass_none:
+		case InstructionClass_segmentPrefix:
+		{
+		} break;
+		case InstructionClass_operation:
+		{
+			//NOTE (Aske): "%s %s, %s\n", "%s %s\n" or "%s\n"
+			EmitShortText(&line, name);
+			if (decoded->operand1.kind)
+			{
+				OutChar(&line, ' ');
+				EmitOperand(&line, decoded, &decoded->operand1);
+				if (decoded->operand2.kind)
+				{
+					EmitString(&line, ", ", 2);
+					EmitOperand(&line, decoded, &decoded->operand2);
+				}
+			}
+			OutChar(&line, '\n');
+		} break;
+		case InstructionClass_stringOperation:
+		{
+			//NOTE (Aske): Completes the "rep"/"repn" that the prefix's record left on the line
+			char repeatSuffix = 0;
+			if (decoded->mnemonic == Mnemonic_cmpsb || decoded->mnemonic == Mnemonic_cmpsw)
+			{
+				repeatSuffix = 'e';
+			}
+			else if (decoded->mnemonic == Mnemonic_scasb || decoded->mnemonic == Mnemonic_scasw)
+			{
+				repeatSuffix = 'z';
+			}
+			else if (decoded->repeatPrefix == State_repeat_when_zf_clear)
+			{
+				repeatSuffix = 'e';
+			}
+			if (repeatSuffix)
+			{
+				OutChar(&line, repeatSuffix);
+			}
+			OutChar(&line, ' ');
+			EmitShortText(&line, name);
+			OutChar(&line, '\n');
+		} break;
+		case InstructionClass_branch:
+		case InstructionClass_relativeBranch:
+		{
+			EmitShortText(&line, name);
+			if (decoded->flags & InstructionFlag_hasLabel)
+			{
+				EmitString(&line, " label__", 8);
+				EmitSigned(&line, decoded->target, false);
+			}
+			else if (decoded->instructionClass == InstructionClass_branch)
+			{
+				OutChar(&line, ' ');
+				EmitSigned(&line, decoded->target, false);
+			}
+			else //$ operator is NASM functionality
+			{
+				s32 relativeAddress = (s32)(decoded->target - (decoded->offset + decoded->length));
+				EmitString(&line, " $+2", 4);
+				EmitSigned(&line, relativeAddress, true);
+			}
+			OutChar(&line, '\n');
+		} break;
+		case InstructionClass_farBranch:
+		{
+			//NOTE (Aske): "%s %hd:%hu\n"
+			EmitShortText(&line, name);
+			OutChar(&line, ' ');
+			EmitSigned(&line, decoded->immediate, false);
+			OutChar(&line, ':');
+			EmitUnsigned(&line, (u16)decoded->target);
+			OutChar(&line, '\n');
+		} break;
+		case InstructionClass_escape:
+		{
+			EmitShortText(&line, name);
+			OutChar(&line, ' ');
+			EmitOperand(&line, decoded, &decoded->operand1);
+			OutChar(&line, ' ');
+			EmitOperand(&line, decoded, &decoded->operand2);
+			OutChar(&line, '\n');
+		} break;
+		case InstructionClass_repeatPrefix:
+		{
+			EmitShortText(&line, name);
+		} break;
+		case InstructionClass_lockPrefix:
+		{
+			EmitShortText(&line, name);
+			OutChar(&line, ' ');
+		} break;
+		InvalidDefaultCase;
+	}
+	outputLine->count = EndEmitting(&line, outputLine->data);
+}
@@ -0,0 +1,112 @@
+//NOTE (Aske): Entry point for embedding the decoder in another program. Build with DECODER_LIBRARY 1
+//to leave out main(), and include 8086_decoder.cpp in the embedding program's unity build.
+//Nothing here prints anything. The only globals are the opcode tables, which are built at compile time,
+//and the copy and zero kernels. Call InitializeMemoryKernels once, before starting the threads that decode,
+//to have them use SIMD. Without it, everything still works, on the plain loops.
+//Each thread decodes with its own decoder_context, so any number of threads can decode at the same time.
+
+struct decoder_context
+{
+	memory_arena *outputPool;
+	memory_arena *scratchPad;
+	decoder_buffers buffers;
+};
+
+struct decoded_listing
+{
+	b32 isValid;
+	b32 isTruncated; //NOTE (Aske): The bytes ended in the middle of an instruction, which was left out
+	string text; //NOTE (Aske): Lives in the listing arena that was passed in
+};
+
+//NOTE (Aske): One per thread. The label buffers are pushed on scratchPad here, once, and reused for every decode.
+internal decoder_context MakeDecoderContext(memory_arena *outputPool, memory_arena *scratchPad)
+{
+	decoder_context result = {};
+	result.outputPool = outputPool;
+	result.scratchPad = scratchPad;
+	result.buffers = PushDecoderBuffers(scratchPad);
+	return result;
+}
+
+//NOTE (Aske): The caller's bytes may end right at the end of a page, so they're copied once,
+//to get the guard bytes the decoder reads past the end with.
+internal debug_read_file_result GuardedCopyOfBytes(memory_arena *arena, u8 *bytes, s64 byteCount)
+{
+	debug_read_file_result result = {};
+	result.Contents = PushSize(arena, byteCount + InputGuardSize);
+	CopySize(byteCount, bytes, result.Contents);
+	result.ContentsSize = byteCount;
+	result.CurrentIndex = -1;
+	result.WindowSize = byteCount;
+	return result;
+}
+
+//NOTE (Aske): Decodes bytes into a listing appended to listingArena, exactly like the one written for a file.
+//sourceName is only used for the comment at the top, which is left out when it's 0.
+//The context's arenas are left as they were, so it can be reused right away.
+internal decoded_listing DecodeBytes(decoder_context *context, u8 *bytes, s64 byteCount, char *sourceName,
+                                     memory_arena *listingArena)
+{
+	decoded_listing result = {};
+	if (!bytes || (byteCount <= 0))
+	{
+		return result;
+	}
+	Assert((listingArena != context->outputPool) && (listingArena != context->scratchPad));
+
+	SaveArena(context->scratchPad);
+	debug_read_file_result file = GuardedCopyOfBytes(context->scratchPad, bytes, byteCount);
+	output_sink listingSink;
+	output_sink echoSink;
+	InitializeArenaSink(&listingSink, listingArena);
+	InitializeOutputSink(&echoSink, OutputSink_null, 0, context->scratchPad);
+
+	size_t listingStart = listingArena->used;
+	decode_file_result decoded = {};
+	DecodeListing(&file, 0, sourceName, context->outputPool, context->scratchPad, &context->buffers,
+	              0, &listingSink, 0, &echoSink, 0, &decoded);
+	ZeroRestoreArena(context->scratchPad);
+
+	result.isValid = true;
+	result.isTruncated = decoded.isInputTruncated;
+	result.text.count = listingArena->used - listingStart;
+	result.text.data = (char *)listingArena->base + listingStart;
+	return result;
+}
+
+//NOTE (Aske): Decodes bytes into records pushed on recordArena, without rendering any text.
+//For analyses that want operands, lengths and targets. Nothing is kept in the context between calls.
+internal decoded_instructions DecodeBytesToInstructions(decoder_context *context, u8 *bytes, s64 byteCount,
+                                                        memory_arena *recordArena)
+{
+	decoded_instructions result = {};
+	if (!bytes || (byteCount <= 0))
+	{
+		return result;
+	}
+	Assert((recordArena != context->outputPool) && (recordArena != context->scratchPad));
+
+	SaveArena(context->scratchPad);
+	debug_read_file_result file = GuardedCopyOfBytes(context->scratchPad, bytes, byteCount);
+
+	decoder_state decoderState = {};
+	decoderState.ScratchPad = context->scratchPad;
+	decoderState.endedWithNewLine = true;
+
+	//NOTE (Aske): Every instruction is at least one byte long, so there's never more records than bytes
+	result = PushDecodedInstructions(recordArena, byteCount);
+	byte_of_file byteCursor;
+	while ((byteCursor = GetNextOpsByte(&file)).isValid)
+	{
+		decoded_instruction decoded = DecodeInstructionRecord(&decoderState, &file, byteCursor.byte);
+		if (decoded.flags & InstructionFlag_truncated)
+		{
+			break;
+		}
+		AddDecodedInstruction(&result, &decoded);
+	}
+	ZeroRestoreArena(context->scratchPad);
+
+	return result;
+}
@@ -0,0 +1,352 @@
+//NOTE (Aske): -update:old.asm -changed:start-end,... in.bin out.asm writes the listing of a patched input,
+//starting from the listing (and index) written for it before it was patched. Only around the changed bytes is
+//anything decoded: from the last line before each change, until the instructions line up with the old lines again.
+//The rest is copied from the old listing, with label lines added or dropped where jumps to them came or went.
+//Patches have to keep the size of the input, since everything after an insertion would move.
+//Decoding only starts, and lines only count as lined up, where no prefix from an earlier line is pending.
+
+struct byte_range
+{
+	s64 start;
+	s64 end; //NOTE (Aske): One past the last changed byte
+};
+
+struct byte_ranges
+{
+	s32 count; //NOTE (Aske): -1 when they couldn't be parsed
+	byte_range *base;
+};
+
+//NOTE (Aske): Decimal, or hexadecimal with 0x in front
+internal s64 ByteOffsetFromText(char **atInit)
+{
+	s64 result = 0;
+	char *at = *atInit;
+	if ((at[0] == '0') && ((at[1] == 'x') || (at[1] == 'X')))
+	{
+		at += 2;
+		for (;;)
+		{
+			char c = *at;
+			s64 digit;
+			if ((c >= '0') && (c <= '9')) digit = c - '0';
+			else if ((c >= 'a') && (c <= 'f')) digit = 10 + (c - 'a');
+			else if ((c >= 'A') && (c <= 'F')) digit = 10 + (c - 'A');
+			else break;
+			result = (result << 4) | digit;
+			++at;
+		}
+	}
+	else
+	{
+		while ((*at >= '0') && (*at <= '9'))
+		{
+			result = (result * 10) + (*at - '0');
+			++at;
+		}
+	}
+
+	*atInit = at;
+	return result;
+}
+
+//NOTE (Aske): "start-end,offset,..." where end is exclusive and a lone offset is one byte.
+//The ranges come back sorted by where they start.
+internal byte_ranges ParseByteRanges(memory_arena *arena, char *text)
+{
+	byte_ranges result = {};
+	s32 capacity = 1;
+	for (char *at = text; *at; ++at)
+	{
+		capacity += (*at == ',');
+	}
+	result.base = PushArray(arena, capacity, byte_range);
+
+	char *at = text;
+	while (*at)
+	{
+		char *startText = at;
+		byte_range range;
+		range.start = ByteOffsetFromText(&at);
+		range.end = range.start + 1;
+		b32 isValid = (at != startText);
+		if (*at == '-')
+		{
+			char *endText = ++at;
+			range.end = ByteOffsetFromText(&at);
+			isValid = isValid && (at != endText);
+		}
+		isValid = isValid && ((*at == ',') || !*at) && (range.end >= range.start);
+		if (!isValid)
+		{
+			result.count = -1;
+			return result;
+		}
+		if (*at == ',')
+		{
+			++at;
+		}
+
+		s32 insertAt = result.count++;
+		while ((insertAt > 0) && (result.base[insertAt - 1].start > range.start))
+		{
+			result.base[insertAt] = result.base[insertAt - 1];
+			--insertAt;
+		}
+		result.base[insertAt] = range;
+	}
+	return result;
+}
+
+//NOTE (Aske): -update and -changed only go together, and every range has to parse and lie inside the input.
+//Checked before anything is decoded, and what's wrong is reported on stderr.
+//An input that can't be read is left for DecodeFile to report.
+internal b32 AreChangedRangesUsable(memory_arena *scratchPad, char *updateListingPath, char *changedRanges,
+                                    char *binaryFilePath)
+{
+	if (!updateListingPath || !changedRanges)
+	{
+		fprintf(stderr, "-update and -changed have to be given together\n");
+		return false;
+	}
+
+	SaveArena(scratchPad);
+	byte_ranges ranges = ParseByteRanges(scratchPad, changedRanges);
+	b32 result = (ranges.count > 0);
+	if (!result)
+	{
+		fprintf(stderr, "Can't parse -changed:%s\n", changedRanges);
+	}
+
+	platform_file_info info;
+	if (result && PlatformGetFileInfo(binaryFilePath, &info))
+	{
+		for (byte_range *range = ranges.base; range < ranges.base + ranges.count; ++range)
+		{
+			if ((u64)range->end > info.size)
+			{
+				fprintf(stderr, "-changed range %lld-%lld is past the end of %s, which is %llu bytes\n",
+				        (long long)range->start, (long long)range->end, binaryFilePath, (unsigned long long)info.size);
+				result = false;
+				break;
+			}
+		}
+	}
+	ZeroRestoreArena(scratchPad);
+	return result;
+}
+
+//NOTE (Aske): Where an update writes before it's renamed into place
+internal char* UpdateTemporaryPath(memory_arena *arena, char *path)
+{
+	size_t pathSize = StringLength(path) + 8;
+	char *result = (char *)PushSize(arena, pathSize);
+	FormatString(pathSize, result, "%s.update", path);
+	return result;
+}
+
+struct listing_update
+{
+	output_sink *outputSink;
+	listing_index_writer *indexWriter;
+	output_sink *echoSink;
+
+	listing_index *oldIndex;
+	char *oldListing;
+	u8 *isLabelAt; //NOTE (Aske): One per input byte, for the patched input
+};
+
+internal void WriteUpdatedText(listing_update *update, void *text, s64 size)
+{
+	SinkWrite(update->outputSink, text, size);
+	SinkWrite(update->echoSink, text, size);
+}
+
+internal void WriteUpdatedLabel(listing_update *update, s64 byteAddress)
+{
+	char label[32];
+	format_cursor labelCursor = { sizeof(label), label };
+	EmitString(&labelCursor, "label__", 7);
+	EmitSigned(&labelCursor, byteAddress, false);
+	EmitString(&labelCursor, ":\n", 2);
+	WriteUpdatedText(update, label, labelCursor.at - label);
+}
+
+//NOTE (Aske): Copies the old lines from cursor up to the first one at or after endOffset, and leaves cursor there.
+//Their instructions haven't changed, only their labels can have, since jumps to them may have been patched in or out.
+internal void CopyOldLines(listing_update *update, listing_index_cursor *cursor, s64 endOffset)
+{
+	if (!cursor->isValid || (cursor->entry.inputOffset >= endOffset))
+	{
+		return;
+	}
+
+	s64 copyFrom = ListingIndexLineStart(&cursor->entry);
+	s64 copyEnd = update->oldIndex->listingSize;
+	for (; cursor->isValid; ListingIndexNext(cursor))
+	{
+		listing_index_entry *entry = &cursor->entry;
+		if (entry->inputOffset >= endOffset)
+		{
+			copyEnd = ListingIndexLineStart(entry);
+			break;
+		}
+
+		u32 flags = entry->flags & ~ListingIndexFlag_hasLabel;
+		b32 hadLabel = (entry->flags & ListingIndexFlag_hasLabel);
+		b32 hasLabel = update->isLabelAt[entry->inputOffset];
+		if (hadLabel != hasLabel)
+		{
+			WriteUpdatedText(update, update->oldListing + copyFrom, ListingIndexLineStart(entry) - copyFrom);
+			if (hasLabel)
+			{
+				WriteUpdatedLabel(update, entry->inputOffset);
+			}
+			copyFrom = entry->listingOffset;
+		}
+		s64 newListingOffset = update->outputSink->totalWritten + (entry->listingOffset - copyFrom);
+		WriteListingIndexEntry(update->indexWriter, entry->inputOffset, newListingOffset,
+		                       flags | (hasLabel ? ListingIndexFlag_hasLabel : 0));
+	}
+	WriteUpdatedText(update, update->oldListing + copyFrom, copyEnd - copyFrom);
+}
+
+//NOTE (Aske): Decodes from the old line at cursor, which the next change is in or after, until it's past every change
+//the decoding has reached and the next instruction starts an old line again. Leaves cursor at that line, or not valid
+//when decoding got to the end of the input.
+internal void RedecodeLines(listing_update *update, debug_read_file_result *file, listing_index_cursor *cursor,
+                            byte_ranges *ranges, s32 *rangeIndex, memory_arena *scratchPad,
+                            output_sink *messageSink, s64 *bytesDecoded)
+{
+	decoder_state decoderState = {};
+	decoderState.ScratchPad = scratchPad;
+	decoderState.messageSink = messageSink;
+	decoderState.endedWithNewLine = true;
+
+	s64 startOffset = cursor->entry.inputOffset;
+	file->CurrentIndex = startOffset - 1;
+	//NOTE (Aske): The change the region starts with, which is usually past the start of its line
+	s64 changedEnd = ranges->base[(*rangeIndex)++].end;
+	for (;;)
+	{
+		s64 nextIndex = file->CurrentIndex + 1;
+		while ((*rangeIndex < ranges->count) && (ranges->base[*rangeIndex].start <= nextIndex))
+		{
+			changedEnd = Maximum(changedEnd, ranges->base[*rangeIndex].end);
+			++*rangeIndex;
+		}
+		while (cursor->isValid && (cursor->entry.inputOffset < nextIndex))
+		{
+			ListingIndexNext(cursor);
+		}
+
+		b32 isAligned = cursor->isValid && (cursor->entry.inputOffset == nextIndex) &&
+		                !(cursor->entry.flags & ListingIndexFlag_prefixPending);
+		if ((nextIndex >= changedEnd) && isAligned && IsDecoderStateClean(&decoderState))
+		{
+			break;
+		}
+
+		byte_of_file byteCursor = GetNextOpsByte(file);
+		if (!byteCursor.isValid)
+		{
+			break;
+		}
+
+		SaveArena(scratchPad);
+		decoded_instruction decoded = DecodeInstructionRecord(&decoderState, file, byteCursor.byte);
+		if (!(decoded.flags & InstructionFlag_truncated))
+		{
+			if (decoded.flags & InstructionFlag_startsLine)
+			{
+				u32 flags = (decoded.flags & InstructionFlag_prefixPending) ? ListingIndexFlag_prefixPending : 0;
+				if (update->isLabelAt[decoded.offset])
+				{
+					WriteUpdatedLabel(update, decoded.offset);
+					flags |= ListingIndexFlag_hasLabel;
+				}
+				WriteListingIndexEntry(update->indexWriter, decoded.offset, update->outputSink->totalWritten, flags);
+			}
+			string_buffer *line = PushStringBuffer(scratchPad, line, MaxInstructionTextSize);
+			RenderInstructionText(line, &decoded);
+			WriteUpdatedText(update, line->data, line->count);
+		}
+		ZeroRestoreArena(scratchPad);
+	}
+
+	//NOTE (Aske): A truncated instruction leaves the cursor past the end
+	s64 endIndex = Minimum(file->CurrentIndex + 1, (s64)file->ContentsSize);
+	*bytesDecoded += endIndex - startOffset;
+	if (endIndex >= (s64)file->ContentsSize)
+	{
+		cursor->isValid = false;
+	}
+}
+
+//NOTE (Aske): Writes the updated listing and its index. Returns false, without writing anything, when the old
+//listing can't be updated: it or its index is missing, they don't belong together or to an input of this size,
+//or the changed ranges don't parse. The whole input has to be in file.
+internal b32 UpdateListing(char *oldListingPath, char *changedRanges, debug_read_file_result *file,
+                           char *sourceName, output_sink *outputSink, listing_index_writer *indexWriter,
+                           output_sink *echoSink, output_sink *messageSink, memory_arena *scratchPad,
+                           decode_file_result *result)
+{
+	SaveArena(scratchPad);
+	debug_read_file_result oldListing = ReadEntireFile(oldListingPath);
+	debug_read_file_result oldIndexFile = ReadEntireFile(ListingIndexPath(scratchPad, oldListingPath));
+	byte_ranges ranges = ParseByteRanges(scratchPad, changedRanges ? changedRanges : (char *)"");
+
+	listing_index oldIndex;
+	b32 isUpdatable = oldListing.Contents && (ranges.count >= 0) &&
+	                  ReadListingIndex(&oldIndexFile, file->ContentsSize, oldListing.ContentsSize, &oldIndex) &&
+	                  (oldIndex.entryCount > 0);
+	if (isUpdatable)
+	{
+		//NOTE (Aske): A patch anywhere can add or remove a jump to anywhere else, so every label is looked for again.
+		//The length kernel gets through the whole input far quicker than decoding it would.
+		instruction_lengths lengths = PushInstructionLengths(scratchPad, file->ContentsSize);
+		DecodeInstructionLengths((u8 *)file->Contents, file->ContentsSize, &lengths);
+		u8 *isLabelAt = PushArray(scratchPad, file->ContentsSize, u8);
+		for (s64 i = 0; i < lengths.branchCount; ++i)
+		{
+			isLabelAt[lengths.branchTargets[i]] = 1;
+		}
+
+		listing_update update = {};
+		update.outputSink = outputSink;
+		update.indexWriter = indexWriter;
+		update.echoSink = echoSink;
+		update.oldIndex = &oldIndex;
+		update.oldListing = (char *)oldListing.Contents;
+		update.isLabelAt = isLabelAt;
+
+		string_buffer *sourceFileComment = PushSourceFileComment(scratchPad, sourceName);
+		WriteUpdatedText(&update, sourceFileComment->data, sourceFileComment->count);
+		WriteUpdatedText(&update, (char *)"bits 16\n", 8);
+		StartListingIndex(indexWriter, 2);
+
+		listing_index_cursor next = ListingIndexFirst(&oldIndex);
+		s32 rangeIndex = 0;
+		//NOTE (Aske): Once decoding has reached the end of the input, the rest of the ranges are in a truncated instruction
+		while ((rangeIndex < ranges.count) && (ranges.base[rangeIndex].start < (s64)file->ContentsSize) && next.isValid)
+		{
+			//NOTE (Aske): The first line is at offset 0 and never has a prefix pending, and decoding stopped
+			//at a line without one before the range, so this is never before next
+			listing_index_cursor first = ListingIndexSeek(&oldIndex, ranges.base[rangeIndex].start,
+			                                              ListingIndexFlag_prefixPending);
+			Assert(first.isValid && (first.entry.inputOffset >= next.entry.inputOffset));
+			CopyOldLines(&update, &next, first.entry.inputOffset);
+			RedecodeLines(&update, file, &next, &ranges, &rangeIndex, scratchPad, messageSink, &result->bytesRedecoded);
+			++result->updatedRegionCount;
+		}
+		CopyOldLines(&update, &next, Sint64Max);
+		FinishListingIndex(indexWriter, file->ContentsSize, outputSink->totalWritten);
+
+		result->bytesDecoded = file->ContentsSize;
+	}
+
+	FreeFileMemory(&oldIndexFile);
+	FreeFileMemory(&oldListing);
+	ZeroRestoreArena(scratchPad);
+	return isUpdatable;
+}
@@ -0,0 +1,161 @@
+//NOTE (Aske): Repetitive binaries decode the same few hundred encodings over and over, like "push bp" and
+//"mov ax, [bp -2]". With -cache, the record and the rendered line of each encoding are kept, keyed on its bytes,
+//and decoding a repeat is a copy of the record and rendering it is a copy of the line.
+//Only what doesn't depend on its offset or on the instructions before it is cached: nothing after a prefix,
+//no prefixes themselves, and no branches, since their targets and labels depend on where they are.
+//Entries are never evicted, so a record can point at its line until the cache is thrown away.
+//Once the cache is full, new encodings are just decoded as usual.
+
+#define InstructionCacheSizeLog2 12
+#define InstructionCacheSize (1 << InstructionCacheSizeLog2)
+#define InstructionCacheMaxFill ((InstructionCacheSize / 4) * 3)
+//NOTE (Aske): Longer lines aren't cached. Cached lines never have a segment prefix, so the longest is
+//"mov word [bx + si -32768], -32768\n"
+#define MaxCachedTextSize 47
+
+struct instruction_cache_entry
+{
+	u64 key; //NOTE (Aske): 0 for an unused entry
+	decoded_instruction record;
+	u8 textLength;
+	char text[MaxCachedTextSize];
+};
+
+struct instruction_cache
+{
+	instruction_cache_entry *entries;
+	s32 fillCount;
+
+	//NOTE (Aske): Only instructions that could have been cached are looked up
+	s64 lookupCount;
+	s64 hitCount;
+};
+
+internal instruction_cache *PushInstructionCache(memory_arena *arena)
+{
+	instruction_cache *result = PushStruct(arena, instruction_cache);
+	result->entries = PushArray(arena, InstructionCacheSize, instruction_cache_entry);
+	return result;
+}
+
+//NOTE (Aske): The bytes of the instruction, with the length in the top byte so no key is 0
+internal u64 InstructionCacheKey(u8 *bytes, s64 length)
+{
+	u64 result = (u64)length << 56;
+	for (s64 i = 0; i < length; ++i)
+	{
+		result |= (u64)bytes[i] << (8 * i);
+	}
+	return result;
+}
+
+//NOTE (Aske): Linear probing from a multiplicative hash. Returns the entry with key, or the unused one it would go in.
+internal instruction_cache_entry *FindInstructionCacheEntry(instruction_cache *cache, u64 key)
+{
+	u32 index = (u32)((key * 0x9E3779B97F4A7C15ull) >> (64 - InstructionCacheSizeLog2));
+	instruction_cache_entry *result = cache->entries + index;
+	while (result->key && (result->key != key))
+	{
+		index = (index + 1) & (InstructionCacheSize - 1);
+		result = cache->entries + index;
+	}
+	return result;
+}
+
+//NOTE (Aske): Called right after the opcode is read. On a hit, decoded is the cached record at this offset,
+//and the cursor is moved to the end of the instruction, as if the handler had run.
+//On a miss, key is what the decoded record can be cached under, or 0 if it can't be.
+internal b32 LookupCachedInstruction(instruction_cache *cache, decoder_state *decoderState,
+                                     debug_read_file_result *file, decoded_instruction *decoded, u64 *key)
+{
+	*key = 0;
+	s64 windowIndex = file->CurrentIndex - file->WindowOffset;
+	b32 isStateClean = decoderState->endedWithNewLine && (decoderState->RepeatState == State_repeat_none) &&
+	                   !decoderState->segmentOverride;
+	//NOTE (Aske): Near the end of the input, the handler takes care of truncated instructions
+	if (!isStateClean || ((windowIndex + MaxInstructionSize) > (s64)file->WindowSize))
+	{
+		return false;
+	}
+
+	u8 *bytes = (u8 *)file->Contents + windowIndex;
+	s64 length = InstructionLengthUnchecked(bytes, 0);
+	u64 instructionKey = InstructionCacheKey(bytes, length);
+	++cache->lookupCount;
+
+	instruction_cache_entry *entry = FindInstructionCacheEntry(cache, instructionKey);
+	if (entry->key)
+	{
+		++cache->hitCount;
+		*decoded = entry->record;
+		decoded->offset = file->CurrentIndex;
+		file->CurrentIndex += length - 1;
+		return true;
+	}
+
+	*key = instructionKey;
+	return false;
+}
+
+//NOTE (Aske): Caches a record that was just decoded after a miss, along with its rendered line.
+//The handler has to have left the state as clean as it found it.
+internal void InsertCachedInstruction(instruction_cache *cache, decoder_state *decoderState,
+                                      decoded_instruction *decoded, u64 key)
+{
+	b32 isCacheable = ((decoded->instructionClass == InstructionClass_operation) ||
+	                   (decoded->instructionClass == InstructionClass_escape)) &&
+	                  (decoded->length == (key >> 56)) && !(decoded->flags & InstructionFlag_truncated) &&
+	                  decoderState->endedWithNewLine && (decoderState->RepeatState == State_repeat_none) &&
+	                  !decoderState->segmentOverride;
+	if (!isCacheable || (cache->fillCount >= InstructionCacheMaxFill))
+	{
+		return;
+	}
+
+	char lineBuffer[MaxInstructionTextSize];
+	string_buffer line = {};
+	line.capacity = sizeof(lineBuffer);
+	line.data = lineBuffer;
+	RenderInstructionText(&line, decoded);
+	if (line.count > MaxCachedTextSize)
+	{
+		return;
+	}
+
+	instruction_cache_entry *entry = FindInstructionCacheEntry(cache, key);
+	Assert(!entry->key);
+	++cache->fillCount;
+	entry->key = key;
+	entry->textLength = (u8)line.count;
+	CopySize(line.count, line.data, entry->text);
+
+	decoded->cachedText = (u16)(1 + (entry - cache->entries));
+	entry->record = *decoded;
+}
+
+internal string CachedInstructionText(instruction_cache *cache, decoded_instruction *decoded)
+{
+	Assert(decoded->cachedText);
+	instruction_cache_entry *entry = cache->entries + (decoded->cachedText - 1);
+	string result = { entry->textLength, entry->text };
+	return result;
+}
+
+//NOTE (Aske): DecodeInstructionRecord with the cache in front of the handler. cache may be 0.
+internal decoded_instruction DecodeInstructionRecordCached(instruction_cache *cache, decoder_state *decoderState,
+                                                           debug_read_file_result *file, u8 b)
+{
+	decoded_instruction result;
+	u64 key = 0;
+	if (cache && LookupCachedInstruction(cache, decoderState, file, &result, &key))
+	{
+		return result;
+	}
+
+	result = DecodeInstructionRecord(decoderState, file, b);
+	if (key)
+	{
+		InsertCachedInstruction(cache, decoderState, &result, key);
+	}
+	return result;
+}
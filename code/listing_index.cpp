@@ -0,0 +1,330 @@
+//NOTE (Aske): -index writes <listing>.idx next to the listing. It maps the input offset of every line that starts
+//with an instruction to where that instruction's text starts in the listing, and to its line number (from 1).
+//An instruction after a prefix is on the prefix's line, so it's found as the last line at or before its offset.
+//It's what lets -update splice a listing instead of writing it all again, and lets a viewer seek in a huge listing.
+//
+//The file is little-endian and made to be memory-mapped. It's a run of ListingIndexBlockSize byte blocks, then
+//a listing_index_trailer. Every block starts with a listing_index_block_header holding its first entry in full,
+//and the rest of its entries follow as deltas from the one before, each two LEB128 varints:
+//(inputDelta << 2) | flags, then listingDelta. An entry's line number is one past the last one's, plus one
+//more when it has a label line in front of it. The rest of a block is zeros.
+//A lookup is a binary search over the block headers, then a walk through at most one block.
+#define ListingIndexMagic 0x58444938 //NOTE (Aske): "8IDX"
+#define ListingIndexVersion 2
+#define ListingIndexBlockSize Kilobytes(4)
+
+enum listing_index_flags
+{
+	ListingIndexFlag_hasLabel = 0x1, //NOTE (Aske): Its label line comes right before it
+	//NOTE (Aske): A prefix from an earlier line applies to this one, so decoding from here would go differently
+	ListingIndexFlag_prefixPending = 0x2,
+};
+
+struct listing_index_entry
+{
+	s64 inputOffset;
+	s64 listingOffset;
+	s64 lineNumber;
+	u32 flags;
+};
+
+struct listing_index_block_header
+{
+	s64 inputOffset;
+	s64 listingOffset;
+	s64 lineNumber;
+	u32 flags;
+	u16 entryCount;
+	u16 dataSize; //NOTE (Aske): Bytes of deltas after the header
+};
+
+struct listing_index_trailer
+{
+	u32 magic;
+	u32 version;
+	u64 inputSize;
+	u64 listingSize;
+	s64 entryCount;
+	u32 blockSize;
+	u32 unused;
+};
+
+//NOTE (Aske): Entries are written in input order. Only the block being filled is kept in memory.
+struct listing_index_writer
+{
+	output_sink *sink;
+	listing_index_entry last;
+	s64 entryCount;
+	u32 blockUsed;
+	u8 block[ListingIndexBlockSize];
+};
+
+struct listing_index
+{
+	u8 *blocks;
+	s64 blockCount;
+	s64 entryCount;
+	u64 listingSize;
+};
+
+//NOTE (Aske): Walks the entries in order. Not valid once it's walked past the last one.
+struct listing_index_cursor
+{
+	listing_index *index;
+	s64 blockIndex;
+	u32 entryInBlock;
+	u32 dataAt;
+	b32 isValid;
+	listing_index_entry entry;
+};
+
+internal char* ListingIndexPath(memory_arena *arena, char *listingPath)
+{
+	size_t pathSize = StringLength(listingPath) + 5;
+	char *result = (char *)PushSize(arena, pathSize);
+	FormatString(pathSize, result, "%s.idx", listingPath);
+	return result;
+}
+
+//NOTE (Aske): The length of "label__N:\n"
+internal s64 LabelLineLength(s64 byteAddress)
+{
+	s64 result = 10;
+	for (s64 rest = byteAddress; rest >= 10; rest /= 10)
+	{
+		++result;
+	}
+	return result;
+}
+
+//NOTE (Aske): Where the entry's line starts, its label line included
+internal s64 ListingIndexLineStart(listing_index_entry *entry)
+{
+	s64 result = entry->listingOffset;
+	if (entry->flags & ListingIndexFlag_hasLabel)
+	{
+		result -= LabelLineLength(entry->inputOffset);
+	}
+	return result;
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Writing
+//-------------------------------------------------------------------------
+
+internal u32 WriteVarint(u8 *destination, u64 value)
+{
+	u32 result = 0;
+	while (value >= 0x80)
+	{
+		destination[result++] = (u8)(value | 0x80);
+		value >>= 7;
+	}
+	destination[result++] = (u8)value;
+	return result;
+}
+
+//NOTE (Aske): The writer's sink has to be set already.
+//headerLineCount is how many lines the listing starts with before its first instruction.
+internal void StartListingIndex(listing_index_writer *writer, s64 headerLineCount)
+{
+	writer->last = {};
+	writer->last.lineNumber = headerLineCount;
+	writer->entryCount = 0;
+	writer->blockUsed = 0;
+	ZeroSize(writer->block, sizeof(writer->block));
+}
+
+internal void FlushListingIndexBlock(listing_index_writer *writer)
+{
+	if (writer->blockUsed)
+	{
+		SinkWrite(writer->sink, writer->block, sizeof(writer->block));
+		ZeroSize(writer->block, sizeof(writer->block));
+		writer->blockUsed = 0;
+	}
+}
+
+//NOTE (Aske): listingOffset is where the instruction's text starts, after its label line if it has one
+internal void WriteListingIndexEntry(listing_index_writer *writer, s64 inputOffset, s64 listingOffset, u32 flags)
+{
+	listing_index_entry entry;
+	entry.inputOffset = inputOffset;
+	entry.listingOffset = listingOffset;
+	entry.lineNumber = writer->last.lineNumber + ((flags & ListingIndexFlag_hasLabel) ? 2 : 1);
+	entry.flags = flags;
+	Assert((inputOffset >= writer->last.inputOffset) && (listingOffset >= writer->last.listingOffset));
+
+	listing_index_block_header *header = (listing_index_block_header *)writer->block;
+	u8 delta[20];
+	u32 deltaSize = WriteVarint(delta, ((u64)(inputOffset - writer->last.inputOffset) << 2) | flags);
+	deltaSize += WriteVarint(delta + deltaSize, listingOffset - writer->last.listingOffset);
+	if (writer->blockUsed &&
+	    (((writer->blockUsed + deltaSize) > sizeof(writer->block)) || (header->entryCount == Uint16Max)))
+	{
+		FlushListingIndexBlock(writer);
+	}
+
+	if (!writer->blockUsed)
+	{
+		header->inputOffset = entry.inputOffset;
+		header->listingOffset = entry.listingOffset;
+		header->lineNumber = entry.lineNumber;
+		header->flags = entry.flags;
+		header->entryCount = 1;
+		writer->blockUsed = sizeof(listing_index_block_header);
+	}
+	else
+	{
+		CopySize(deltaSize, delta, writer->block + writer->blockUsed);
+		writer->blockUsed += deltaSize;
+		header->dataSize = (u16)(writer->blockUsed - sizeof(listing_index_block_header));
+		++header->entryCount;
+	}
+
+	writer->last = entry;
+	++writer->entryCount;
+}
+
+internal void FinishListingIndex(listing_index_writer *writer, u64 inputSize, u64 listingSize)
+{
+	FlushListingIndexBlock(writer);
+
+	listing_index_trailer trailer = {};
+	trailer.magic = ListingIndexMagic;
+	trailer.version = ListingIndexVersion;
+	trailer.inputSize = inputSize;
+	trailer.listingSize = listingSize;
+	trailer.entryCount = writer->entryCount;
+	trailer.blockSize = ListingIndexBlockSize;
+	SinkWrite(writer->sink, &trailer, sizeof(trailer));
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Reading
+//-------------------------------------------------------------------------
+
+//NOTE (Aske): The blocks point straight into indexFile. Fails unless the index is whole,
+//and was written for an input of inputSize bytes and a listing of listingSize bytes.
+internal b32 ReadListingIndex(debug_read_file_result *indexFile, u64 inputSize, u64 listingSize,
+                              listing_index *result)
+{
+	*result = {};
+	if (!indexFile->Contents || (indexFile->ContentsSize < sizeof(listing_index_trailer)))
+	{
+		return false;
+	}
+
+	u64 blocksSize = indexFile->ContentsSize - sizeof(listing_index_trailer);
+	listing_index_trailer *trailer = (listing_index_trailer *)((u8 *)indexFile->Contents + blocksSize);
+	b32 isValid = (trailer->magic == ListingIndexMagic) && (trailer->version == ListingIndexVersion) &&
+	              (trailer->blockSize == ListingIndexBlockSize) && ((blocksSize % ListingIndexBlockSize) == 0) &&
+	              (trailer->inputSize == inputSize) && (trailer->listingSize == listingSize) &&
+	              ((trailer->entryCount > 0) == (blocksSize > 0));
+	if (isValid)
+	{
+		result->blocks = (u8 *)indexFile->Contents;
+		result->blockCount = blocksSize / ListingIndexBlockSize;
+		result->entryCount = trailer->entryCount;
+		result->listingSize = listingSize;
+	}
+	return isValid;
+}
+
+internal listing_index_block_header *ListingIndexBlock(listing_index *index, s64 blockIndex)
+{
+	return (listing_index_block_header *)(index->blocks + blockIndex * ListingIndexBlockSize);
+}
+
+internal u64 ReadVarint(u8 *source, u32 *at)
+{
+	u64 result = 0;
+	u32 shift = 0;
+	u8 b;
+	do
+	{
+		b = source[(*at)++];
+		result |= (u64)(b & 0x7F) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	return result;
+}
+
+internal listing_index_cursor ListingIndexBlockStart(listing_index *index, s64 blockIndex)
+{
+	listing_index_cursor result = {};
+	result.index = index;
+	result.blockIndex = blockIndex;
+	result.isValid = (blockIndex < index->blockCount);
+	if (result.isValid)
+	{
+		listing_index_block_header *header = ListingIndexBlock(index, blockIndex);
+		result.entry.inputOffset = header->inputOffset;
+		result.entry.listingOffset = header->listingOffset;
+		result.entry.lineNumber = header->lineNumber;
+		result.entry.flags = header->flags;
+	}
+	return result;
+}
+
+internal listing_index_cursor ListingIndexFirst(listing_index *index)
+{
+	return ListingIndexBlockStart(index, 0);
+}
+
+internal void ListingIndexNext(listing_index_cursor *cursor)
+{
+	listing_index_block_header *header = ListingIndexBlock(cursor->index, cursor->blockIndex);
+	if ((cursor->entryInBlock + 1) >= header->entryCount)
+	{
+		*cursor = ListingIndexBlockStart(cursor->index, cursor->blockIndex + 1);
+		return;
+	}
+
+	u8 *data = (u8 *)(header + 1);
+	u64 inputDeltaAndFlags = ReadVarint(data, &cursor->dataAt);
+	u64 listingDelta = ReadVarint(data, &cursor->dataAt);
+	cursor->entry.flags = (u32)(inputDeltaAndFlags & 0x3);
+	cursor->entry.inputOffset += (s64)(inputDeltaAndFlags >> 2);
+	cursor->entry.listingOffset += (s64)listingDelta;
+	cursor->entry.lineNumber += (cursor->entry.flags & ListingIndexFlag_hasLabel) ? 2 : 1;
+	++cursor->entryInBlock;
+}
+
+//NOTE (Aske): The last entry at or before inputOffset that has none of skippedFlags.
+//Not valid when there isn't one.
+internal listing_index_cursor ListingIndexSeek(listing_index *index, s64 inputOffset, u32 skippedFlags)
+{
+	//NOTE (Aske): The last block that starts at or before inputOffset
+	s64 left = 0;
+	s64 right = index->blockCount - 1;
+	s64 blockIndex = -1;
+	while (left <= right)
+	{
+		s64 mid = left + ((right - left) / 2);
+		if (ListingIndexBlock(index, mid)->inputOffset <= inputOffset)
+		{
+			blockIndex = mid;
+			left = mid + 1;
+		}
+		else
+		{
+			right = mid - 1;
+		}
+	}
+
+	listing_index_cursor result = {};
+	for (; (blockIndex >= 0) && !result.isValid; --blockIndex)
+	{
+		for (listing_index_cursor cursor = ListingIndexBlockStart(index, blockIndex);
+		     cursor.isValid && (cursor.blockIndex == blockIndex) && (cursor.entry.inputOffset <= inputOffset);
+		     ListingIndexNext(&cursor))
+		{
+			if (!(cursor.entry.flags & skippedFlags))
+			{
+				result = cursor;
+			}
+		}
+	}
+	return result;
+}
@@ -0,0 +1,233 @@
+//NOTE (Aske): The SSE2, AVX2 and AVX-512 kernels behind CopySize and ZeroSize, picked once at startup from cpuid.
+//Each one goes forward a vector at a time. The last vector of the source is loaded before the loop and stored
+//after it, overlapping the loop's last store, so there's no byte loop at the end. Like the plain loops,
+//that makes it safe for the ranges to overlap when dest comes first.
+//Anything shorter than a vector is handed down to the next narrower kernel.
+//-bench:memory checks them against the plain loops and times them across sizes.
+
+enum memory_kernel_level
+{
+	MemoryKernel_naive,
+	MemoryKernel_sse2,
+	MemoryKernel_avx2,
+	MemoryKernel_avx512,
+
+	MemoryKernel_count,
+};
+
+global_variable char *memoryKernelNames[MemoryKernel_count] = { "naive", "sse2", "avx2", "avx512" };
+
+#if DECODER_SIMD_KERNELS
+#include <immintrin.h>
+#if defined(_MSC_VER)
+//NOTE (Aske): MSVC compiles any intrinsic without being told the target
+#define KernelTarget(features)
+#else
+#include <cpuid.h>
+#define KernelTarget(features) __attribute__((target(features)))
+#endif
+
+internal void *CopySse2(size_t byteCount, void *source, void *dest)
+{
+	u8 *from = (u8 *)source;
+	u8 *to = (u8 *)dest;
+	if (byteCount < 16)
+	{
+		CopySmall(byteCount, from, to);
+	}
+	else
+	{
+		__m128i head = _mm_loadu_si128((__m128i *)from);
+		__m128i tail = _mm_loadu_si128((__m128i *)(from + byteCount - 16));
+		u8 *toTail = to + byteCount - 16;
+		_mm_storeu_si128((__m128i *)to, head);
+		for (from += 16, to += 16; to < toTail; from += 16, to += 16)
+		{
+			_mm_storeu_si128((__m128i *)to, _mm_loadu_si128((__m128i *)from));
+		}
+		_mm_storeu_si128((__m128i *)toTail, tail);
+	}
+	return (u8 *)dest + byteCount;
+}
+
+KernelTarget("avx2")
+internal void *CopyAvx2(size_t byteCount, void *source, void *dest)
+{
+	if (byteCount < 32)
+	{
+		return CopySse2(byteCount, source, dest);
+	}
+
+	u8 *from = (u8 *)source;
+	u8 *to = (u8 *)dest;
+	__m256i head = _mm256_loadu_si256((__m256i *)from);
+	__m256i tail = _mm256_loadu_si256((__m256i *)(from + byteCount - 32));
+	u8 *toTail = to + byteCount - 32;
+	_mm256_storeu_si256((__m256i *)to, head);
+	for (from += 32, to += 32; to < toTail; from += 32, to += 32)
+	{
+		_mm256_storeu_si256((__m256i *)to, _mm256_loadu_si256((__m256i *)from));
+	}
+	_mm256_storeu_si256((__m256i *)toTail, tail);
+	return (u8 *)dest + byteCount;
+}
+
+KernelTarget("avx512f")
+internal void *CopyAvx512(size_t byteCount, void *source, void *dest)
+{
+	if (byteCount < 64)
+	{
+		return CopyAvx2(byteCount, source, dest);
+	}
+
+	u8 *from = (u8 *)source;
+	u8 *to = (u8 *)dest;
+	__m512i head = _mm512_loadu_si512((void *)from);
+	__m512i tail = _mm512_loadu_si512((void *)(from + byteCount - 64));
+	u8 *toTail = to + byteCount - 64;
+	_mm512_storeu_si512((void *)to, head);
+	for (from += 64, to += 64; to < toTail; from += 64, to += 64)
+	{
+		_mm512_storeu_si512((void *)to, _mm512_loadu_si512((void *)from));
+	}
+	_mm512_storeu_si512((void *)toTail, tail);
+	return (u8 *)dest + byteCount;
+}
+
+internal void *ZeroSse2(void *ptr, size_t size)
+{
+	u8 *to = (u8 *)ptr;
+	if (size < 16)
+	{
+		ZeroSmall(size, to);
+	}
+	else
+	{
+		__m128i zero = _mm_setzero_si128();
+		u8 *toTail = to + size - 16;
+		for (; to < toTail; to += 16)
+		{
+			_mm_storeu_si128((__m128i *)to, zero);
+		}
+		_mm_storeu_si128((__m128i *)toTail, zero);
+	}
+	return (u8 *)ptr + size;
+}
+
+KernelTarget("avx2")
+internal void *ZeroAvx2(void *ptr, size_t size)
+{
+	if (size < 32)
+	{
+		return ZeroSse2(ptr, size);
+	}
+
+	__m256i zero = _mm256_setzero_si256();
+	u8 *to = (u8 *)ptr;
+	u8 *toTail = to + size - 32;
+	for (; to < toTail; to += 32)
+	{
+		_mm256_storeu_si256((__m256i *)to, zero);
+	}
+	_mm256_storeu_si256((__m256i *)toTail, zero);
+	return (u8 *)ptr + size;
+}
+
+KernelTarget("avx512f")
+internal void *ZeroAvx512(void *ptr, size_t size)
+{
+	if (size < 64)
+	{
+		return ZeroAvx2(ptr, size);
+	}
+
+	__m512i zero = _mm512_setzero_si512();
+	u8 *to = (u8 *)ptr;
+	u8 *toTail = to + size - 64;
+	for (; to < toTail; to += 64)
+	{
+		_mm512_storeu_si512((void *)to, zero);
+	}
+	_mm512_storeu_si512((void *)toTail, zero);
+	return (u8 *)ptr + size;
+}
+
+global_variable copy_kernel *copyKernels[MemoryKernel_count] = { NaiveWiderCopy, CopySse2, CopyAvx2, CopyAvx512 };
+global_variable zero_kernel *zeroKernels[MemoryKernel_count] = { NaiveZeroSize, ZeroSse2, ZeroAvx2, ZeroAvx512 };
+
+//NOTE (Aske): The CPU has to have the instructions, and the OS has to save the wider registers on a context switch
+internal u32 DetectMemoryKernelLevel()
+{
+	u32 leaf1Ecx;
+	u32 leaf7Ebx = 0;
+	u64 enabledState = 0;
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	s32 maxLeaf = info[0];
+	__cpuid(info, 1);
+	leaf1Ecx = (u32)info[2];
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		leaf7Ebx = (u32)info[1];
+	}
+	if (leaf1Ecx & (1 << 27))
+	{
+		enabledState = _xgetbv(0);
+	}
+#else
+	u32 eax, ebx, edx;
+	u32 maxLeaf = __get_cpuid_max(0, 0);
+	__cpuid(1, eax, ebx, leaf1Ecx, edx);
+	if (maxLeaf >= 7)
+	{
+		u32 ecx;
+		__cpuid_count(7, 0, eax, leaf7Ebx, ecx, edx);
+	}
+	if (leaf1Ecx & (1 << 27))
+	{
+		u32 low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		enabledState = ((u64)high << 32) | low;
+	}
+#endif
+
+	//NOTE (Aske): Every x64 CPU has SSE2
+	u32 result = MemoryKernel_sse2;
+	b32 isSavingYmm = ((enabledState & 0x6) == 0x6);
+	b32 isSavingZmm = isSavingYmm && ((enabledState & 0xE0) == 0xE0);
+	if (isSavingYmm && (leaf7Ebx & (1 << 5)))
+	{
+		result = MemoryKernel_avx2;
+	}
+	if (isSavingZmm && (leaf7Ebx & (1 << 16)))
+	{
+		result = MemoryKernel_avx512;
+	}
+	return result;
+}
+#else
+global_variable copy_kernel *copyKernels[MemoryKernel_count] = { NaiveWiderCopy };
+global_variable zero_kernel *zeroKernels[MemoryKernel_count] = { NaiveZeroSize };
+
+internal u32 DetectMemoryKernelLevel()
+{
+	return MemoryKernel_naive;
+}
+#endif
+
+internal void SetMemoryKernels(u32 level)
+{
+	Assert(level < MemoryKernel_count && copyKernels[level]);
+	CopyKernel = copyKernels[level];
+	ZeroKernel = zeroKernels[level];
+}
+
+//NOTE (Aske): Sets the globals, so call it before starting any threads
+internal u32 InitializeMemoryKernels()
+{
+	u32 result = DetectMemoryKernelLevel();
+	SetMemoryKernels(result);
+	return result;
+}
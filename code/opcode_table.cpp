@@ -0,0 +1,445 @@
+//NOTE (Aske): One descriptor per opcode, built at compile time. The decoder takes its handlers from here,
+//and the label pass and the speculative walks of the split decode take instruction lengths from here,
+//so what an opcode consumes is only written down once.
+
+enum opcode_flags
+{
+	OpcodeFlag_modRnm = 0x1,  //mod/reg/rnm byte and its displacement follow the opcode
+	OpcodeFlag_prefix = 0x2,  //Doesn't end the line
+	OpcodeFlag_notUsed = 0x4,
+};
+
+enum immediate_kind
+{
+	Immediate_none,
+	Immediate_byte,
+	Immediate_word,
+	Immediate_byteOrWord,       //A word when the width bit is set
+	Immediate_signExtended,     //A word only when s=0 and w=1 (0x80-0x83)
+	Immediate_group1,           //Only for test (reg == 0), of the opcode's width
+	Immediate_segmentAndOffset, //Two words
+};
+
+enum width_bit
+{
+	WidthBit_none,  //Always 16-bit, or no operand to be wide
+	WidthBit_last,  //w is bit 0
+	WidthBit_fifth, //w is bit 3 (mov immediate to register)
+};
+
+enum branch_kind
+{
+	Branch_none,
+	Branch_short, //8-bit relative
+	Branch_near,  //16-bit relative
+	Branch_far,   //Absolute segment and offset, never labeled
+};
+
+//NOTE (Aske): Every handler in the table, so the computed-goto dispatch can have a label for each of them
+#define OPCODE_HANDLERS(X) \
+	X(AddOrAdcSbbAndSubXorCmpRom) X(AddOrAdcSbbAndSubXorCmpAccumulator) X(PushPopSegreg) X(OpNotUsed) \
+	X(SegmentPrefix) X(DaaDasAaaAas) X(IncDecPushPop) X(AllJumps) X(AddOrAdcSbbAndSubXorCmpImmediate) \
+	X(TestXchgRom) X(MovRom) X(MovSegreg) X(LeaLesLdsRom16) X(PopRom16) X(XchgAccReg16) \
+	X(CbwCwdWaitPushfPopfSahfLahf) X(CallJumpDirectIntersegment) X(MovMemAccumulator) X(MovsCmpsStosLodsScas) \
+	X(TestAccumulator) X(MovImmToRegister) X(RetIntraIntersegment) X(MovImmToMemory) X(IntIntoIret) \
+	X(RolRorRclRcrSalShlShrSar) X(AamAad) X(Xlat) X(Escape) X(LoopLoopeLoopneJcxz) X(InOutFixedPort8) \
+	X(CallJumpDirectIntrasegment16) X(JumpDirectIntrasegment8) X(InOutVariablePort) X(LockPrefix) \
+	X(RepneRepHltCmc) X(TestNotNegMulImulDivIdivRomImmediate) X(ClcStcCliStiCldStd) X(IncDecRom8) \
+	X(IncDecCallJmpPushRom16)
+
+#define OpcodeHandlerPointer(name) name,
+global_variable constexpr asm_operation *opcodeHandlers[] = { OPCODE_HANDLERS(OpcodeHandlerPointer) };
+#undef OpcodeHandlerPointer
+#define OpcodeHandlerCount ArrayCount(opcodeHandlers)
+
+internal constexpr u8 OpcodeHandlerIndex(asm_operation *handler)
+{
+	u8 result = OpcodeHandlerCount;
+	for (u8 i = 0; i < OpcodeHandlerCount; ++i)
+	{
+		if (opcodeHandlers[i] == handler) result = i;
+	}
+	return result;
+}
+
+struct opcode_descriptor
+{
+	asm_operation *handler;
+	u8 handlerIndex; //NOTE (Aske): Into opcodeHandlers
+	u8 flags;
+	u8 immediateKind;
+	u8 widthBit;
+	u8 branchKind;
+	u8 fixedBytes; //NOTE (Aske): Bytes after the opcode, not counting mod/reg/rnm and displacement
+};
+
+struct opcode_table
+{
+	opcode_descriptor descriptors[256];
+};
+
+internal constexpr b32 IsOpcodeWide(u8 opcode, u8 widthBit)
+{
+	return (widthBit == WidthBit_last) ? (opcode & 0x1) :
+	       (widthBit == WidthBit_fifth) ? ((opcode >> 3) & 0x1) : 1;
+}
+
+internal constexpr u8 ImmediateFixedBytes(u8 opcode, u8 immediateKind, u8 widthBit)
+{
+	return (immediateKind == Immediate_byte) ? 1 :
+	       (immediateKind == Immediate_word) ? 2 :
+	       (immediateKind == Immediate_byteOrWord) ? (IsOpcodeWide(opcode, widthBit) ? 2 : 1) :
+	       (immediateKind == Immediate_signExtended) ? (((opcode & 0x3) == 1) ? 2 : 1) :
+	       (immediateKind == Immediate_segmentAndOffset) ? 4 : 0;
+}
+
+internal constexpr void SetOpcodes(opcode_table &table, u8 first, u8 last, asm_operation *handler, u8 flags,
+                                   immediate_kind immediateKind, width_bit widthBit, branch_kind branchKind)
+{
+	for (u16 opcode = first; opcode <= last; ++opcode)
+	{
+		opcode_descriptor &descriptor = table.descriptors[opcode];
+		descriptor.handler = handler;
+		descriptor.handlerIndex = OpcodeHandlerIndex(handler);
+		descriptor.flags = flags;
+		descriptor.immediateKind = (u8)immediateKind;
+		descriptor.widthBit = (u8)widthBit;
+		descriptor.branchKind = (u8)branchKind;
+		descriptor.fixedBytes = ImmediateFixedBytes((u8)opcode, (u8)immediateKind, (u8)widthBit);
+	}
+}
+
+#define Rom OpcodeFlag_modRnm
+#define Prefix OpcodeFlag_prefix
+#define NotUsed OpcodeFlag_notUsed
+
+//NOTE (Aske): Trying to be parallel with Table 4-13 in 8086 1979 user's manual (p. 169):
+internal constexpr opcode_table MakeOpcodeTable()
+{
+	opcode_table table = {};
+	SetOpcodes(table, 0x00, 0x03, AddOrAdcSbbAndSubXorCmpRom,           Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x04, 0x05, AddOrAdcSbbAndSubXorCmpAccumulator,   0,       Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0x06, 0x07, PushPopSegreg,                        0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x08, 0x0b, AddOrAdcSbbAndSubXorCmpRom,           Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x0c, 0x0d, AddOrAdcSbbAndSubXorCmpAccumulator,   0,       Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0x0e, 0x0e, PushPopSegreg,                        0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x0f, 0x0f, OpNotUsed,                            NotUsed, Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x10, 0x13, AddOrAdcSbbAndSubXorCmpRom,           Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x14, 0x15, AddOrAdcSbbAndSubXorCmpAccumulator,   0,       Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0x16, 0x17, PushPopSegreg,                        0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x18, 0x1b, AddOrAdcSbbAndSubXorCmpRom,           Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x1c, 0x1d, AddOrAdcSbbAndSubXorCmpAccumulator,   0,       Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0x1e, 0x1f, PushPopSegreg,                        0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x20, 0x23, AddOrAdcSbbAndSubXorCmpRom,           Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x24, 0x25, AddOrAdcSbbAndSubXorCmpAccumulator,   0,       Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0x26, 0x26, SegmentPrefix,                        Prefix,  Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x27, 0x27, DaaDasAaaAas,                         0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x28, 0x2b, AddOrAdcSbbAndSubXorCmpRom,           Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x2c, 0x2d, AddOrAdcSbbAndSubXorCmpAccumulator,   0,       Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0x2e, 0x2e, SegmentPrefix,                        Prefix,  Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x2f, 0x2f, DaaDasAaaAas,                         0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x30, 0x33, AddOrAdcSbbAndSubXorCmpRom,           Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x34, 0x35, AddOrAdcSbbAndSubXorCmpAccumulator,   0,       Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0x36, 0x36, SegmentPrefix,                        Prefix,  Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x37, 0x37, DaaDasAaaAas,                         0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x38, 0x3b, AddOrAdcSbbAndSubXorCmpRom,           Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x3c, 0x3d, AddOrAdcSbbAndSubXorCmpAccumulator,   0,       Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0x3e, 0x3e, SegmentPrefix,                        Prefix,  Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x3f, 0x3f, DaaDasAaaAas,                         0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x40, 0x5f, IncDecPushPop,                        0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x60, 0x6f, OpNotUsed,                            NotUsed, Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x70, 0x7f, AllJumps,                             0,       Immediate_byte,   WidthBit_none,  Branch_short);
+	SetOpcodes(table, 0x80, 0x83, AddOrAdcSbbAndSubXorCmpImmediate,     Rom,     Immediate_signExtended, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0x84, 0x87, TestXchgRom,                          Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x88, 0x8b, MovRom,                               Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0x8c, 0x8c, MovSegreg,                            Rom,     Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x8d, 0x8d, LeaLesLdsRom16,                       Rom,     Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x8e, 0x8e, MovSegreg,                            Rom,     Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x8f, 0x8f, PopRom16,                             Rom,     Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x90, 0x97, XchgAccReg16,                         0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x98, 0x99, CbwCwdWaitPushfPopfSahfLahf,          0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0x9a, 0x9a, CallJumpDirectIntersegment,           0,       Immediate_segmentAndOffset, WidthBit_none, Branch_far);
+	SetOpcodes(table, 0x9b, 0x9f, CbwCwdWaitPushfPopfSahfLahf,          0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xa0, 0xa3, MovMemAccumulator,                    0,       Immediate_word,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0xa4, 0xa7, MovsCmpsStosLodsScas,                 0,       Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0xa8, 0xa9, TestAccumulator,                      0,       Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0xaa, 0xaf, MovsCmpsStosLodsScas,                 0,       Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0xb0, 0xbf, MovImmToRegister,                     0,       Immediate_byteOrWord, WidthBit_fifth, Branch_none);
+	SetOpcodes(table, 0xc0, 0xc1, OpNotUsed,                            NotUsed, Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xc2, 0xc2, RetIntraIntersegment,                 0,       Immediate_word,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xc3, 0xc3, RetIntraIntersegment,                 0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xc4, 0xc5, LeaLesLdsRom16,                       Rom,     Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xc6, 0xc7, MovImmToMemory,                       Rom,     Immediate_byteOrWord, WidthBit_last, Branch_none);
+	SetOpcodes(table, 0xc8, 0xc9, OpNotUsed,                            NotUsed, Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xca, 0xca, RetIntraIntersegment,                 0,       Immediate_word,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xcb, 0xcb, RetIntraIntersegment,                 0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xcc, 0xcc, IntIntoIret,                          0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xcd, 0xcd, IntIntoIret,                          0,       Immediate_byte,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xce, 0xcf, IntIntoIret,                          0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xd0, 0xd3, RolRorRclRcrSalShlShrSar,             Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0xd4, 0xd5, AamAad,                               0,       Immediate_byte,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xd6, 0xd6, OpNotUsed,                            NotUsed, Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xd7, 0xd7, Xlat,                                 0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xd8, 0xdf, Escape,                               Rom,     Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xe0, 0xe3, LoopLoopeLoopneJcxz,                  0,       Immediate_byte,   WidthBit_none,  Branch_short);
+	SetOpcodes(table, 0xe4, 0xe7, InOutFixedPort8,                      0,       Immediate_byte,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0xe8, 0xe9, CallJumpDirectIntrasegment16,         0,       Immediate_word,   WidthBit_none,  Branch_near);
+	SetOpcodes(table, 0xea, 0xea, CallJumpDirectIntersegment,           0,       Immediate_segmentAndOffset, WidthBit_none, Branch_far);
+	SetOpcodes(table, 0xeb, 0xeb, JumpDirectIntrasegment8,              0,       Immediate_byte,   WidthBit_none,  Branch_short);
+	SetOpcodes(table, 0xec, 0xef, InOutVariablePort,                    0,       Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0xf0, 0xf0, LockPrefix,                           Prefix,  Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xf1, 0xf1, OpNotUsed,                            NotUsed, Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xf2, 0xf3, RepneRepHltCmc,                       Prefix,  Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xf4, 0xf5, RepneRepHltCmc,                       0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xf6, 0xf7, TestNotNegMulImulDivIdivRomImmediate, Rom,     Immediate_group1, WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0xf8, 0xfd, ClcStcCliStiCldStd,                   0,       Immediate_none,   WidthBit_none,  Branch_none);
+	SetOpcodes(table, 0xfe, 0xfe, IncDecRom8,                           Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	SetOpcodes(table, 0xff, 0xff, IncDecCallJmpPushRom16,               Rom,     Immediate_none,   WidthBit_last,  Branch_none);
+	return table;
+}
+
+#undef Rom
+#undef Prefix
+#undef NotUsed
+
+global_variable constexpr opcode_table opcodeTable = MakeOpcodeTable();
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Consistency checks, so the table can't drift from itself
+//-------------------------------------------------------------------------
+
+internal constexpr b32 IsEveryOpcodeHandled(const opcode_table &table)
+{
+	for (u16 opcode = 0x00; opcode <= 0xff; ++opcode)
+	{
+		if (!table.descriptors[opcode].handler) return false;
+	}
+	return true;
+}
+
+//NOTE (Aske): A handler either always reads a mod/reg/rnm byte or never does
+internal constexpr b32 DoHandlersAgreeOnModRnm(const opcode_table &table)
+{
+	for (u16 a = 0x00; a <= 0xff; ++a)
+	{
+		for (u16 b = a + 1; b <= 0xff; ++b)
+		{
+			const opcode_descriptor &first = table.descriptors[a];
+			const opcode_descriptor &second = table.descriptors[b];
+			if ((first.handler == second.handler) &&
+			    ((first.flags & OpcodeFlag_modRnm) != (second.flags & OpcodeFlag_modRnm)))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+internal constexpr b32 AreDescriptorsConsistent(const opcode_table &table)
+{
+	for (u16 opcode = 0x00; opcode <= 0xff; ++opcode)
+	{
+		const opcode_descriptor &descriptor = table.descriptors[opcode];
+		b32 hasModRnm = descriptor.flags & OpcodeFlag_modRnm;
+		b32 isBareOpcode = !hasModRnm && (descriptor.immediateKind == Immediate_none) &&
+		                   (descriptor.widthBit == WidthBit_none) && (descriptor.branchKind == Branch_none);
+
+		//NOTE (Aske): Prefixes and unused opcodes are a single byte, and don't use a width bit
+		if ((descriptor.flags & (OpcodeFlag_prefix | OpcodeFlag_notUsed)) && !isBareOpcode) return false;
+
+		//NOTE (Aske): The immediate has to be wide enough for the branch
+		if ((descriptor.branchKind == Branch_short) && (descriptor.immediateKind != Immediate_byte)) return false;
+		if ((descriptor.branchKind == Branch_near) && (descriptor.immediateKind != Immediate_word)) return false;
+		if ((descriptor.branchKind == Branch_far) != (descriptor.immediateKind == Immediate_segmentAndOffset)) return false;
+
+		//NOTE (Aske): Immediates that depend on the width need a width bit
+		if (((descriptor.immediateKind == Immediate_byteOrWord) || (descriptor.immediateKind == Immediate_group1) ||
+		     (descriptor.immediateKind == Immediate_signExtended)) && (descriptor.widthBit == WidthBit_none)) return false;
+		if ((descriptor.immediateKind == Immediate_group1) && !hasModRnm) return false;
+
+		if (descriptor.fixedBytes > (MaxInstructionSize - 1)) return false;
+		if ((descriptor.handlerIndex >= OpcodeHandlerCount) ||
+		    (opcodeHandlers[descriptor.handlerIndex] != descriptor.handler)) return false;
+	}
+	return true;
+}
+
+static_assert(IsEveryOpcodeHandled(opcodeTable), "Every opcode needs a handler, even if it's OpNotUsed");
+static_assert(DoHandlersAgreeOnModRnm(opcodeTable), "Opcodes sharing a handler disagree about mod/reg/rnm");
+static_assert(AreDescriptorsConsistent(opcodeTable), "An opcode descriptor contradicts itself");
+static_assert(opcodeTable.descriptors[0x05].fixedBytes == 2, "add ax, imm16");
+static_assert(opcodeTable.descriptors[0x83].fixedBytes == 1, "Sign-extended imm8");
+static_assert(opcodeTable.descriptors[0xb3].fixedBytes == 1, "mov bl, imm8");
+static_assert(opcodeTable.descriptors[0xbb].fixedBytes == 2, "mov bx, imm16");
+static_assert(opcodeTable.descriptors[0xea].fixedBytes == 4, "jmp far segment:offset");
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Instruction lengths without decoding
+//-------------------------------------------------------------------------
+
+enum instruction_length_flags
+{
+	LengthFlag_ModRnm = 0x10,       //mod/reg/rnm byte and its displacement follow
+	LengthFlag_Group1Immediate = 0x20,  //test (reg == 0) has an immediate of the opcode's width
+	LengthFlag_Prefix = 0x40,       //Doesn't end the line, so a chunk can't start right after it
+	LengthFlag_RelativeBranch = 0x80, //Short or near, so the fixed bytes are an 8- or 16-bit displacement
+};
+#define LengthFixedBytesMask 0x0f //NOTE (Aske): Bytes after the opcode, not counting mod/reg/rnm and displacement
+
+//NOTE (Aske): The descriptors packed into a byte each, so walking lengths touches 256 bytes instead of 4 KB
+struct instruction_length_table
+{
+	u8 lengths[256];
+};
+
+internal constexpr instruction_length_table MakeInstructionLengthTable(const opcode_table &table)
+{
+	instruction_length_table result = {};
+	for (u16 opcode = 0x00; opcode <= 0xff; ++opcode)
+	{
+		const opcode_descriptor &descriptor = table.descriptors[opcode];
+		u8 lengthInfo = descriptor.fixedBytes;
+		if (descriptor.flags & OpcodeFlag_modRnm) lengthInfo |= LengthFlag_ModRnm;
+		if (descriptor.immediateKind == Immediate_group1) lengthInfo |= LengthFlag_Group1Immediate;
+		if (descriptor.flags & OpcodeFlag_prefix) lengthInfo |= LengthFlag_Prefix;
+		if ((descriptor.branchKind == Branch_short) || (descriptor.branchKind == Branch_near))
+		{
+			lengthInfo |= LengthFlag_RelativeBranch;
+		}
+		result.lengths[opcode] = lengthInfo;
+	}
+	return result;
+}
+
+//NOTE (Aske): The mod/reg/rnm byte itself plus its displacement, keyed on the mod/reg/rnm byte
+internal constexpr instruction_length_table MakeModRnmLengthTable()
+{
+	instruction_length_table result = {};
+	for (u16 modRegRnm = 0x00; modRegRnm <= 0xff; ++modRegRnm)
+	{
+		u8 mod = modRegRnm >> 6;
+		u8 rnm = modRegRnm & 0x7;
+		result.lengths[modRegRnm] = 1 + ((mod == 1) ? 1 : ((mod == 2) || (mod == 0 && rnm == 6)) ? 2 : 0);
+	}
+	return result;
+}
+
+global_variable constexpr instruction_length_table instructionLengthTable = MakeInstructionLengthTable(opcodeTable);
+global_variable constexpr instruction_length_table modRnmLengthTable = MakeModRnmLengthTable();
+
+static_assert(instructionLengthTable.lengths[0x81] == (LengthFlag_ModRnm | 2), "Group 1 with imm16");
+static_assert(instructionLengthTable.lengths[0xf7] == (LengthFlag_ModRnm | LengthFlag_Group1Immediate), "test/not/neg...");
+static_assert(instructionLengthTable.lengths[0xf3] == LengthFlag_Prefix, "rep");
+static_assert(instructionLengthTable.lengths[0xe9] == (LengthFlag_RelativeBranch | 2), "jmp near");
+static_assert(modRnmLengthTable.lengths[0x06] == 3, "Direct address");
+static_assert(modRnmLengthTable.lengths[0x46] == 2, "[bp + disp8]");
+
+//NOTE (Aske): Without a single branch, so it needs MaxInstructionSize bytes to be readable from index.
+//The mod/reg/rnm byte is read even when there isn't one, and then multiplied away.
+internal s64 InstructionLengthUnchecked(u8 *bytes, s64 index)
+{
+	u8 opcode = bytes[index];
+	u8 modRegRnm = bytes[index + 1];
+	u32 lengthInfo = instructionLengthTable.lengths[opcode];
+	u32 hasModRnm = (lengthInfo >> 4) & 0x1;
+	u32 hasGroup1Immediate = ((lengthInfo >> 5) & 0x1) & (((modRegRnm >> 3) & 0x7) == 0);
+	s64 result = 1 + (lengthInfo & LengthFixedBytesMask) + hasModRnm*modRnmLengthTable.lengths[modRegRnm] +
+	             hasGroup1Immediate*(1 + (opcode & 0x1));
+	return result;
+}
+
+//NOTE (Aske): Never reads past size. A truncated instruction just ends the walk.
+internal s64 InstructionLengthAt(u8 *bytes, s64 index, s64 size)
+{
+	if (index + MaxInstructionSize <= size)
+	{
+		return InstructionLengthUnchecked(bytes, index);
+	}
+
+	u8 opcode = bytes[index];
+	u8 lengthInfo = instructionLengthTable.lengths[opcode];
+	s64 result = 1 + (lengthInfo & LengthFixedBytesMask);
+	if ((lengthInfo & LengthFlag_ModRnm) && (index + 1 < size))
+	{
+		u8 modRegRnm = bytes[index + 1];
+		u8 reg = (modRegRnm >> 3) & 0x7;
+		result += modRnmLengthTable.lengths[modRegRnm];
+
+		if ((lengthInfo & LengthFlag_Group1Immediate) && (reg == 0))
+		{
+			result += (opcode & 0x1) ? 2 : 1;
+		}
+	}
+	return result;
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Length decoding kernel, for finding labels without decoding
+//-------------------------------------------------------------------------
+
+struct instruction_lengths
+{
+	s64 count;
+	u8 *lengths;        //NOTE (Aske): One per instruction, prefixes included
+	s64 branchCount;
+	s32 *branchTargets; //NOTE (Aske): Short and near branches that land inside the file, in instruction order
+};
+
+//NOTE (Aske): Every instruction is at least one byte. One extra branch target, since one is written every time
+internal instruction_lengths PushInstructionLengths(memory_arena *arena, s64 byteCount)
+{
+	instruction_lengths result = {};
+	result.lengths = PushArray(arena, byteCount, u8);
+	result.branchTargets = PushArray(arena, byteCount + 1, s32);
+	return result;
+}
+
+//NOTE (Aske): Target of the relative branch at index, or garbage if it isn't one.
+//The fixed bytes say if the displacement is 8- or 16-bit.
+internal s64 RelativeBranchTargetUnchecked(u8 *bytes, s64 index, s64 length)
+{
+	u32 lengthInfo = instructionLengthTable.lengths[bytes[index]];
+	s8 shortDisplacement = (s8)bytes[index + 1];
+	s16 nearDisplacement = (s16)(bytes[index + 1] | (bytes[index + 2] << 8));
+	s64 displacement = ((lengthInfo & LengthFixedBytesMask) == 1) ? shortDisplacement : nearDisplacement;
+	return index + length + displacement;
+}
+
+//NOTE (Aske): Walks the whole file. The target is written every time, but only counted for branches inside the file,
+//so the loop has no data-dependent branches apart from the walk itself. The last few bytes go through the checked path.
+internal void DecodeInstructionLengths(u8 *bytes, s64 size, instruction_lengths *result)
+{
+	s64 count = 0;
+	s64 branchCount = 0;
+	s64 at = 0;
+	for (; at + MaxInstructionSize <= size; ++count)
+	{
+		s64 length = InstructionLengthUnchecked(bytes, at);
+		s64 target = RelativeBranchTargetUnchecked(bytes, at, length);
+		u32 isBranch = instructionLengthTable.lengths[bytes[at]] >> 7;
+		result->lengths[count] = (u8)length;
+		result->branchTargets[branchCount] = (s32)target;
+		branchCount += isBranch & (target >= 0) & (target < size);
+		at += length;
+	}
+
+	for (; at < size; ++count)
+	{
+		s64 length = InstructionLengthAt(bytes, at, size);
+		result->lengths[count] = (u8)length;
+		if ((instructionLengthTable.lengths[bytes[at]] & LengthFlag_RelativeBranch) && (at + length <= size))
+		{
+			s64 displacement = (length == 2) ? (s8)bytes[at + 1] : (s16)(bytes[at + 1] | (bytes[at + 2] << 8));
+			s64 target = at + length + displacement;
+			if ((target >= 0) && (target < size))
+			{
+				result->branchTargets[branchCount++] = (s32)target;
+			}
+		}
+		at += length;
+	}
+
+	result->count = count;
+	result->branchCount = branchCount;
+}
@@ -0,0 +1,153 @@
+//NOTE (Aske): Where the finished listing (or the per-line echo) ends up.
+//Writes are staged in a buffer and flushed in whole chunks, so the file offsets of every write
+//except the last one are aligned to OutputSinkChunkSize.
+#define OutputSinkChunkSize Kilobytes(64)
+#define OutputSinkBufferSize (4 * OutputSinkChunkSize)
+
+enum output_sink_type
+{
+	OutputSink_null,	//Discards everything, for measuring the decoder alone
+	OutputSink_file,
+	OutputSink_stdout,
+	OutputSink_tee,		//File and stdout
+	OutputSink_arena,	//Appends to a memory arena, for the library entry point
+	OutputSink_stderr,	//For messages, which stay out of a listing on stdout
+};
+
+struct output_sink
+{
+	output_sink_type type;
+	platform_file file;
+	platform_file console;
+	platform_file copy; //NOTE (Aske): Also gets everything when it's valid, for storing the listing in the result cache
+	memory_arena *destination;
+
+	u8 *buffer;
+	u64 capacity;
+	u64 used;
+
+	u64 totalWritten;
+};
+
+internal b32 InitializeOutputSink(output_sink *sink, output_sink_type type, char *filename, memory_arena *arena)
+{
+	*sink = {};
+	sink->type = type;
+
+	b32 result = true;
+	if (type == OutputSink_file || type == OutputSink_tee)
+	{
+		sink->file = PlatformOpenFileForWriting(filename);
+		result = sink->file.isValid;
+	}
+	if (type == OutputSink_stdout || type == OutputSink_tee)
+	{
+		sink->console = PlatformGetStandardOutput();
+		result = result && sink->console.isValid;
+	}
+	if (type == OutputSink_stderr)
+	{
+		sink->console = PlatformGetStandardError();
+		result = sink->console.isValid;
+	}
+
+	if (type != OutputSink_null)
+	{
+		sink->capacity = OutputSinkBufferSize;
+		sink->buffer = (u8 *)PushSize(arena, sink->capacity);
+	}
+
+	return result;
+}
+
+//NOTE (Aske): Nothing is staged, the arena is already memory
+internal void InitializeArenaSink(output_sink *sink, memory_arena *destination)
+{
+	*sink = {};
+	sink->type = OutputSink_arena;
+	sink->destination = destination;
+}
+
+internal void SinkWriteChunks(output_sink *sink, platform_write_chunk *chunks, u32 chunkCount)
+{
+	if (sink->file.isValid)
+	{
+		PlatformWriteGather(&sink->file, chunks, chunkCount);
+	}
+	if (sink->console.isValid)
+	{
+		PlatformWriteGather(&sink->console, chunks, chunkCount);
+	}
+	if (sink->copy.isValid)
+	{
+		PlatformWriteGather(&sink->copy, chunks, chunkCount);
+	}
+}
+
+internal void SinkWrite(output_sink *sink, void *data, u64 size)
+{
+	sink->totalWritten += size;
+	if (sink->type == OutputSink_null)
+	{
+		return;
+	}
+	if (sink->type == OutputSink_arena)
+	{
+		CopySize(size, data, PushSize(sink->destination, size));
+		return;
+	}
+
+	if ((sink->used + size) < sink->capacity)
+	{
+		CopySize(size, data, sink->buffer + sink->used);
+		sink->used += size;
+	}
+	else
+	{
+		//NOTE (Aske): Write the buffered bytes and as much of data as fills whole chunks in one go,
+		//and only copy the leftover (less than a chunk) into the buffer
+		u64 pendingSize = sink->used + size;
+		u64 flushSize = pendingSize - (pendingSize % OutputSinkChunkSize);
+		Assert(flushSize >= sink->used);
+		u64 sizeFromData = flushSize - sink->used;
+
+		platform_write_chunk chunks[2] =
+		{
+			{ sink->buffer, sink->used },
+			{ data, sizeFromData },
+		};
+		SinkWriteChunks(sink, chunks, ArrayCount(chunks));
+
+		sink->used = size - sizeFromData;
+		CopySize(sink->used, (u8 *)data + sizeFromData, sink->buffer);
+	}
+}
+
+internal void SinkFlush(output_sink *sink)
+{
+	if (sink->used)
+	{
+		platform_write_chunk chunk = { sink->buffer, sink->used };
+		SinkWriteChunks(sink, &chunk, 1);
+		sink->used = 0;
+	}
+}
+
+//NOTE (Aske): Returns whether everything was written without errors
+internal b32 CloseOutputSink(output_sink *sink)
+{
+	SinkFlush(sink);
+	b32 result = true;
+	if (sink->type == OutputSink_file || sink->type == OutputSink_tee)
+	{
+		result = sink->file.isValid;
+		PlatformCloseFile(&sink->file);
+	}
+	if (sink->type == OutputSink_stdout || sink->type == OutputSink_tee || sink->type == OutputSink_stderr)
+	{
+		result = result && sink->console.isValid;
+		PlatformCloseFile(&sink->console);
+	}
+	PlatformCloseFile(&sink->copy);
+	return result;
+}
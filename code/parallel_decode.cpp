@@ -0,0 +1,318 @@
+//NOTE (Aske): Splits the decoding of one file between threads.
+//
+//1. The file is cut into fixed-size regions, and each region gets a speculative length-only walk
+//   from its first byte, in parallel. The first byte is probably in the middle of an instruction,
+//   but 8086 instruction streams tend to fall into step with each other within a few instructions.
+//2. The true instruction boundaries are followed through the regions in order. Where the true walk
+//   lands on a boundary of a region's speculative walk, the two streams have converged and the rest
+//   of that walk is taken as is. Only regions that never converge are walked again.
+//   Each region becomes a chunk that starts at its first true boundary not preceded by a prefix.
+//3. The chunks are fully decoded in parallel, each into its own text and label arrays.
+//4. The chunks are appended to the output in order and their labels are finalized, just like the serial loop.
+//   A chunk is only used if its predecessor ended exactly where it starts, with nothing carried over
+//   (no pending prefix). Otherwise it's decoded again, serially, from wherever the output actually got to.
+//   That makes the listing byte-identical to a serial decode, labels included.
+
+//NOTE (Aske): Chunks are never bigger than the serial flush interval,
+//which keeps the label arrays within the capacity the serial loop needs
+#define SplitRegionSize OutputFlushInterval
+#define SplitMinimumFileSize (2 * SplitRegionSize)
+
+struct split_workers
+{
+	s32 count;
+	memory_arena *outputPools[MaxDecodeWorkers];
+	memory_arena *scratchPads[MaxDecodeWorkers];
+};
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): The split decode itself
+//-------------------------------------------------------------------------
+
+#if LABEL_PADDING
+enum boundary_mark
+{
+	BoundaryMark_none = 0,
+	BoundaryMark_boundary = 0x1,
+	BoundaryMark_afterPrefix = 0x2, //NOTE (Aske): Or after an unknown instruction, at the start of a walk
+};
+
+struct split_chunk
+{
+	s64 regionStart;
+	s64 regionEnd;
+	s64 speculativeExit; //NOTE (Aske): First boundary of the speculative walk at or past regionEnd
+	b32 isSpeculativeExitAfterPrefix;
+
+	s64 start; //NOTE (Aske): -1 when the region has no usable start, in which case it's part of the previous chunk
+	s64 end;
+
+	memory_arena *outputPool;
+	s64 poolOffset;
+	s64 poolSize;
+	array_label_position *labelSpaces;
+	array_label_position *jumpTargets;
+	b32 isVerified; //NOTE (Aske): Decoding ended exactly at end, with no pending prefix
+};
+
+struct split_decode
+{
+	debug_read_file_result *file;
+	u8 *boundaryMarks;
+	split_chunk *chunks;
+	s32 chunkCount;
+	work_deque *deques;
+};
+
+struct split_worker
+{
+	s32 workerIndex;
+	s32 workerCount;
+	split_decode *split;
+	memory_arena *outputPool;
+	memory_arena *scratchPad;
+	s32 stealCount;
+	platform_thread thread;
+};
+
+internal b32 IsDecoderStateClean(decoder_state *decoderState)
+{
+	b32 result = decoderState->endedWithNewLine &&
+	             (decoderState->RepeatState == State_repeat_none) &&
+	             !decoderState->segmentOverride;
+	return result;
+}
+
+internal void WalkRegionSpeculatively(split_decode *split, split_chunk *chunk)
+{
+	u8 *bytes = (u8 *)split->file->Contents;
+	s64 size = split->file->ContentsSize;
+
+	s64 at = chunk->regionStart;
+	b32 isAfterPrefix = (at != 0);
+	while (at < chunk->regionEnd)
+	{
+		split->boundaryMarks[at] = BoundaryMark_boundary | (isAfterPrefix ? BoundaryMark_afterPrefix : 0);
+		isAfterPrefix = (instructionLengthTable.lengths[bytes[at]] & LengthFlag_Prefix);
+		at += InstructionLengthAt(bytes, at, size);
+	}
+	chunk->speculativeExit = at;
+	chunk->isSpeculativeExitAfterPrefix = isAfterPrefix;
+}
+
+internal void DecodeChunk(split_worker *worker, split_chunk *chunk)
+{
+	memory_arena *outputPool = worker->outputPool;
+	memory_arena *scratchPad = worker->scratchPad;
+
+	//NOTE (Aske): Every instruction is at least one byte, so neither array can have more entries than bytes
+	s64 capacity = (chunk->end - chunk->start) + 1;
+	chunk->labelSpaces = PushPolyArray(scratchPad, chunk->labelSpaces, capacity, label_position);
+	chunk->jumpTargets = PushPolyArray(scratchPad, chunk->jumpTargets, capacity, label_position);
+	chunk->outputPool = outputPool;
+	chunk->poolOffset = outputPool->used;
+
+	decoder_state decoderState = {};
+	decoderState.ScratchPad = scratchPad;
+	decoderState.postPassOffsets = chunk->jumpTargets;
+	decoderState.labelSpaces = chunk->labelSpaces;
+	decoderState.endedWithNewLine = true;
+
+	output_sink nullSink;
+	InitializeOutputSink(&nullSink, OutputSink_null, 0, scratchPad);
+
+	debug_read_file_result file = *worker->split->file;
+	file.CurrentIndex = chunk->start - 1;
+	byte_of_file byteCursor;
+	while (((file.CurrentIndex + 1) < chunk->end) && (byteCursor = GetNextOpsByte(&file)).isValid)
+	{
+		DecodeInstruction(&decoderState, outputPool, &file, byteCursor.byte, &nullSink);
+	}
+
+	chunk->poolSize = outputPool->used - chunk->poolOffset;
+	chunk->isVerified = ((file.CurrentIndex + 1) == chunk->end) && IsDecoderStateClean(&decoderState);
+}
+
+internal PLATFORM_THREAD_PROC(WalkRegionsProc)
+{
+	split_worker *worker = (split_worker *)data;
+	split_decode *split = worker->split;
+	u32 chunkIndex;
+	while (TakeNextWork(split->deques, worker->workerCount, worker->workerIndex, &chunkIndex, &worker->stealCount))
+	{
+		WalkRegionSpeculatively(split, split->chunks + chunkIndex);
+	}
+}
+
+internal PLATFORM_THREAD_PROC(DecodeChunksProc)
+{
+	split_worker *worker = (split_worker *)data;
+	split_decode *split = worker->split;
+	u32 chunkIndex;
+	while (TakeNextWork(split->deques, worker->workerCount, worker->workerIndex, &chunkIndex, &worker->stealCount))
+	{
+		split_chunk *chunk = split->chunks + chunkIndex;
+		if (chunk->start >= 0)
+		{
+			DecodeChunk(worker, chunk);
+		}
+	}
+}
+
+internal void RunSplitPhase(split_worker *workers, s32 workerCount, platform_thread_proc *proc)
+{
+	split_decode *split = workers->split;
+	DistributeWork(split->deques, workerCount, split->chunkCount);
+	for (s32 workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+	{
+		split_worker *worker = workers + workerIndex;
+		b32 isStarted = PlatformStartThread(&worker->thread, proc, worker);
+		Assert(isStarted);
+	}
+	for (s32 workerIndex = 0; workerIndex < workerCount; ++workerIndex)
+	{
+		PlatformJoinThread(&workers[workerIndex].thread);
+	}
+}
+
+//NOTE (Aske): Follows the true instruction boundaries through the regions in order, and picks the start of each chunk
+internal void ReconcileRegions(split_decode *split)
+{
+	u8 *bytes = (u8 *)split->file->Contents;
+	s64 size = split->file->ContentsSize;
+
+	s64 at = 0;
+	b32 isAfterPrefix = false;
+	for (split_chunk *chunk = split->chunks; chunk < split->chunks + split->chunkCount; ++chunk)
+	{
+		chunk->start = -1;
+		while (at < chunk->regionEnd)
+		{
+			if ((chunk->start < 0) && !isAfterPrefix)
+			{
+				chunk->start = at;
+			}
+
+			if ((chunk->start >= 0) && (split->boundaryMarks[at] & BoundaryMark_boundary))
+			{
+				//NOTE (Aske): Converged, the speculative walk is the true one from here on
+				at = chunk->speculativeExit;
+				isAfterPrefix = chunk->isSpeculativeExitAfterPrefix;
+				break;
+			}
+
+			isAfterPrefix = (instructionLengthTable.lengths[bytes[at]] & LengthFlag_Prefix);
+			at += InstructionLengthAt(bytes, at, size);
+		}
+	}
+
+	s64 nextStart = size;
+	for (split_chunk *chunk = split->chunks + split->chunkCount - 1; chunk >= split->chunks; --chunk)
+	{
+		chunk->end = nextStart;
+		if (chunk->start >= 0)
+		{
+			nextStart = chunk->start;
+		}
+	}
+}
+
+internal void AppendDecodedChunk(split_chunk *chunk, memory_arena *outputPool,
+                                 array_label_position *labelSpaces, array_label_position *jumpTargets)
+{
+	s64 poolBase = outputPool->used;
+	u8 *text = (u8 *)PushSize(outputPool, chunk->poolSize);
+	CopySize(chunk->poolSize, chunk->outputPool->base + chunk->poolOffset, text);
+
+	for (s64 i = 0; i < chunk->labelSpaces->count; ++i)
+	{
+		label_position *labelSpace = chunk->labelSpaces->base + i;
+		ArrayLabelSpaceAdd(labelSpaces, labelSpace->byteAddress, (labelSpace->poolOffset - chunk->poolOffset) + poolBase,
+		                   labelSpace->isPrefixPending);
+	}
+	for (s64 i = 0; i < chunk->jumpTargets->count; ++i)
+	{
+		label_position *jumpTarget = chunk->jumpTargets->base + i;
+		ArrayLabelPosAdd(jumpTargets, jumpTarget->byteAddress, jumpTarget->poolOffset);
+	}
+}
+
+//NOTE (Aske): Decodes the whole file into outputPool the same way the serial loop would, and writes the finalized
+//output to sink as it goes. Afterwards file is at its end, and decoderState is where the serial loop would leave it.
+internal void DecodeSplit(split_workers *workers, decoder_state *decoderState, memory_arena *outputPool,
+                          debug_read_file_result *file, output_sink *sink, output_sink *echoSink,
+                          s32 *chunkCount, s32 *redecodedChunkCount)
+{
+	memory_arena *scratchPad = decoderState->ScratchPad;
+	SaveArena(scratchPad);
+
+	split_decode split = {};
+	split.file = file;
+	split.chunkCount = (s32)((file->ContentsSize + SplitRegionSize - 1) / SplitRegionSize);
+	split.chunks = PushArray(scratchPad, split.chunkCount, split_chunk);
+	split.boundaryMarks = PushArray(scratchPad, file->ContentsSize, u8);
+	split.deques = PushArray(scratchPad, workers->count + 1, work_deque);
+	split.deques = (work_deque *)AlignPow2((umm)split.deques, sizeof(work_deque));
+	for (s32 chunkIndex = 0; chunkIndex < split.chunkCount; ++chunkIndex)
+	{
+		split_chunk *chunk = split.chunks + chunkIndex;
+		chunk->regionStart = chunkIndex * SplitRegionSize;
+		chunk->regionEnd = Minimum(chunk->regionStart + SplitRegionSize, file->ContentsSize);
+	}
+
+	split_worker splitWorkers[MaxDecodeWorkers] = {};
+	for (s32 workerIndex = 0; workerIndex < workers->count; ++workerIndex)
+	{
+		split_worker *worker = splitWorkers + workerIndex;
+		worker->workerIndex = workerIndex;
+		worker->workerCount = workers->count;
+		worker->split = &split;
+		worker->outputPool = workers->outputPools[workerIndex];
+		worker->scratchPad = workers->scratchPads[workerIndex];
+		SaveArena(worker->outputPool);
+		SaveArena(worker->scratchPad);
+	}
+
+	RunSplitPhase(splitWorkers, workers->count, WalkRegionsProc);
+	ReconcileRegions(&split);
+	RunSplitPhase(splitWorkers, workers->count, DecodeChunksProc);
+
+	*chunkCount = 0;
+	*redecodedChunkCount = 0;
+	for (split_chunk *chunk = split.chunks; chunk < split.chunks + split.chunkCount; ++chunk)
+	{
+		if (chunk->start < 0)
+		{
+			continue;
+		}
+		++*chunkCount;
+
+		s64 nextIndex = file->CurrentIndex + 1;
+		if ((nextIndex == chunk->start) && chunk->isVerified && IsDecoderStateClean(decoderState))
+		{
+			AppendDecodedChunk(chunk, outputPool, decoderState->labelSpaces, decoderState->postPassOffsets);
+			file->CurrentIndex = chunk->end - 1;
+		}
+		else if (nextIndex < chunk->end)
+		{
+			//NOTE (Aske): Doesn't fit with what came before it, so decode it again from where the output got to
+			++*redecodedChunkCount;
+			byte_of_file byteCursor;
+			while (((file->CurrentIndex + 1) < chunk->end) && (byteCursor = GetNextOpsByte(file)).isValid)
+			{
+				DecodeInstruction(decoderState, outputPool, file, byteCursor.byte, echoSink);
+			}
+		}
+
+		FinalizeOutput(outputPool, decoderState->labelSpaces, decoderState->postPassOffsets,
+		               (file->CurrentIndex + 1) - MaxBackwardJumpDistance, sink, decoderState->indexWriter);
+	}
+
+	for (s32 workerIndex = 0; workerIndex < workers->count; ++workerIndex)
+	{
+		ZeroRestoreArena(splitWorkers[workerIndex].outputPool);
+		ZeroRestoreArena(splitWorkers[workerIndex].scratchPad);
+	}
+	ZeroRestoreArena(scratchPad);
+}
+#endif
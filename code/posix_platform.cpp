@@ -0,0 +1,496 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#pragma region File I/O
+internal void FreeFileMemory(debug_read_file_result *file)
+{
+	if (file->Contents) {
+		munmap(file->Contents, file->ContentsSize + InputGuardSize);
+		file->Contents = 0;
+	}
+}
+
+//NOTE (Aske): The file is mapped read-only instead of copied into a fresh allocation,
+//so Contents points straight at the page cache. The decoder never writes to it.
+//Zeroed anonymous memory is reserved first, with room for the guard bytes, and the file is mapped over its start.
+//The rest of the file's last page reads as zero, and so does the anonymous memory after it.
+internal debug_read_file_result ReadEntireFile(char* filename)
+{
+	debug_read_file_result result = {};
+	result.CurrentIndex = -1;
+
+	int fileHandle = open(filename, O_RDONLY);
+	if (fileHandle != -1) {
+		struct stat fileStat;
+		if ((fstat(fileHandle, &fileStat) == 0) && (fileStat.st_size > 0)) {
+			u64 fileSize = fileStat.st_size;
+			void *reserved = mmap(0, fileSize + InputGuardSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			void *mapped = MAP_FAILED;
+			if (reserved != MAP_FAILED) {
+				mapped = mmap(reserved, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fileHandle, 0);
+				if (mapped == MAP_FAILED) {
+					munmap(reserved, fileSize + InputGuardSize);
+				}
+			}
+			if (mapped != MAP_FAILED) {
+				//NOTE (Aske): Decoding is a single front-to-back pass, so let the kernel read ahead aggressively
+				madvise(mapped, fileSize, MADV_SEQUENTIAL);
+				result.Contents = mapped;
+				result.ContentsSize = fileSize;
+				result.WindowSize = fileSize;
+			}
+		}
+		//NOTE (Aske): The mapping stays valid after the descriptor is closed
+		close(fileHandle);
+	}
+	return result;
+}
+
+internal b32 WriteEntireFile(char* filename, u32 memorySize, void* memory)
+{
+	b32 result = false;
+
+	int fileHandle = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fileHandle != -1) {
+		u8 *at = (u8 *)memory;
+		size_t remaining = memorySize;
+		while (remaining) {
+			ssize_t bytesWritten = write(fileHandle, at, remaining);
+			if (bytesWritten <= 0) {
+				break;
+			}
+			at += bytesWritten;
+			remaining -= bytesWritten;
+		}
+		result = (remaining == 0);
+		close(fileHandle);
+	}
+
+	return result;
+}
+
+internal platform_file PlatformOpenFileForReading(char *filename)
+{
+	platform_file result = {};
+
+	int fileHandle = open(filename, O_RDONLY);
+	if (fileHandle != -1) {
+		struct stat fileStat;
+		if (fstat(fileHandle, &fileStat) == 0) {
+			result.isValid = true;
+			result.size = fileStat.st_size;
+			result.handle = (umm)fileHandle;
+			posix_fadvise(fileHandle, 0, 0, POSIX_FADV_SEQUENTIAL);
+		}
+		else {
+			close(fileHandle);
+		}
+	}
+	return result;
+}
+
+internal platform_file PlatformOpenFileForWriting(char *filename)
+{
+	platform_file result = {};
+
+	int fileHandle = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fileHandle != -1) {
+		result.isValid = true;
+		result.handle = (umm)fileHandle;
+	}
+	return result;
+}
+
+internal u64 PlatformReadFromFile(platform_file *file, void *destination, u64 size)
+{
+	u8 *at = (u8 *)destination;
+	u64 remaining = size;
+	while (file->isValid && remaining) {
+		ssize_t bytesRead = read((int)file->handle, at, remaining);
+		if (bytesRead <= 0) {
+			//NOTE (Aske): 0 is the end of the file
+			break;
+		}
+		at += bytesRead;
+		remaining -= bytesRead;
+	}
+	return (size - remaining);
+}
+
+internal b32 PlatformWriteToFile(platform_file *file, void *source, u64 size)
+{
+	u8 *at = (u8 *)source;
+	u64 remaining = size;
+	while (file->isValid && remaining) {
+		ssize_t bytesWritten = write((int)file->handle, at, remaining);
+		if (bytesWritten <= 0) {
+			file->isValid = false;
+			break;
+		}
+		at += bytesWritten;
+		remaining -= bytesWritten;
+	}
+	return (remaining == 0);
+}
+
+internal b32 PlatformWriteGather(platform_file *file, platform_write_chunk *chunks, u32 chunkCount)
+{
+	struct iovec vectors[8];
+	Assert(chunkCount <= ArrayCount(vectors));
+
+	u32 vectorCount = 0;
+	u64 remaining = 0;
+	for (u32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		if (chunks[chunkIndex].size) {
+			vectors[vectorCount].iov_base = chunks[chunkIndex].data;
+			vectors[vectorCount].iov_len = chunks[chunkIndex].size;
+			remaining += chunks[chunkIndex].size;
+			++vectorCount;
+		}
+	}
+
+	struct iovec *at = vectors;
+	while (file->isValid && remaining) {
+		ssize_t bytesWritten = writev((int)file->handle, at, vectorCount);
+		if (bytesWritten <= 0) {
+			file->isValid = false;
+			break;
+		}
+		remaining -= bytesWritten;
+
+		//NOTE (Aske): Skip past what was written, in case of a partial write
+		while (vectorCount && ((size_t)bytesWritten >= at->iov_len)) {
+			bytesWritten -= at->iov_len;
+			++at;
+			--vectorCount;
+		}
+		if (vectorCount) {
+			at->iov_base = (u8 *)at->iov_base + bytesWritten;
+			at->iov_len -= bytesWritten;
+		}
+	}
+	return (remaining == 0);
+}
+
+internal void PlatformCloseFile(platform_file *file)
+{
+	//NOTE (Aske): Standard output and error aren't ours to close
+	if ((file->isValid || file->handle) && (file->handle != STDOUT_FILENO) && (file->handle != STDERR_FILENO)) {
+		close((int)file->handle);
+	}
+	*file = {};
+}
+
+internal platform_file PlatformGetStandardOutput()
+{
+	platform_file result = {};
+	result.isValid = true;
+	result.handle = STDOUT_FILENO;
+	return result;
+}
+
+internal platform_file PlatformGetStandardError()
+{
+	platform_file result = {};
+	result.isValid = true;
+	result.handle = STDERR_FILENO;
+	return result;
+}
+
+//NOTE (Aske): Counts the entries first, then reads the directory again to fill them in.
+//Files that show up in between are left out.
+internal platform_directory_listing PlatformListDirectory(memory_arena *arena, char *directory)
+{
+	platform_directory_listing result = {};
+
+	DIR *dir = opendir(directory);
+	if (dir) {
+		s32 capacity = 0;
+		while (readdir(dir)) {
+			++capacity;
+		}
+		result.files = PushArray(arena, capacity, platform_file_info);
+
+		rewinddir(dir);
+		struct dirent *entry;
+		while ((result.count < capacity) && (entry = readdir(dir))) {
+			struct stat fileStat;
+			if ((fstatat(dirfd(dir), entry->d_name, &fileStat, 0) == 0) && S_ISREG(fileStat.st_mode)) {
+				platform_file_info *file = result.files + result.count++;
+				s64 nameLength = StringLength(entry->d_name);
+				file->name = (char *)PushSize(arena, nameLength + 1);
+				NaiveSlowCopy(nameLength, entry->d_name, file->name);
+				file->size = fileStat.st_size;
+				file->lastWriteTime = (u64)fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+			}
+		}
+		closedir(dir);
+	}
+	return result;
+}
+
+internal b32 PlatformCreateDirectory(char *path)
+{
+	b32 result = (mkdir(path, 0755) == 0) || (errno == EEXIST);
+	return result;
+}
+
+internal b32 PlatformDeleteFile(char *path)
+{
+	b32 result = (unlink(path) == 0);
+	return result;
+}
+
+internal b32 PlatformRenameFile(char *oldPath, char *newPath)
+{
+	b32 result = (rename(oldPath, newPath) == 0);
+	return result;
+}
+
+internal void PlatformTouchFile(char *path)
+{
+	utimensat(AT_FDCWD, path, 0, 0);
+}
+
+internal b32 PlatformGetFileInfo(char *path, platform_file_info *info)
+{
+	*info = {};
+	struct stat fileStat;
+	b32 result = (stat(path, &fileStat) == 0) && S_ISREG(fileStat.st_mode);
+	if (result) {
+		info->size = fileStat.st_size;
+		info->lastWriteTime = (u64)fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+	}
+	return result;
+}
+#pragma endregion
+
+#pragma region Memory
+internal void* PlatformAllocateMemory(void *baseAddress, size_t size)
+{
+	//NOTE (Aske): Anonymous mappings are auto-zeroed. baseAddress is only a hint here.
+	void *result = mmap(baseAddress, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (result == MAP_FAILED) {
+		result = 0;
+	}
+	return result;
+}
+
+internal void PlatformFreeMemory(void *memory, size_t size)
+{
+	if (memory) {
+		munmap(memory, size);
+	}
+}
+
+#define PosixReservedMapping (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE)
+
+internal void* PlatformReserveMemory(void *baseAddress, size_t size, u32 *memoryFlags)
+{
+	//NOTE (Aske): No access and no swap reservation until committed. Released with PlatformFreeMemory.
+	b32 wantsHugePages = (*memoryFlags & (PlatformMemory_TransparentHugePages | PlatformMemory_HugeTlb));
+	size_t slack = wantsHugePages ? HugePageSize : 0;
+	u8 *mapped = (u8 *)mmap(baseAddress, size + slack, PROT_NONE, PosixReservedMapping, -1, 0);
+	if (mapped == MAP_FAILED) {
+		return 0;
+	}
+
+	u8 *result = mapped;
+	if (wantsHugePages) {
+		//NOTE (Aske): Huge pages need huge page aligned addresses, so trim the slack on both ends
+		result = (u8 *)AlignPow2((umm)mapped, HugePageSize);
+		if (result != mapped) {
+			munmap(mapped, result - mapped);
+		}
+		munmap(result + size, (mapped + slack) - result);
+	}
+
+	if (*memoryFlags & PlatformMemory_TransparentHugePages) {
+		if (madvise(result, size, MADV_HUGEPAGE) != 0) {
+			*memoryFlags &= ~PlatformMemory_TransparentHugePages;
+		}
+	}
+	return result;
+}
+
+internal b32 PlatformCommitMemory(void *address, size_t size, u32 *memoryFlags)
+{
+	if (*memoryFlags & PlatformMemory_HugeTlb) {
+		int populate = (*memoryFlags & PlatformMemory_Prefault) ? MAP_POPULATE : 0;
+		void *mapped = mmap(address, size, PROT_READ | PROT_WRITE,
+		                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB | populate, -1, 0);
+		if (mapped != MAP_FAILED) {
+			return true;
+		}
+		//NOTE (Aske): No huge pages in the pool (see /proc/sys/vm/nr_hugepages), use normal pages from now on.
+		//The failed MAP_FIXED may already have unmapped the range, so it has to be mapped again, not mprotect'ed.
+		*memoryFlags &= ~PlatformMemory_HugeTlb;
+		int prefault = (*memoryFlags & PlatformMemory_Prefault) ? MAP_POPULATE : 0;
+		mapped = mmap(address, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | prefault, -1, 0);
+		return (mapped != MAP_FAILED);
+	}
+
+	if ((*memoryFlags & PlatformMemory_Prefault) && !(*memoryFlags & PlatformMemory_TransparentHugePages)) {
+		//NOTE (Aske): Replaces the reserved range with one that's faulted in up front
+		void *mapped = mmap(address, size, PROT_READ | PROT_WRITE,
+		                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_POPULATE, -1, 0);
+		return (mapped != MAP_FAILED);
+	}
+
+	b32 result = (mprotect(address, size, PROT_READ | PROT_WRITE) == 0);
+	if (result && (*memoryFlags & PlatformMemory_Prefault)) {
+		//NOTE (Aske): A new mapping would lose MADV_HUGEPAGE, so touch the pages instead
+		for (u8 *page = (u8 *)address; page < (u8 *)address + size; page += Kilobytes(4)) {
+			*(volatile u8 *)page = 0;
+		}
+	}
+	return result;
+}
+
+internal void PlatformDecommitMemory(void *address, size_t size, u32 memoryFlags)
+{
+	if (memoryFlags & PlatformMemory_HugeTlb) {
+		//NOTE (Aske): Hands the huge pages back to the pool by replacing the mapping with a reserved one
+		mmap(address, size, PROT_NONE, PosixReservedMapping | MAP_FIXED, -1, 0);
+	}
+	else {
+		//NOTE (Aske): Drops the pages, so they're zeroed if they're ever committed again
+		madvise(address, size, MADV_DONTNEED);
+		mprotect(address, size, PROT_NONE);
+	}
+}
+
+internal platform_page_faults PlatformGetPageFaults()
+{
+	platform_page_faults result = {};
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		result.minor = usage.ru_minflt;
+		result.major = usage.ru_majflt;
+	}
+	return result;
+}
+
+internal f64 PlatformGetWallClockSeconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	f64 result = (f64)now.tv_sec + ((f64)now.tv_nsec / 1000000000.0);
+	return result;
+}
+
+internal void PlatformSleepMilliseconds(u32 milliseconds)
+{
+	struct timespec duration = { milliseconds / 1000, (long)(milliseconds % 1000) * 1000000 };
+	nanosleep(&duration, 0);
+}
+#pragma endregion
+
+#pragma region Threads
+internal void* PosixThreadTrampoline(void *parameter)
+{
+	platform_thread *thread = (platform_thread *)parameter;
+	thread->proc(thread->data);
+	return 0;
+}
+
+internal b32 PlatformStartThread(platform_thread *thread, platform_thread_proc *proc, void *data)
+{
+	thread->proc = proc;
+	thread->data = data;
+	pthread_t handle;
+	thread->isValid = (pthread_create(&handle, 0, PosixThreadTrampoline, thread) == 0);
+	thread->handle = (umm)handle;
+	return thread->isValid;
+}
+
+internal void PlatformJoinThread(platform_thread *thread)
+{
+	if (thread->isValid) {
+		pthread_join((pthread_t)thread->handle, 0);
+		thread->isValid = false;
+	}
+}
+
+internal s32 PlatformGetProcessorCount()
+{
+	long result = sysconf(_SC_NPROCESSORS_ONLN);
+	return (result > 0) ? (s32)result : 1;
+}
+#pragma endregion
+
+#pragma region Sockets
+internal platform_file PlatformListenOnLocalSocket(char *path)
+{
+	platform_file result = {};
+
+	struct sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (StringLength(path) >= (s64)sizeof(address.sun_path)) {
+		return result;
+	}
+	NaiveSlowCopy(StringLength(path), path, address.sun_path);
+
+	//NOTE (Aske): A client that hangs up mid-answer would otherwise kill the whole process on the next write
+	signal(SIGPIPE, SIG_IGN);
+
+	int socketHandle = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (socketHandle != -1) {
+		unlink(path);
+		if ((bind(socketHandle, (struct sockaddr *)&address, sizeof(address)) == 0) &&
+		    (listen(socketHandle, 16) == 0)) {
+			result.isValid = true;
+			result.handle = (umm)socketHandle;
+		}
+		else {
+			close(socketHandle);
+		}
+	}
+	return result;
+}
+
+internal platform_file PlatformAcceptConnection(platform_file *listener)
+{
+	platform_file result = {};
+	int connectionHandle = accept((int)listener->handle, 0, 0);
+	if (connectionHandle != -1) {
+		result.isValid = true;
+		result.handle = (umm)connectionHandle;
+	}
+	return result;
+}
+
+internal b32 PlatformWaitForReadable(platform_file *files, s32 count, b32 *isReadable)
+{
+	struct pollfd polled[64];
+	Assert(count <= (s32)ArrayCount(polled));
+	for (s32 fileIndex = 0; fileIndex < count; ++fileIndex) {
+		polled[fileIndex].fd = (int)files[fileIndex].handle;
+		polled[fileIndex].events = POLLIN;
+		polled[fileIndex].revents = 0;
+	}
+
+	int readyCount;
+	do {
+		readyCount = poll(polled, count, -1);
+	} while ((readyCount == -1) && (errno == EINTR));
+
+	for (s32 fileIndex = 0; fileIndex < count; ++fileIndex) {
+		//NOTE (Aske): A hang-up or an error counts too, so the next read finds out about it
+		isReadable[fileIndex] = (polled[fileIndex].revents != 0);
+	}
+	return (readyCount > 0);
+}
+#pragma endregion
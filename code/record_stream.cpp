@@ -0,0 +1,205 @@
+//NOTE (Aske): -records writes a record stream instead of a listing. It holds the decoded records themselves,
+//for tools that would otherwise parse the listing to get the instructions back.
+//The file is little-endian and made to be memory-mapped, with nothing in it to parse. It's a record_stream_header,
+//then the label table, then the mnemonic names, then a record_stream_entry for every record the decoder made.
+//Each section starts where the header says, 8-byte aligned.
+//The label table is every input offset the listing puts a label at, in ascending order, as u64s.
+//The mnemonic names are RecordStreamNameSize bytes each, zero-padded, indexed by a record's mnemonic.
+//A record's fields mean what they do in decoded_instruction, and prefixes get records of their own like they do
+//there. The enums in decoded_instruction.cpp are part of the format, so changing them means a new version.
+//
+//The labels are found in a first pass that decodes the records without keeping them, so the header can go first
+//and the records can be written out as they're decoded again in the second pass.
+#define RecordStreamMagic 0x43455238 //NOTE (Aske): "8REC"
+#define RecordStreamVersion 1
+#define RecordStreamNameSize 16
+#define RecordStreamNoLabel Uint32Max
+
+enum record_stream_flags
+{
+	RecordStreamFlag_truncated = 0x1, //NOTE (Aske): The input ends in the middle of an instruction, which was left out
+};
+
+struct record_stream_header
+{
+	u32 magic;
+	u32 version;
+	u32 headerSize;
+	u32 recordSize;
+	u64 inputSize;
+	u32 flags;
+	u32 mnemonicCount;
+	u64 labelCount;
+	u64 labelTableOffset;
+	u64 mnemonicTableOffset;
+	u64 recordCount;
+	u64 recordsOffset;
+};
+
+struct record_stream_entry
+{
+	u64 offset;
+	s64 target;
+	u32 targetLabel; //NOTE (Aske): The target's index in the label table, RecordStreamNoLabel when it hasn't got one
+	s16 displacement;
+	s16 immediate;
+	u8 length;
+	u8 opcode;
+	u8 instructionClass;
+	u8 mnemonic;
+	u8 flags;
+	u8 mod;
+	u8 segmentPrefix;
+	u8 repeatPrefix;
+	instruction_operand operand1;
+	instruction_operand operand2;
+	u16 unused;
+};
+
+static_assert(sizeof(record_stream_header) == 72, "The record stream header's layout is part of the format");
+static_assert(sizeof(record_stream_entry) == 40, "The record stream entry's layout is part of the format");
+static_assert(sizeof(mnemonicNames[0].text) == RecordStreamNameSize, "Mnemonic names are written as they're stored");
+
+internal u64 AlignRecordStreamOffset(u64 offset)
+{
+	return (offset + 7) & ~(u64)7;
+}
+
+//NOTE (Aske): Decodes the whole file once, marking every label in isLabelAt. Returns how many records there are.
+internal u64 FindRecordStreamLabels(debug_read_file_result *file, decoder_state *decoderState,
+                                    decoded_instructions *batch, u8 *isLabelAt)
+{
+	u64 result = 0;
+	file->CurrentIndex = -1;
+	b32 isDecoding = true;
+	while (isDecoding)
+	{
+		batch->count = 0;
+		isDecoding = DecodeRecordBatch(decoderState, file, 0, batch, Sint64Max);
+		for (s64 i = 0; i < batch->count; ++i)
+		{
+			if (batch->flags[i] & InstructionFlag_hasLabel)
+			{
+				isLabelAt[batch->target[i]] = 1;
+			}
+		}
+		result += batch->count;
+	}
+	return result;
+}
+
+//NOTE (Aske): The labels are sorted, so a binary search finds the target's index
+internal u32 RecordStreamLabelIndex(u64 *labels, u64 labelCount, s64 target)
+{
+	u64 left = 0;
+	u64 right = labelCount;
+	while (left < right)
+	{
+		u64 mid = left + ((right - left) / 2);
+		if ((s64)labels[mid] < target)
+		{
+			left = mid + 1;
+		}
+		else
+		{
+			right = mid;
+		}
+	}
+	Assert((left < labelCount) && ((s64)labels[left] == target));
+	return (u32)left;
+}
+
+internal void WriteRecordStream(debug_read_file_result *file, memory_arena *scratchPad, decoder_buffers *buffers,
+                                output_sink *outputSink, output_sink *messageSink, decode_file_result *result)
+{
+	SaveArena(scratchPad);
+	decoded_instructions batch = PushDecodedInstructions(scratchPad, DecodeBatchSize);
+	record_stream_entry *entries = PushArray(scratchPad, DecodeBatchSize, record_stream_entry);
+
+	//NOTE (Aske): Messages about odd opcodes are only reported by the second pass, so they show up once
+	decoder_state decoderState = {};
+	decoderState.ScratchPad = scratchPad;
+	decoderState.endedWithNewLine = true;
+	decoderState.instructionCache = buffers->instructionCache;
+	u8 *isLabelAt = PushArray(scratchPad, file->ContentsSize, u8);
+	u64 recordCount = FindRecordStreamLabels(file, &decoderState, &batch, isLabelAt);
+	//NOTE (Aske): Like the listing, there are no labels in a truncated instruction, since it has no record
+	u64 labelEnd = decoderState.isInputTruncated ? decoderState.truncatedOffset : file->ContentsSize;
+
+	u64 *labels = PushArray(scratchPad, file->ContentsSize, u64);
+	u64 labelCount = 0;
+	for (u64 byteIndex = 0; byteIndex < labelEnd; ++byteIndex)
+	{
+		if (isLabelAt[byteIndex])
+		{
+			labels[labelCount++] = byteIndex;
+		}
+	}
+	Assert(labelCount < RecordStreamNoLabel);
+
+	record_stream_header header = {};
+	header.magic = RecordStreamMagic;
+	header.version = RecordStreamVersion;
+	header.headerSize = sizeof(record_stream_header);
+	header.recordSize = sizeof(record_stream_entry);
+	header.inputSize = file->ContentsSize;
+	header.flags = decoderState.isInputTruncated ? RecordStreamFlag_truncated : 0;
+	header.mnemonicCount = Mnemonic_count;
+	header.labelCount = labelCount;
+	header.labelTableOffset = AlignRecordStreamOffset(sizeof(record_stream_header));
+	header.mnemonicTableOffset = AlignRecordStreamOffset(header.labelTableOffset + labelCount * sizeof(u64));
+	header.recordCount = recordCount;
+	header.recordsOffset = AlignRecordStreamOffset(header.mnemonicTableOffset + Mnemonic_count * RecordStreamNameSize);
+
+	SinkWrite(outputSink, &header, sizeof(header));
+	SinkWrite(outputSink, labels, labelCount * sizeof(u64));
+	for (u32 mnemonicIndex = 0; mnemonicIndex < Mnemonic_count; ++mnemonicIndex)
+	{
+		SinkWrite(outputSink, mnemonicNames[mnemonicIndex].text, RecordStreamNameSize);
+	}
+	Assert(outputSink->totalWritten == header.recordsOffset);
+
+	decoderState = {};
+	decoderState.ScratchPad = scratchPad;
+	decoderState.endedWithNewLine = true;
+	decoderState.instructionCache = buffers->instructionCache;
+	decoderState.messageSink = messageSink;
+	file->CurrentIndex = -1;
+	u64 recordsWritten = 0;
+	b32 isDecoding = true;
+	while (isDecoding)
+	{
+		batch.count = 0;
+		isDecoding = DecodeRecordBatch(&decoderState, file, 0, &batch, Sint64Max);
+		for (s64 i = 0; i < batch.count; ++i)
+		{
+			decoded_instruction decoded = GetDecodedInstruction(&batch, i);
+			record_stream_entry *entry = entries + i;
+			entry->offset = decoded.offset;
+			entry->target = decoded.target;
+			b32 hasLabel = (decoded.flags & InstructionFlag_hasLabel) && ((u64)decoded.target < labelEnd);
+			entry->targetLabel = hasLabel ? RecordStreamLabelIndex(labels, labelCount, decoded.target) :
+			                                RecordStreamNoLabel;
+			entry->displacement = decoded.displacement;
+			entry->immediate = decoded.immediate;
+			entry->length = decoded.length;
+			entry->opcode = decoded.opcode;
+			entry->instructionClass = decoded.instructionClass;
+			entry->mnemonic = decoded.mnemonic;
+			entry->flags = decoded.flags;
+			entry->mod = decoded.mod;
+			entry->segmentPrefix = decoded.segmentPrefix;
+			entry->repeatPrefix = decoded.repeatPrefix;
+			entry->operand1 = decoded.operand1;
+			entry->operand2 = decoded.operand2;
+			entry->unused = 0;
+		}
+		SinkWrite(outputSink, entries, batch.count * sizeof(record_stream_entry));
+		recordsWritten += batch.count;
+	}
+	Assert(recordsWritten == recordCount);
+
+	result->bytesDecoded = file->ContentsSize;
+	result->isInputTruncated = decoderState.isInputTruncated;
+	ZeroRestoreArena(scratchPad);
+}
@@ -0,0 +1,346 @@
+//NOTE (Aske): -resultcache:dir keeps every listing that's written in dir, named after a hash of what the listing
+//depends on: the input bytes, the input's file name (it's in the comment at the top), ResultCacheVersion and the
+//label build flags. Decoding an input that has been decoded before is then just a copy of its stored listing.
+//A listing is written to a temporary file while it's decoded, and renamed into place once it's complete,
+//so the cache only ever has whole listings in it, even with several processes sharing it.
+//A thread evicts the least recently used listings while the decoding goes on, to keep the cache within its budget.
+
+//NOTE (Aske): Bump whenever the listing for the same input changes
+#define ResultCacheVersion 1
+#define DefaultResultCacheBudget Megabytes(1024)
+//NOTE (Aske): Evicting goes down to 7/8 of the budget, so it isn't needed again right away
+#define ResultCacheLowWatermark(budget) ((budget) - ((budget) / 8))
+//NOTE (Aske): How often the eviction thread checks whether it's stopping or has anything to do
+#define ResultCacheEvictionPollMilliseconds 10
+
+#if LABEL_FIRST_PASS
+#define ResultCacheBuildFlags (0x100 | LABEL_PADDING)
+#else
+#define ResultCacheBuildFlags LABEL_PADDING
+#endif
+
+struct result_cache
+{
+	char *directory;
+	u64 budget;
+	u64 temporaryNonce; //NOTE (Aske): Keeps other processes' temporary files apart from ours
+
+	//NOTE (Aske): Updated by every worker
+	volatile u64 temporaryCount;
+	volatile u64 bytesAdded; //NOTE (Aske): Since the last eviction pass
+	volatile u64 hitCount;
+	volatile u64 storedCount;
+
+	//NOTE (Aske): Only touched by the eviction thread
+	memory_arena *scratchPad;
+	u64 evictedCount;
+	u64 evictedBytes;
+
+	volatile u64 isStopping;
+	platform_thread evictor;
+};
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Hashing
+//-------------------------------------------------------------------------
+
+#define ContentHashPrime1 0x9E3779B185EBCA87ull
+#define ContentHashPrime2 0xC2B2AE3D27D4EB4Full
+#define ContentHashPrime3 0x165667B19E3779F9ull
+
+internal u64 RotateLeftU64(u64 value, u32 count)
+{
+	u64 result = (value << count) | (value >> (64 - count));
+	return result;
+}
+
+internal u64 ContentHashRound(u64 lane, u64 value)
+{
+	lane += value * ContentHashPrime2;
+	lane = RotateLeftU64(lane, 31);
+	lane *= ContentHashPrime1;
+	return lane;
+}
+
+//NOTE (Aske): Four independent lanes over 32 bytes at a time, so the multiplies overlap, then the tail 8 bytes
+//and then 1 byte at a time. It's not a cryptographic hash, just fast and well mixed.
+internal u64 ContentHash(u8 *bytes, u64 size, u64 seed)
+{
+	u64 lanes[4] =
+	{
+		seed + ContentHashPrime1 + ContentHashPrime2, seed + ContentHashPrime2, seed, seed - ContentHashPrime1,
+	};
+	u8 *at = bytes;
+	u8 *end = bytes + size;
+	for (; (end - at) >= 32; at += 32)
+	{
+		lanes[0] = ContentHashRound(lanes[0], *(u64 *)(at + 0));
+		lanes[1] = ContentHashRound(lanes[1], *(u64 *)(at + 8));
+		lanes[2] = ContentHashRound(lanes[2], *(u64 *)(at + 16));
+		lanes[3] = ContentHashRound(lanes[3], *(u64 *)(at + 24));
+	}
+
+	u64 result = RotateLeftU64(lanes[0], 1) + RotateLeftU64(lanes[1], 7) +
+	             RotateLeftU64(lanes[2], 12) + RotateLeftU64(lanes[3], 18);
+	result += size;
+	for (; (end - at) >= 8; at += 8)
+	{
+		result ^= ContentHashRound(0, *(u64 *)at);
+		result = RotateLeftU64(result, 27) * ContentHashPrime1 + ContentHashPrime3;
+	}
+	for (; at < end; ++at)
+	{
+		result ^= (*at) * ContentHashPrime3;
+		result = RotateLeftU64(result, 11) * ContentHashPrime1;
+	}
+
+	result ^= result >> 33;
+	result *= ContentHashPrime2;
+	result ^= result >> 29;
+	result *= ContentHashPrime3;
+	result ^= result >> 32;
+	return result;
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Storing and finding listings
+//-------------------------------------------------------------------------
+
+struct result_cache_entry
+{
+	b32 isStoring;
+	char *path;
+	char *temporaryPath;
+};
+
+//NOTE (Aske): Only the part after the last slash goes in the listing, so only that part is in the key
+internal char* SourceFileName(char *sourceName)
+{
+	char *result = sourceName;
+	for (char *at = sourceName; *at; ++at)
+	{
+		if ((*at == '/') || (*at == '\\'))
+		{
+			result = at + 1;
+		}
+	}
+	return result;
+}
+
+internal result_cache_entry ResultCacheEntryFor(result_cache *cache, memory_arena *arena,
+                                                debug_read_file_result *file, char *sourceName)
+{
+	u64 seed = ((u64)ResultCacheVersion << 32) | ResultCacheBuildFlags;
+	char *fileName = SourceFileName(sourceName);
+	u64 nameHash = ContentHash((u8 *)fileName, StringLength(fileName), seed);
+	u64 key = ContentHash((u8 *)file->Contents, file->ContentsSize, nameHash);
+
+	result_cache_entry result = {};
+	size_t pathSize = StringLength(cache->directory) + 80;
+	result.path = (char *)PushSize(arena, pathSize);
+	FormatString(pathSize, result.path, "%s/%016llx-%llu.asm", cache->directory,
+	             (unsigned long long)key, (unsigned long long)file->ContentsSize);
+
+	u64 temporaryIndex = AtomicAddU64(&cache->temporaryCount, 1);
+	result.temporaryPath = (char *)PushSize(arena, pathSize + 40);
+	FormatString(pathSize + 40, result.temporaryPath, "%s.%016llx-%llu.tmp", result.path,
+	             (unsigned long long)cache->temporaryNonce, (unsigned long long)temporaryIndex);
+	return result;
+}
+
+//NOTE (Aske): On a hit, the stored listing is written to the sinks, and becomes the most recently used one
+internal b32 CopyCachedListing(result_cache *cache, result_cache_entry *entry,
+                               output_sink *outputSink, output_sink *echoSink)
+{
+	debug_read_file_result listing = ReadEntireFile(entry->path);
+	if (!listing.Contents)
+	{
+		return false;
+	}
+	SinkWrite(outputSink, listing.Contents, listing.ContentsSize);
+	SinkWrite(echoSink, listing.Contents, listing.ContentsSize);
+	FreeFileMemory(&listing);
+
+	PlatformTouchFile(entry->path);
+	AtomicAddU64(&cache->hitCount, 1);
+	return true;
+}
+
+//NOTE (Aske): Everything written to outputSink from here on also goes to the temporary file
+internal void BeginStoringListing(result_cache_entry *entry, output_sink *outputSink)
+{
+	outputSink->copy = PlatformOpenFileForWriting(entry->temporaryPath);
+	entry->isStoring = outputSink->copy.isValid;
+}
+
+//NOTE (Aske): Has to come before outputSink is closed. The listing is only stored if all of it made it to the file.
+internal void FinishStoringListing(result_cache *cache, result_cache_entry *entry, output_sink *outputSink,
+                                   b32 isListingUsable)
+{
+	if (!entry->isStoring)
+	{
+		return;
+	}
+
+	SinkFlush(outputSink);
+	b32 isStored = outputSink->copy.isValid && isListingUsable;
+	PlatformCloseFile(&outputSink->copy);
+	isStored = isStored && PlatformRenameFile(entry->temporaryPath, entry->path);
+	if (isStored)
+	{
+		AtomicAddU64(&cache->bytesAdded, outputSink->totalWritten);
+		AtomicAddU64(&cache->storedCount, 1);
+	}
+	else
+	{
+		PlatformDeleteFile(entry->temporaryPath);
+	}
+}
+
+//-------------------------------------------------------------------------
+//NOTE (Aske): Eviction
+//-------------------------------------------------------------------------
+
+internal b32 IsHexDigit(char c)
+{
+	b32 result = ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'f'));
+	return result;
+}
+
+//NOTE (Aske): Anything else in the directory is left alone. Temporary files count against the budget too,
+//so the ones left behind by a crash get evicted eventually. The ones being written are the newest.
+internal b32 IsResultCacheFileName(char *name)
+{
+	b32 result = true;
+	for (s32 i = 0; i < 16; ++i)
+	{
+		result = result && IsHexDigit(name[i]);
+	}
+	result = result && (name[16] == '-');
+	return result;
+}
+
+//NOTE (Aske): Bottom-up merge sort, oldest first. scratch has room for count entries.
+internal void SortFilesByLastWrite(platform_file_info *files, s32 count, platform_file_info *scratch)
+{
+	platform_file_info *from = files;
+	platform_file_info *to = scratch;
+	for (s32 width = 1; width < count; width *= 2)
+	{
+		for (s32 start = 0; start < count; start += 2 * width)
+		{
+			s32 middle = Minimum(start + width, count);
+			s32 end = Minimum(start + 2 * width, count);
+			s32 left = start;
+			s32 right = middle;
+			for (s32 at = start; at < end; ++at)
+			{
+				if ((left < middle) && ((right >= end) || (from[left].lastWriteTime <= from[right].lastWriteTime)))
+				{
+					to[at] = from[left++];
+				}
+				else
+				{
+					to[at] = from[right++];
+				}
+			}
+		}
+		platform_file_info *swap = from;
+		from = to;
+		to = swap;
+	}
+	if (from != files)
+	{
+		for (s32 i = 0; i < count; ++i)
+		{
+			files[i] = from[i];
+		}
+	}
+}
+
+internal void EvictResultCache(result_cache *cache)
+{
+	memory_arena *scratchPad = cache->scratchPad;
+	SaveArena(scratchPad);
+
+	platform_directory_listing listing = PlatformListDirectory(scratchPad, cache->directory);
+	s32 cacheFileCount = 0;
+	u64 totalSize = 0;
+	for (s32 i = 0; i < listing.count; ++i)
+	{
+		if (IsResultCacheFileName(listing.files[i].name))
+		{
+			listing.files[cacheFileCount++] = listing.files[i];
+			totalSize += listing.files[i].size;
+		}
+	}
+
+	if (totalSize > cache->budget)
+	{
+		platform_file_info *sortScratch = PushArray(scratchPad, cacheFileCount, platform_file_info);
+		SortFilesByLastWrite(listing.files, cacheFileCount, sortScratch);
+
+		size_t pathSize = StringLength(cache->directory) + 128;
+		char *path = (char *)PushSize(scratchPad, pathSize);
+		u64 targetSize = ResultCacheLowWatermark(cache->budget);
+		for (s32 i = 0; (i < cacheFileCount) && (totalSize > targetSize); ++i)
+		{
+			FormatString(pathSize, path, "%s/%s", cache->directory, listing.files[i].name);
+			if (PlatformDeleteFile(path))
+			{
+				totalSize -= listing.files[i].size;
+				cache->evictedBytes += listing.files[i].size;
+				++cache->evictedCount;
+			}
+		}
+	}
+
+	ZeroRestoreArena(scratchPad);
+}
+
+//NOTE (Aske): One pass when it starts, then another whenever an eighth of the budget has been added,
+//and a last one once decoding is done
+internal PLATFORM_THREAD_PROC(ResultCacheEvictionProc)
+{
+	result_cache *cache = (result_cache *)data;
+	b32 isFirstPass = true;
+	b32 isRunning = true;
+	while (isRunning)
+	{
+		isRunning = !AtomicLoadU64(&cache->isStopping);
+		u64 bytesAdded = AtomicLoadU64(&cache->bytesAdded);
+		if (isFirstPass || !isRunning || (bytesAdded >= (cache->budget / 8)))
+		{
+			AtomicAddU64(&cache->bytesAdded, (u64)0 - bytesAdded);
+			EvictResultCache(cache);
+			isFirstPass = false;
+		}
+		if (isRunning)
+		{
+			PlatformSleepMilliseconds(ResultCacheEvictionPollMilliseconds);
+		}
+	}
+}
+
+//NOTE (Aske): scratchPad is the eviction thread's own
+internal b32 StartResultCache(result_cache *cache, char *directory, u64 budget, memory_arena *scratchPad)
+{
+	*cache = {};
+	cache->directory = directory;
+	cache->budget = budget;
+	cache->temporaryNonce = (u64)(PlatformGetWallClockSeconds() * 1000000000.0) ^ (u64)(umm)cache;
+	if (!PlatformCreateDirectory(directory))
+	{
+		return false;
+	}
+
+	cache->scratchPad = scratchPad;
+	b32 result = PlatformStartThread(&cache->evictor, ResultCacheEvictionProc, cache);
+	return result;
+}
+
+internal void StopResultCache(result_cache *cache)
+{
+	AtomicAddU64(&cache->isStopping, 1);
+	PlatformJoinThread(&cache->evictor);
+}
@@ -74,6 +74,35 @@ internal s64 StringLength(char *toEvaluate)
 	return result;
 }
 
+internal b32 StringsAreEqual(char *a, char *b)
+{
+	while (*a && (*a == *b))
+	{
+		++a;
+		++b;
+	}
+	return (*a == *b);
+}
+
+internal b32 StringStartsWith(char *str, char *prefix)
+{
+	while (*prefix)
+	{
+		if (*str++ != *prefix++)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+internal b32 StringEndsWith(char *str, char *suffix)
+{
+	s64 strLength = StringLength(str);
+	s64 suffixLength = StringLength(suffix);
+	return (strLength >= suffixLength) && StringsAreEqual(str + strLength - suffixLength, suffix);
+}
+
 internal b32 StringLastIndexOf(char *str, size_t length, char c, size_t *result)
 {
 	char *current = str + (length);
@@ -146,13 +175,15 @@ inline void OutChar(format_cursor *dest, char value)
 	}
 }
 
+//NOTE (Aske): Variadic arguments smaller than int are promoted by the caller,
+//so they have to be read back as the promoted type and truncated.
 inline u64 ReadVarArgUnsignedInteger(u32 length, va_list *argList)
 {
 	u64 result = 0;
 	switch (length)
 	{
-		case 1: { result = va_arg(*argList, u8); } break;
-		case 2: { result = va_arg(*argList, u16); } break;
+		case 1: { result = (u8)va_arg(*argList, u32); } break;
+		case 2: { result = (u16)va_arg(*argList, u32); } break;
 		case 4: { result = va_arg(*argList, u32); } break;
 		case 8: { result = va_arg(*argList, u64); } break;
 		InvalidDefaultCase;
@@ -166,8 +197,8 @@ inline s64 ReadVarArgSignedInteger(u32 length, va_list *argList)
 	s64 result = 0;
 	switch (length)
 	{
-		case 1: { result = va_arg(*argList, s8); } break;
-		case 2: { result = va_arg(*argList, s16); } break;
+		case 1: { result = (s8)va_arg(*argList, s32); } break;
+		case 2: { result = (s16)va_arg(*argList, s32); } break;
 		case 4: { result = va_arg(*argList, s32); } break;
 		case 8: { result = va_arg(*argList, s64); } break;
 		InvalidDefaultCase;
@@ -180,7 +211,7 @@ inline f64 ReadVarArgFloat(u32 length, va_list *argList)
 	u64 result = 0;
 	switch (length)
 	{
-		case 4: { result = va_arg(*argList, f32); } break;
+		case 4: { result = (f32)va_arg(*argList, f64); } break;
 		case 8: { result = va_arg(*argList, f64); } break;
 		InvalidDefaultCase;
 	}
@@ -211,6 +242,67 @@ internal void U64ToAscii(format_cursor *dest, u64 value, u32 numBase, char* digi
 	}
 }
 
+//NOTE (Aske): Every pair of decimal digits, "00" to "99"
+global_variable char decimalDigitPairs[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+//NOTE (Aske): U64ToAscii for base 10, two digits per division instead of one. The digits are written
+//from the back of a buffer, so they come out in order, and are copied to dest in one go.
+internal void U64ToDecimal(format_cursor *dest, u64 value)
+{
+	char digits[20]; //NOTE (Aske): Uint64Max has 20 digits
+	char *end = digits + sizeof(digits);
+	char *at = end;
+	while (value >= 100)
+	{
+		u32 pairIndex = (u32)(value % 100) * 2;
+		value /= 100;
+		at -= 2;
+		at[0] = decimalDigitPairs[pairIndex];
+		at[1] = decimalDigitPairs[pairIndex + 1];
+	}
+	if (value >= 10)
+	{
+		at -= 2;
+		at[0] = decimalDigitPairs[value * 2];
+		at[1] = decimalDigitPairs[value * 2 + 1];
+	}
+	else
+	{
+		*--at = (char)('0' + value);
+	}
+
+	for (; at < end; ++at)
+	{
+		OutChar(dest, *at);
+	}
+}
+
+//NOTE (Aske): U64ToAscii for base 16, without a table or a branch per digit.
+//A nibble over 9 makes (9 - nibble) negative, and its sign bits mask in the distance from '9' + 1 to 'a' (or 'A').
+internal void U64ToHex(format_cursor *dest, u64 value, b32 isUpperCase)
+{
+	char digits[16];
+	char *end = digits + sizeof(digits);
+	char *at = end;
+	u32 letterOffset = (isUpperCase ? 'A' : 'a') - '0' - 10;
+	do
+	{
+		u32 nibble = (u32)(value & 0xF);
+		u32 letterMask = (u32)((s32)(9 - nibble) >> 31);
+		*--at = (char)('0' + nibble + (letterMask & letterOffset));
+		value >>= 4;
+	}
+	while (value != 0);
+
+	for (; at < end; ++at)
+	{
+		OutChar(dest, *at);
+	}
+}
+
 internal void F64ToAscii(format_cursor *dest, u64 value, f32 numBase, char* digits, u32 precision)
 {
 	if (value < 0)
@@ -236,12 +328,17 @@ internal void F64ToAscii(format_cursor *dest, u64 value, f32 numBase, char* digi
 
 //NOTE (Aske): Result doesn't include null ternimator.
 //Currently has slow support for strings; crude support for floats, j, z and t; and doesn't support UTF16. Otherwise follows sprintf specs, except for the addition of the %S specifier for length-prefixed strings
-internal umm FormatStringList(size_t destSize, char* destInit, char *format, va_list argList)
+internal umm FormatStringList(size_t destSize, char* destInit, const char *format, va_list argListInit)
 {
+	//NOTE (Aske): va_list may be an array type (e.g. System V x64), which decays to a pointer
+	//as a parameter. Copy it into a local so &argList has the same type on every platform.
+	va_list argList;
+	va_copy(argList, argListInit);
+
 	format_cursor output = { destSize, destInit };
 	if (output.sizeRemaining)
 	{
-		char *at = format;
+		char *at = (char *)format;
 		while (at[0])
 		{
 			if (*at == '%')
@@ -327,17 +424,17 @@ internal umm FormatStringList(size_t destSize, char* destInit, char *format, va_
 					integerLength = 2;
 					at += 1;
 				}
+				else if ((at[0] == 'l') && (at[1] == 'l'))
+				{
+					integerLength = 8;
+					at += 2;
+				}
 				else if (at[0] == 'l')
 				{
 					integerLength = 4;
 					charLength = 2;
 					at += 1;
 				}
-				else if ((at[0] == 'l') && (at[1] == 'l'))
-				{
-					integerLength = 8;
-					at += 2;
-				}
 				else if (at[0] == 'j') //TODO (Aske): Handle "max supported"
 				{
 					integerLength = 8;
@@ -382,7 +479,7 @@ internal umm FormatStringList(size_t destSize, char* destInit, char *format, va_
 						{
 							value = -value;
 						}
-						U64ToAscii(&processingCursor, (u64)value, 10, decChars);
+						U64ToDecimal(&processingCursor, (u64)value);
 
 						if (wasNegative)
 						{
@@ -402,7 +499,7 @@ internal umm FormatStringList(size_t destSize, char* destInit, char *format, va_
 					case 'u': //unsigned int
 					{
 						u64 value = ReadVarArgUnsignedInteger(integerLength, &argList);
-						U64ToAscii(&processingCursor, value, 10, decChars);
+						U64ToDecimal(&processingCursor, value);
 					} break; 
 
 					case 'o': //unsigned octal
@@ -418,7 +515,7 @@ internal umm FormatStringList(size_t destSize, char* destInit, char *format, va_
 					case 'x': //unsigned hexadecimal int
 					{
 						u64 value = ReadVarArgUnsignedInteger(integerLength, &argList);
-						U64ToAscii(&processingCursor, value, 16, lowerHexChars);
+						U64ToHex(&processingCursor, value, false);
 						if (annotateIfNotZero && value != 0) {
 							prefix = "0x";
 						}
@@ -427,7 +524,7 @@ internal umm FormatStringList(size_t destSize, char* destInit, char *format, va_
 					case 'X': //unsigned hexadecimal int (uppercase)
 					{
 						u64 value = ReadVarArgUnsignedInteger(integerLength, &argList);
-						U64ToAscii(&processingCursor, value, 16, upperHexChars);
+						U64ToHex(&processingCursor, value, true);
 						if (annotateIfNotZero && value != 0)
 						{
 							prefix = "0X";
@@ -621,11 +718,13 @@ internal umm FormatStringList(size_t destSize, char* destInit, char *format, va_
 		}
 	}
 	
+	va_end(argList);
+
 	umm outputSizeExclTerminator = output.at - destInit;
 	return outputSizeExclTerminator;
 }
 
-internal size_t FormatString(size_t destSize, char* dest, char *format, ...)
+internal size_t FormatString(size_t destSize, char* dest, const char *format, ...)
 {
 	va_list argList;
 
@@ -635,7 +734,7 @@ internal size_t FormatString(size_t destSize, char* dest, char *format, ...)
 	return result;
 }
 
-internal size_t FormatStringBufferFromBase(string_buffer *buffer, char *format, ...)
+internal size_t FormatStringBufferFromBase(string_buffer *buffer, const char *format, ...)
 {
 	va_list argList;
 
@@ -647,7 +746,7 @@ internal size_t FormatStringBufferFromBase(string_buffer *buffer, char *format,
 	return result;
 }
 
-internal size_t FormatStringBufferFromOffset(string_buffer *buffer, s64 offset, char *format, ...)
+internal size_t FormatStringBufferFromOffset(string_buffer *buffer, s64 offset, const char *format, ...)
 {
 	va_list argList;
 
@@ -657,4 +756,96 @@ internal size_t FormatStringBufferFromOffset(string_buffer *buffer, s64 offset,
 	
 	buffer->count += result;
 	return result;
-}
\ No newline at end of file
+}
+//-------------------------------------------------------------------------
+//NOTE (Aske): Fixed-shape emitters
+//-------------------------------------------------------------------------
+//NOTE (Aske): Every line of a listing has one of a dozen shapes, like "%s %s, %s\n".
+//FormatStringList parses the format, its flags and its va_args for every one of them,
+//so the renderer spells out each shape with these instead, which the compiler can inline.
+//They write to a format_cursor like FormatStringList does, and stop the same way when it runs out.
+
+inline void EmitString(format_cursor *dest, char *source, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		OutChar(dest, source[i]);
+	}
+}
+
+inline void EmitCString(format_cursor *dest, char *source)
+{
+	while (*source)
+	{
+		OutChar(dest, *source++);
+	}
+}
+
+//NOTE (Aske): Text that's known up front, with its length, zero-padded to a fixed size
+//so it's emitted with two wide stores instead of a loop that looks for the terminator.
+//The padding keeps it null-terminated too, so text can still be passed to %s.
+struct short_text
+{
+	union
+	{
+		char text[16];
+		u64 wide[2];
+	};
+	u32 length;
+};
+#define ShortText(literal) { { literal }, sizeof(literal) - 1 }
+
+//NOTE (Aske): Stores all of text, padding and all, when there's room. The padding past length
+//is written over by whatever comes next, or ends up past the end of what was emitted.
+inline void EmitShortText(format_cursor *dest, short_text *text)
+{
+	if (dest->sizeRemaining >= sizeof(text->text))
+	{
+		u64 *wideDest = (u64 *)dest->at;
+		wideDest[0] = text->wide[0];
+		wideDest[1] = text->wide[1];
+		dest->at += text->length;
+		dest->sizeRemaining -= text->length;
+	}
+	else
+	{
+		EmitString(dest, text->text, text->length);
+	}
+}
+
+//NOTE (Aske): %u
+inline void EmitUnsigned(format_cursor *dest, u64 value)
+{
+	U64ToDecimal(dest, value);
+}
+
+//NOTE (Aske): %d, or %+d with forceSign
+inline void EmitSigned(format_cursor *dest, s64 value, b32 forceSign)
+{
+	u64 magnitude = (u64)value;
+	if (value < 0)
+	{
+		OutChar(dest, '-');
+		magnitude = (u64)0 - magnitude;
+	}
+	else if (forceSign)
+	{
+		OutChar(dest, '+');
+	}
+	EmitUnsigned(dest, magnitude);
+}
+
+//NOTE (Aske): Null-terminates what was emitted since start, and returns its length without the terminator.
+//When the cursor ran out, the last character gives way for the terminator.
+inline size_t EndEmitting(format_cursor *dest, char *start)
+{
+	if (dest->sizeRemaining)
+	{
+		dest->at[0] = 0;
+	}
+	else if (dest->at > start)
+	{
+		*--dest->at = 0;
+	}
+	return (size_t)(dest->at - start);
+}
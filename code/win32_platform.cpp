@@ -0,0 +1,368 @@
+#include <Windows.h>
+#include <psapi.h>
+
+#pragma region File I/O
+internal void FreeFileMemory(debug_read_file_result *file)
+{
+	if (file->Contents) {
+		VirtualFree(file->Contents, 0, MEM_RELEASE);
+		file->Contents = 0;
+	}
+}
+
+internal debug_read_file_result ReadEntireFile(char* filename)
+{
+	debug_read_file_result result = {};
+	result.CurrentIndex = -1;
+
+	HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(fileHandle, &fileSize)) {
+			u32 fileSize32 = SafeTruncateUInt64(fileSize.QuadPart);
+			//NOTE (aske): VirtualAlloc zeroes the guard bytes after the file
+			result.Contents = VirtualAlloc(0, fileSize32 + InputGuardSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			if (result.Contents) {
+				DWORD bytesRead;
+				if (ReadFile(fileHandle, result.Contents, fileSize32, &bytesRead, 0) && (fileSize32 == bytesRead)) {
+					//NOTE(aske): File read successfully
+					result.ContentsSize = fileSize32;
+					result.WindowSize = fileSize32;
+				}
+				else {
+					FreeFileMemory(&result);
+				}
+			}
+		}
+		CloseHandle(fileHandle);
+	}
+	return result;
+}
+
+internal b32 WriteEntireFile(char* filename, u32 memorySize, void* memory)
+{
+	b32 result = false;
+
+	HANDLE fileHandle = CreateFileA(filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		DWORD bytesWritten;
+		if (WriteFile(fileHandle, memory, memorySize, &bytesWritten, 0)) {
+			//NOTE (aske): File read successfully
+			result = (bytesWritten == memorySize);
+		}
+		CloseHandle(fileHandle);
+	}
+
+	return result;
+}
+
+internal platform_file PlatformOpenFileForReading(char *filename)
+{
+	platform_file result = {};
+
+	HANDLE fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+	                                FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(fileHandle, &fileSize)) {
+			result.isValid = true;
+			result.size = fileSize.QuadPart;
+			result.handle = (umm)fileHandle;
+		}
+		else {
+			CloseHandle(fileHandle);
+		}
+	}
+	return result;
+}
+
+internal platform_file PlatformOpenFileForWriting(char *filename)
+{
+	platform_file result = {};
+
+	HANDLE fileHandle = CreateFileA(filename, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		result.isValid = true;
+		result.handle = (umm)fileHandle;
+	}
+	return result;
+}
+
+internal u64 PlatformReadFromFile(platform_file *file, void *destination, u64 size)
+{
+	u8 *at = (u8 *)destination;
+	u64 remaining = size;
+	while (file->isValid && remaining) {
+		DWORD bytesRead;
+		DWORD toRead = (DWORD)Minimum(remaining, Megabytes(64));
+		if (!ReadFile((HANDLE)file->handle, at, toRead, &bytesRead, 0) || (bytesRead == 0)) {
+			//NOTE (aske): 0 bytes read is the end of the file
+			break;
+		}
+		at += bytesRead;
+		remaining -= bytesRead;
+	}
+	return (size - remaining);
+}
+
+internal b32 PlatformWriteToFile(platform_file *file, void *source, u64 size)
+{
+	u8 *at = (u8 *)source;
+	u64 remaining = size;
+	while (file->isValid && remaining) {
+		DWORD bytesWritten;
+		DWORD toWrite = (DWORD)Minimum(remaining, Megabytes(64));
+		if (!WriteFile((HANDLE)file->handle, at, toWrite, &bytesWritten, 0) || (bytesWritten == 0)) {
+			file->isValid = false;
+			break;
+		}
+		at += bytesWritten;
+		remaining -= bytesWritten;
+	}
+	return (remaining == 0);
+}
+
+internal b32 PlatformWriteGather(platform_file *file, platform_write_chunk *chunks, u32 chunkCount)
+{
+	b32 result = true;
+	for (u32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		result = PlatformWriteToFile(file, chunks[chunkIndex].data, chunks[chunkIndex].size) && result;
+	}
+	return result;
+}
+
+internal void PlatformCloseFile(platform_file *file)
+{
+	//NOTE (aske): Standard output and error aren't ours to close
+	if (file->handle && ((HANDLE)file->handle != GetStdHandle(STD_OUTPUT_HANDLE)) &&
+	    ((HANDLE)file->handle != GetStdHandle(STD_ERROR_HANDLE))) {
+		CloseHandle((HANDLE)file->handle);
+	}
+	*file = {};
+}
+
+internal platform_file PlatformGetStandardOutput()
+{
+	platform_file result = {};
+	HANDLE outputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (outputHandle && (outputHandle != INVALID_HANDLE_VALUE)) {
+		result.isValid = true;
+		result.handle = (umm)outputHandle;
+	}
+	return result;
+}
+
+internal platform_file PlatformGetStandardError()
+{
+	platform_file result = {};
+	HANDLE errorHandle = GetStdHandle(STD_ERROR_HANDLE);
+	if (errorHandle && (errorHandle != INVALID_HANDLE_VALUE)) {
+		result.isValid = true;
+		result.handle = (umm)errorHandle;
+	}
+	return result;
+}
+
+//NOTE (aske): Counts the entries first, then goes through the directory again to fill them in.
+//Files that show up in between are left out.
+internal platform_directory_listing PlatformListDirectory(memory_arena *arena, char *directory)
+{
+	platform_directory_listing result = {};
+
+	char pattern[MAX_PATH];
+	FormatString(sizeof(pattern), pattern, "%s\\*", directory);
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA(pattern, &findData);
+	if (findHandle != INVALID_HANDLE_VALUE) {
+		s32 capacity = 0;
+		do {
+			++capacity;
+		} while (FindNextFileA(findHandle, &findData));
+		FindClose(findHandle);
+		result.files = PushArray(arena, capacity, platform_file_info);
+
+		findHandle = FindFirstFileA(pattern, &findData);
+		if (findHandle != INVALID_HANDLE_VALUE) {
+			do {
+				if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+					platform_file_info *file = result.files + result.count++;
+					s64 nameLength = StringLength(findData.cFileName);
+					file->name = (char *)PushSize(arena, nameLength + 1);
+					NaiveSlowCopy(nameLength, findData.cFileName, file->name);
+					file->size = ((u64)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+					file->lastWriteTime = ((u64)findData.ftLastWriteTime.dwHighDateTime << 32) |
+					                      findData.ftLastWriteTime.dwLowDateTime;
+				}
+			} while ((result.count < capacity) && FindNextFileA(findHandle, &findData));
+			FindClose(findHandle);
+		}
+	}
+	return result;
+}
+
+internal b32 PlatformCreateDirectory(char *path)
+{
+	b32 result = CreateDirectoryA(path, 0) || (GetLastError() == ERROR_ALREADY_EXISTS);
+	return result;
+}
+
+internal b32 PlatformDeleteFile(char *path)
+{
+	b32 result = DeleteFileA(path);
+	return result;
+}
+
+internal b32 PlatformRenameFile(char *oldPath, char *newPath)
+{
+	b32 result = MoveFileExA(oldPath, newPath, MOVEFILE_REPLACE_EXISTING);
+	return result;
+}
+
+internal void PlatformTouchFile(char *path)
+{
+	HANDLE fileHandle = CreateFileA(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+	                                0, OPEN_EXISTING, 0, 0);
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		FILETIME now;
+		GetSystemTimeAsFileTime(&now);
+		SetFileTime(fileHandle, 0, 0, &now);
+		CloseHandle(fileHandle);
+	}
+}
+
+internal b32 PlatformGetFileInfo(char *path, platform_file_info *info)
+{
+	*info = {};
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	b32 result = GetFileAttributesExA(path, GetFileExInfoStandard, &attributes) &&
+	             !(attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+	if (result) {
+		info->size = ((u64)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+		info->lastWriteTime = ((u64)attributes.ftLastWriteTime.dwHighDateTime << 32) |
+		                      attributes.ftLastWriteTime.dwLowDateTime;
+	}
+	return result;
+}
+#pragma endregion
+
+#pragma region Memory
+internal void* PlatformAllocateMemory(void *baseAddress, size_t size)
+{
+	//Auto-zeroed
+	void *result = VirtualAlloc(baseAddress, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	return result;
+}
+
+internal void PlatformFreeMemory(void *memory, size_t size)
+{
+	if (memory) {
+		VirtualFree(memory, 0, MEM_RELEASE);
+	}
+}
+
+internal void* PlatformReserveMemory(void *baseAddress, size_t size, u32 *memoryFlags)
+{
+	//NOTE (aske): Large pages on Windows need SeLockMemoryPrivilege and can't be committed
+	//piecemeal, so huge pages aren't supported for growable memory here
+	*memoryFlags &= ~(PlatformMemory_TransparentHugePages | PlatformMemory_HugeTlb);
+	void *result = VirtualAlloc(baseAddress, size, MEM_RESERVE, PAGE_NOACCESS);
+	return result;
+}
+
+internal b32 PlatformCommitMemory(void *address, size_t size, u32 *memoryFlags)
+{
+	b32 result = (VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != 0);
+	if (result && (*memoryFlags & PlatformMemory_Prefault)) {
+		for (u8 *page = (u8 *)address; page < (u8 *)address + size; page += Kilobytes(4)) {
+			*(volatile u8 *)page = 0;
+		}
+	}
+	return result;
+}
+
+internal void PlatformDecommitMemory(void *address, size_t size, u32 memoryFlags)
+{
+	VirtualFree(address, size, MEM_DECOMMIT);
+}
+
+internal platform_page_faults PlatformGetPageFaults()
+{
+	platform_page_faults result = {};
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		result.minor = counters.PageFaultCount;
+	}
+	return result;
+}
+
+internal f64 PlatformGetWallClockSeconds()
+{
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	f64 result = (f64)counter.QuadPart / (f64)frequency.QuadPart;
+	return result;
+}
+
+internal void PlatformSleepMilliseconds(u32 milliseconds)
+{
+	Sleep(milliseconds);
+}
+#pragma endregion
+
+#pragma region Threads
+internal DWORD WINAPI Win32ThreadTrampoline(LPVOID parameter)
+{
+	platform_thread *thread = (platform_thread *)parameter;
+	thread->proc(thread->data);
+	return 0;
+}
+
+internal b32 PlatformStartThread(platform_thread *thread, platform_thread_proc *proc, void *data)
+{
+	thread->proc = proc;
+	thread->data = data;
+	HANDLE handle = CreateThread(0, 0, Win32ThreadTrampoline, thread, 0, 0);
+	thread->isValid = (handle != 0);
+	thread->handle = (umm)handle;
+	return thread->isValid;
+}
+
+internal void PlatformJoinThread(platform_thread *thread)
+{
+	if (thread->isValid) {
+		WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+		CloseHandle((HANDLE)thread->handle);
+		thread->isValid = false;
+	}
+}
+
+internal s32 PlatformGetProcessorCount()
+{
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return (s32)systemInfo.dwNumberOfProcessors;
+}
+#pragma endregion
+
+#pragma region Sockets
+//NOTE (aske): Not done on Windows yet. It has AF_UNIX sockets since Windows 10 (afunix.h), but through Winsock,
+//whose SOCKETs don't go through ReadFile and WriteFile like the other handles here.
+internal platform_file PlatformListenOnLocalSocket(char *path)
+{
+	platform_file result = {};
+	return result;
+}
+
+internal platform_file PlatformAcceptConnection(platform_file *listener)
+{
+	platform_file result = {};
+	return result;
+}
+
+internal b32 PlatformWaitForReadable(platform_file *files, s32 count, b32 *isReadable)
+{
+	return false;
+}
+#pragma endregion
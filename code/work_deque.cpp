@@ -0,0 +1,109 @@
+//NOTE (Aske): Work-stealing deque over a fixed set of job indices. Batch jobs are all known up front,
+//so nothing is ever pushed, and the remaining range [front, back) fits in one u64 that both ends
+//claim from with a single compare-exchange. The owner takes one job at a time from the front,
+//while idle workers steal the back half, so a worker stuck on a huge file gives away its small ones.
+struct work_deque
+{
+	volatile u64 range;	//front in the low 32 bits, back in the high 32 bits
+	u8 _padding[56];	//Keeps every deque on its own cache line
+};
+
+#define PackWorkRange(front, back) (((u64)(back) << 32) | (u64)(front))
+#define WorkRangeFront(range) ((u32)(range))
+#define WorkRangeBack(range) ((u32)((range) >> 32))
+
+//NOTE (Aske): Only for a deque nobody can steal from yet, or one that's empty and owned by the caller
+internal void SetWorkDequeRange(work_deque *deque, u32 front, u32 back)
+{
+	Assert(front <= back);
+	u64 previous = AtomicLoadU64(&deque->range);
+	b32 isSet = (AtomicCompareExchangeU64(&deque->range, previous, PackWorkRange(front, back)) == previous);
+	Assert(isSet);
+}
+
+internal b32 TakeFrontOfWorkDeque(work_deque *deque, u32 *jobIndex)
+{
+	for (;;)
+	{
+		u64 range = AtomicLoadU64(&deque->range);
+		u32 front = WorkRangeFront(range);
+		u32 back = WorkRangeBack(range);
+		if (front == back)
+		{
+			return false;
+		}
+
+		if (AtomicCompareExchangeU64(&deque->range, range, PackWorkRange(front + 1, back)) == range)
+		{
+			*jobIndex = front;
+			return true;
+		}
+	}
+}
+
+internal b32 StealBackOfWorkDeque(work_deque *deque, u32 *stolenFront, u32 *stolenBack)
+{
+	for (;;)
+	{
+		u64 range = AtomicLoadU64(&deque->range);
+		u32 front = WorkRangeFront(range);
+		u32 back = WorkRangeBack(range);
+		if (front == back)
+		{
+			return false;
+		}
+
+		//NOTE (Aske): Rounded up, so a single remaining job can be stolen too
+		u32 stealCount = (back - front + 1) / 2;
+		if (AtomicCompareExchangeU64(&deque->range, range, PackWorkRange(front, back - stealCount)) == range)
+		{
+			*stolenFront = back - stealCount;
+			*stolenBack = back;
+			return true;
+		}
+	}
+}
+
+//NOTE (Aske): Takes the next job from the worker's own deque. When that's empty, half of another worker's jobs
+//are stolen into it first. Returns false once every deque is empty.
+internal b32 TakeNextWork(work_deque *deques, s32 dequeCount, s32 ownIndex, u32 *jobIndex, s32 *stealCount)
+{
+	work_deque *ownDeque = deques + ownIndex;
+	for (;;)
+	{
+		if (TakeFrontOfWorkDeque(ownDeque, jobIndex))
+		{
+			return true;
+		}
+
+		b32 isStolen = false;
+		for (s32 offset = 1; !isStolen && (offset < dequeCount); ++offset)
+		{
+			work_deque *victim = deques + ((ownIndex + offset) % dequeCount);
+			u32 stolenFront;
+			u32 stolenBack;
+			if (StealBackOfWorkDeque(victim, &stolenFront, &stolenBack))
+			{
+				SetWorkDequeRange(ownDeque, stolenFront, stolenBack);
+				++*stealCount;
+				isStolen = true;
+			}
+		}
+
+		if (!isStolen)
+		{
+			return false;
+		}
+	}
+}
+
+//NOTE (Aske): Hands each deque a contiguous block of the jobs, in order
+internal void DistributeWork(work_deque *deques, s32 dequeCount, u32 jobCount)
+{
+	for (s32 dequeIndex = 0; dequeIndex < dequeCount; ++dequeIndex)
+	{
+		u32 front = (u32)(((u64)jobCount * dequeIndex) / dequeCount);
+		u32 back = (u32)(((u64)jobCount * (dequeIndex + 1)) / dequeCount);
+		SetWorkDequeRange(deques + dequeIndex, front, back);
+	}
+}
@@ -0,0 +1,2 @@
+;aad_without_base
+bits 16
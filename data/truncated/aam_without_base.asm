@@ -0,0 +1,2 @@
+;aam_without_base
+bits 16
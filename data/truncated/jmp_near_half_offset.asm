@@ -0,0 +1,2 @@
+;jmp_near_half_offset
+bits 16
@@ -0,0 +1,2 @@
+;jmp_near_without_offset
+bits 16
@@ -0,0 +1,4 @@
+;jump_into_truncated
+bits 16
+xchg ax, ax
+jmp short label__3